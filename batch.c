@@ -0,0 +1,357 @@
+// Batch simulation engine, see batch.h
+// The AVX-512, AVX2 and SSE4.1 kernels are generated from batch_kernel.h and picked at runtime,
+// so the file builds without any -m flags and still runs on older CPUs.
+// Lanes are 16 bit, which doubles the matches per instruction compared to int lanes.
+
+#include <stdlib.h>
+#include <string.h>
+#include "batch.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BATCH_HAS_X86 1
+#endif
+
+#define batchAlignment 64
+#define batchMaxWidth 32 //lanes in the widest kernel
+
+static int scalarGameLogic(MatchBatch* batch){
+    int over = 0;
+    for (int lane = 0; lane < batch->capacity; lane++) {
+        Global g;
+        batchStore(batch, lane, &g);
+        simGameLogic(&g);
+        batchLoad(batch, lane, &g);
+        over += g.gameOver != 0;
+    }
+    //padding lanes are frozen with gameOver set
+    return over - (batch->capacity - batch->count);
+}
+
+static void scalarTrackPlayer(MatchBatch* batch, int speed){
+    for (int lane = 0; lane < batch->capacity; lane++) {
+        if (batch->gameOver[lane] || batch->ballX[lane] < screenWidth / 2) {
+            continue;
+        }
+        int diff = batch->ballY[lane] + ballSideLength / 2 - (batch->playerY[lane] + paddleLength / 2);
+        if (diff > 0) {
+            batch->playerY[lane] += speed;
+        } else if (diff < 0) {
+            batch->playerY[lane] -= speed;
+        }
+    }
+}
+
+#ifdef BATCH_HAS_X86
+
+#define KERNEL_SUFFIX Sse41
+#define KERNEL_TARGET __attribute__((target("sse4.1")))
+#define VEC __m128i
+#define WIDTH 8
+#define V_LOAD(p) _mm_load_si128((const __m128i*) (p))
+#define V_STORE(p, v) _mm_storeu_si128((__m128i*) (p), (v))
+#define V_SET1(x) _mm_set1_epi16(x)
+#define V_ADD(a, b) _mm_add_epi16(a, b)
+#define V_SUB(a, b) _mm_sub_epi16(a, b)
+#define V_MUL(a, b) _mm_mullo_epi16(a, b)
+#define V_AND(a, b) _mm_and_si128(a, b)
+#define V_OR(a, b) _mm_or_si128(a, b)
+#define V_ANDNOT(a, b) _mm_andnot_si128(a, b)
+#define V_CMPGT(a, b) _mm_cmpgt_epi16(a, b)
+#define V_CMPEQ(a, b) _mm_cmpeq_epi16(a, b)
+#define V_XOR(a, b) _mm_xor_si128(a, b)
+#define V_MULHI(a, b) _mm_mulhi_epi16(a, b)
+#define V_BLEND(a, b, mask) _mm_blendv_epi8(a, b, mask)
+#define V_NONE(mask) _mm_testz_si128(mask, mask)
+#define V_COUNT(mask) (__builtin_popcount((unsigned int) _mm_movemask_epi8(mask)) / 2)
+#include "batch_kernel.h"
+#undef KERNEL_SUFFIX
+#undef KERNEL_TARGET
+#undef VEC
+#undef WIDTH
+#undef V_LOAD
+#undef V_STORE
+#undef V_SET1
+#undef V_ADD
+#undef V_SUB
+#undef V_MUL
+#undef V_AND
+#undef V_OR
+#undef V_ANDNOT
+#undef V_CMPGT
+#undef V_CMPEQ
+#undef V_XOR
+#undef V_MULHI
+#undef V_BLEND
+#undef V_NONE
+#undef V_COUNT
+
+#define KERNEL_SUFFIX Avx2
+#define KERNEL_TARGET __attribute__((target("avx2")))
+#define VEC __m256i
+#define WIDTH 16
+#define V_LOAD(p) _mm256_load_si256((const __m256i*) (p))
+#define V_STORE(p, v) _mm256_storeu_si256((__m256i*) (p), (v))
+#define V_SET1(x) _mm256_set1_epi16(x)
+#define V_ADD(a, b) _mm256_add_epi16(a, b)
+#define V_SUB(a, b) _mm256_sub_epi16(a, b)
+#define V_MUL(a, b) _mm256_mullo_epi16(a, b)
+#define V_AND(a, b) _mm256_and_si256(a, b)
+#define V_OR(a, b) _mm256_or_si256(a, b)
+#define V_ANDNOT(a, b) _mm256_andnot_si256(a, b)
+#define V_CMPGT(a, b) _mm256_cmpgt_epi16(a, b)
+#define V_CMPEQ(a, b) _mm256_cmpeq_epi16(a, b)
+#define V_XOR(a, b) _mm256_xor_si256(a, b)
+#define V_MULHI(a, b) _mm256_mulhi_epi16(a, b)
+#define V_BLEND(a, b, mask) _mm256_blendv_epi8(a, b, mask)
+#define V_NONE(mask) _mm256_testz_si256(mask, mask)
+#define V_COUNT(mask) (__builtin_popcount((unsigned int) _mm256_movemask_epi8(mask)) / 2)
+#include "batch_kernel.h"
+#undef KERNEL_SUFFIX
+#undef KERNEL_TARGET
+#undef VEC
+#undef WIDTH
+#undef V_LOAD
+#undef V_STORE
+#undef V_SET1
+#undef V_ADD
+#undef V_SUB
+#undef V_MUL
+#undef V_AND
+#undef V_OR
+#undef V_ANDNOT
+#undef V_CMPGT
+#undef V_CMPEQ
+#undef V_XOR
+#undef V_MULHI
+#undef V_BLEND
+#undef V_NONE
+#undef V_COUNT
+
+//AVX-512 compares produce mask registers, the kernel wants all ones lanes like the narrower sets,
+//so masks go through movm/movepi16, which the compiler mostly folds back into k registers
+#define KERNEL_SUFFIX Avx512
+#define KERNEL_TARGET __attribute__((target("avx512f,avx512bw")))
+#define VEC __m512i
+#define WIDTH 32
+#define V_LOAD(p) _mm512_load_si512((const void*) (p))
+#define V_STORE(p, v) _mm512_storeu_si512((void*) (p), (v))
+#define V_SET1(x) _mm512_set1_epi16(x)
+#define V_ADD(a, b) _mm512_add_epi16(a, b)
+#define V_SUB(a, b) _mm512_sub_epi16(a, b)
+#define V_MUL(a, b) _mm512_mullo_epi16(a, b)
+#define V_AND(a, b) _mm512_and_si512(a, b)
+#define V_OR(a, b) _mm512_or_si512(a, b)
+#define V_ANDNOT(a, b) _mm512_andnot_si512(a, b)
+#define V_CMPGT(a, b) _mm512_movm_epi16(_mm512_cmpgt_epi16_mask(a, b))
+#define V_CMPEQ(a, b) _mm512_movm_epi16(_mm512_cmpeq_epi16_mask(a, b))
+#define V_XOR(a, b) _mm512_xor_si512(a, b)
+#define V_MULHI(a, b) _mm512_mulhi_epi16(a, b)
+#define V_BLEND(a, b, mask) _mm512_mask_blend_epi16(_mm512_movepi16_mask(mask), a, b)
+#define V_NONE(mask) (_mm512_movepi16_mask(mask) == 0)
+#define V_COUNT(mask) __builtin_popcount(_mm512_movepi16_mask(mask))
+#include "batch_kernel.h"
+#undef KERNEL_SUFFIX
+#undef KERNEL_TARGET
+#undef VEC
+#undef WIDTH
+#undef V_LOAD
+#undef V_STORE
+#undef V_SET1
+#undef V_ADD
+#undef V_SUB
+#undef V_MUL
+#undef V_AND
+#undef V_OR
+#undef V_ANDNOT
+#undef V_CMPGT
+#undef V_CMPEQ
+#undef V_XOR
+#undef V_MULHI
+#undef V_BLEND
+#undef V_NONE
+#undef V_COUNT
+
+#endif
+
+typedef struct BatchKernels{
+    const char* name;
+    int (*gameLogic)(MatchBatch* batch);
+    void (*trackPlayer)(MatchBatch* batch, int speed);
+} BatchKernels;
+
+static const BatchKernels scalarKernels = {"scalar", scalarGameLogic, scalarTrackPlayer};
+#ifdef BATCH_HAS_X86
+static const BatchKernels sse41Kernels = {"sse4.1", gameLogicSse41, trackPlayerSse41};
+static const BatchKernels avx2Kernels = {"avx2", gameLogicAvx2, trackPlayerAvx2};
+static const BatchKernels avx512Kernels = {"avx512", gameLogicAvx512, trackPlayerAvx512};
+#endif
+static const BatchKernels* selected = NULL;
+
+static const BatchKernels* selectKernels(){
+    if (selected != NULL) {
+        return selected;
+    }
+    selected = &scalarKernels;
+#ifdef BATCH_HAS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+        selected = &avx512Kernels;
+    } else if (__builtin_cpu_supports("avx2")) {
+        selected = &avx2Kernels;
+    } else if (__builtin_cpu_supports("sse4.1")) {
+        selected = &sse41Kernels;
+    }
+#endif
+    return selected;
+}
+
+//Kernels by name, NULL if unknown or the CPU lacks the instructions
+static const BatchKernels* findKernels(const char* name){
+    if (strcmp(name, "scalar") == 0) {
+        return &scalarKernels;
+    }
+#ifdef BATCH_HAS_X86
+    __builtin_cpu_init();
+    if (strcmp(name, "sse4.1") == 0 && __builtin_cpu_supports("sse4.1")) {
+        return &sse41Kernels;
+    }
+    if (strcmp(name, "avx2") == 0 && __builtin_cpu_supports("avx2")) {
+        return &avx2Kernels;
+    }
+    if (strcmp(name, "avx512") == 0 && __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+        return &avx512Kernels;
+    }
+#endif
+    return NULL;
+}
+
+int batchKernelsSupported(const char* name){
+    return findKernels(name) != NULL;
+}
+
+int batchSelectKernels(const char* name){
+    const BatchKernels* kernels = findKernels(name);
+    if (kernels == NULL) {
+        return -1;
+    }
+    selected = kernels;
+    return 0;
+}
+
+int batchInit(MatchBatch* batch, int count){
+    memset(batch, 0, sizeof(*batch));
+    if (count <= 0) {
+        return -1;
+    }
+    int capacity = (count + batchMaxWidth - 1) / batchMaxWidth * batchMaxWidth;
+    //each array starts on its own cache line
+    size_t arrayBytes = ((size_t) capacity * sizeof(short) + batchAlignment - 1) / batchAlignment * batchAlignment;
+    char* block = aligned_alloc(batchAlignment, arrayBytes * 14);
+    if (block == NULL) {
+        return -1;
+    }
+
+    batch->count = count;
+    batch->capacity = capacity;
+    batch->ballX = (short*) (block + arrayBytes * 0);
+    batch->ballY = (short*) (block + arrayBytes * 1);
+    batch->ballDirX = (short*) (block + arrayBytes * 2);
+    batch->ballDirY = (short*) (block + arrayBytes * 3);
+    batch->ballSpeed = (short*) (block + arrayBytes * 4);
+    batch->playerY = (short*) (block + arrayBytes * 5);
+    batch->aiY = (short*) (block + arrayBytes * 6);
+    batch->playerScore = (short*) (block + arrayBytes * 7);
+    batch->aiScore = (short*) (block + arrayBytes * 8);
+    batch->lastScore = (short*) (block + arrayBytes * 9);
+    batch->gameOver = (short*) (block + arrayBytes * 10);
+    batch->ballFractionX = (unsigned short*) (block + arrayBytes * 11);
+    batch->ballFractionY = (unsigned short*) (block + arrayBytes * 12);
+    batch->aiFraction = (unsigned short*) (block + arrayBytes * 13);
+
+    Global g;
+    simInitGlobals(&g);
+    for (int lane = 0; lane < capacity; lane++) {
+        batchLoad(batch, lane, &g);
+    }
+    //padding lanes sit at a finished score so gameLogic leaves them alone
+    g.playerScore = winningScore;
+    g.gameOver = 1;
+    for (int lane = count; lane < capacity; lane++) {
+        batchLoad(batch, lane, &g);
+    }
+    return 0;
+}
+
+int batchResize(MatchBatch* batch, int count){
+    if (count <= 0 || count > batch->capacity) {
+        return -1;
+    }
+    Global parked;
+    simInitGlobals(&parked);
+    parked.playerScore = winningScore;
+    parked.gameOver = 1;
+    for (int lane = count; lane < batch->count; lane++) {
+        batchLoad(batch, lane, &parked);
+    }
+    batch->count = count;
+    return 0;
+}
+
+void batchFree(MatchBatch* batch){
+    //every array lives in the block that starts at ballX
+    free(batch->ballX);
+    memset(batch, 0, sizeof(*batch));
+}
+
+void batchLoad(MatchBatch* batch, int lane, const Global* g){
+    batch->ballX[lane] = (short) g->ballPosition.x;
+    batch->ballY[lane] = (short) g->ballPosition.y;
+    batch->ballDirX[lane] = (short) g->ballDirection.x;
+    batch->ballDirY[lane] = (short) g->ballDirection.y;
+    batch->ballSpeed[lane] = (short) g->ballSpeed;
+    batch->playerY[lane] = (short) g->playerPaddlePosition.y;
+    batch->aiY[lane] = (short) g->aiPaddlePosition.y;
+    batch->playerScore[lane] = (short) g->playerScore;
+    batch->aiScore[lane] = (short) g->aiScore;
+    batch->lastScore[lane] = (short) g->lastScore;
+    batch->gameOver[lane] = (short) g->gameOver;
+    batch->ballFractionX[lane] = (unsigned short) g->ballFraction.x;
+    batch->ballFractionY[lane] = (unsigned short) g->ballFraction.y;
+    batch->aiFraction[lane] = (unsigned short) g->aiPaddleFraction;
+}
+
+void batchStore(const MatchBatch* batch, int lane, Global* g){
+    g->playerPaddlePosition = (Point){screenWidth - paddleOffset - paddleWidth, batch->playerY[lane]};
+    g->aiPaddlePosition = (Point){paddleOffset, batch->aiY[lane]};
+    g->playerScore = batch->playerScore[lane];
+    g->aiScore = batch->aiScore[lane];
+    g->ballPosition = (Point){batch->ballX[lane], batch->ballY[lane]};
+    g->ballSpeed = batch->ballSpeed[lane];
+    g->ballDirection = (Point){batch->ballDirX[lane], batch->ballDirY[lane]};
+    g->lastScore = batch->lastScore[lane];
+    g->gameOver = batch->gameOver[lane];
+    g->ballFraction = (Point){batch->ballFractionX[lane], batch->ballFractionY[lane]};
+    g->aiPaddleFraction = batch->aiFraction[lane];
+    g->tickScale = batch->tickScale;
+}
+
+void batchTrackPlayer(MatchBatch* batch, int speed){
+    selectKernels()->trackPlayer(batch, speed);
+}
+
+int batchGameLogic(MatchBatch* batch){
+    return selectKernels()->gameLogic(batch);
+}
+
+int batchGameLogicWith(MatchBatch* batch, const char* kernels){
+    const BatchKernels* chosen = findKernels(kernels);
+    if (chosen == NULL) {
+        return -1;
+    }
+    return chosen->gameLogic(batch);
+}
+
+const char* batchBackendName(){
+    return selectKernels()->name;
+}
@@ -0,0 +1,70 @@
+// Batch simulation engine
+// Steps many independent matches at once. The state is stored as structure of arrays,
+// one aligned array per field, so the rules can be applied to 8/16/32 matches per instruction.
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "pong.h"
+
+//One lane per match, every array holds capacity entries
+//Lanes from count up to capacity are padding and stay frozen in a finished state
+//Paddle x positions are not stored, the rules never move them horizontally
+//Fields are 16 bit: positions stay within a few ball steps of the 1920x1080 field and the
+//ball speed is reset on every goal, so no value the rules produce comes close to the limit
+typedef struct MatchBatch{
+    int count; //number of matches
+    int capacity; //count rounded up to the widest vector width
+    short* ballX;
+    short* ballY;
+    short* ballDirX;
+    short* ballDirY;
+    short* ballSpeed;
+    short* playerY;
+    short* aiY;
+    short* playerScore;
+    short* aiScore;
+    short* lastScore;
+    short* gameOver;
+    unsigned short* ballFractionX; //Q16.16 sub-pixel parts, all 0 at the 60 Hz reference
+    unsigned short* ballFractionY;
+    unsigned short* aiFraction;
+    int tickScale; //Global.tickScale shared by every lane, 0 (fixedOne) after batchInit
+} MatchBatch;
+
+//Allocates the lanes and initializes every match like initGlobals
+//Returns -1 if the allocation fails
+int batchInit(MatchBatch* batch, int count);
+void batchFree(MatchBatch* batch);
+
+//Changes the number of matches without reallocating, lanes past the new count are parked
+//finished. Returns -1 if count exceeds the capacity.
+int batchResize(MatchBatch* batch, int count);
+
+//Copies one match in or out of the batch
+//The tick scale is the batch's, batchLoad leaves it alone and batchStore copies it out
+void batchLoad(MatchBatch* batch, int lane, const Global* g);
+void batchStore(const MatchBatch* batch, int lane, Global* g);
+
+//Moves every player paddle one step towards the ball while it is on the right half, the
+//vector form of simTrackPaddle
+void batchTrackPlayer(MatchBatch* batch, int speed);
+
+//Runs gameLogic on every lane, bit for bit identical to simGameLogic
+//Returns the number of lanes (padding excluded) whose gameOver flag is set afterwards
+int batchGameLogic(MatchBatch* batch);
+
+//batchGameLogic with the named kernels instead of the runtime pick, which stays as it is
+//Returns -1 if the CPU does not support them
+int batchGameLogicWith(MatchBatch* batch, const char* kernels);
+
+//Name of the instruction set picked at runtime ("avx512", "avx2", "sse4.1" or "scalar")
+const char* batchBackendName();
+
+//Overrides the runtime pick, returns -1 if the CPU does not support the named kernels
+int batchSelectKernels(const char* name);
+
+//1 if the CPU can run the named kernels, without changing the pick
+int batchKernelsSupported(const char* name);
+
+#endif
@@ -0,0 +1,223 @@
+// Vectorized gameLogic kernels, included once per instruction set by batch.c
+// No include guard on purpose. The includer defines:
+//   KERNEL_SUFFIX, KERNEL_TARGET, VEC, WIDTH
+//   V_LOAD, V_STORE, V_SET1, V_ADD, V_SUB, V_MUL, V_AND, V_OR, V_ANDNOT (~a & b)
+//   V_CMPGT, V_CMPEQ (all ones / all zeros per lane), V_BLEND (mask ? b : a), V_NONE (no lane set),
+//   V_COUNT (number of lanes set, as an int), V_XOR, V_MULHI (high half of the signed product)
+//
+// Every branch of updateBall/updateAI/gameLogic becomes a lane mask and is applied with a blend
+// or by adding the mask (-1 per lane) so all lanes follow the same instruction stream. Only the
+// rare branches (side walls, finished matches) are skipped when no lane in the vector takes them.
+// Off the 60 Hz reference the positions move in Q16.16 like simUpdateBall. On it the fraction
+// lanes are only touched in vectors where a lane reached a side wall, since a goal resets them.
+
+#define KERNEL_CONCAT_(a, b) a##b
+#define KERNEL_CONCAT(a, b) KERNEL_CONCAT_(a, b)
+
+//fixedMove for whole lanes: pos + *fraction moved by delta pixels per frame for whole + part
+//frames, part held in signed lanes with partTop all ones where its top bit is set. Leaves the new
+//fraction in *fraction and returns the new whole pixels.
+KERNEL_TARGET
+static inline VEC KERNEL_CONCAT(fixedMove, KERNEL_SUFFIX)(VEC pos, VEC* fraction, VEC delta, VEC whole, VEC part,
+                                                          VEC partTop){
+    const VEC sign = V_SET1(-32768);
+    //delta * part as a 32 bit product: V_MULHI reads part as signed, so delta is added back for its top bit
+    VEC high = V_ADD(V_MULHI(delta, part), V_AND(delta, partTop));
+    VEC moved = V_ADD(*fraction, V_MUL(delta, part));
+    //carry out of the fraction, an unsigned compare made signed by flipping the top bits
+    VEC carry = V_CMPGT(V_XOR(*fraction, sign), V_XOR(moved, sign));
+    *fraction = moved;
+    return V_SUB(V_ADD(pos, V_ADD(V_MUL(delta, whole), high)), carry);
+}
+
+KERNEL_TARGET
+static int KERNEL_CONCAT(gameLogic, KERNEL_SUFFIX)(MatchBatch* batch){
+    const VEC zero = V_SET1(0);
+    const VEC one = V_SET1(1);
+    const VEC nine = V_SET1(winningScore);
+    const VEC wallMin = V_SET1(10);
+    const VEC maxX = V_SET1(ballMaxX);
+    const VEC maxY = V_SET1(ballMaxY);
+    const VEC side = V_SET1(ballSideLength);
+    const VEC width = V_SET1(paddleWidth);
+    const VEC length = V_SET1(paddleLength);
+    const VEC playerX = V_SET1(screenWidth - paddleOffset - paddleWidth);
+    const VEC aiX = V_SET1(paddleOffset);
+    const VEC top = V_SET1(goalTop);
+    const VEC bottom = V_SET1(goalBottom);
+    const VEC centerX = V_SET1(initialBallPosition.x);
+    const VEC centerY = V_SET1(initialBallPosition.y);
+    const VEC serveX = V_SET1(initialBallDirection.x);
+    const VEC serveY = V_SET1(initialBallDirection.y);
+    const VEC startSpeed = V_SET1(initialBallSpeed);
+    const VEC aiSpeed = V_SET1(aiPaddleSpeed);
+    const VEC half = V_SET1(screenWidth / 2);
+    int scale = batch->tickScale != 0 ? batch->tickScale : fixedOne;
+    int reference = scale == fixedOne; //the same for every vector, so its branches always predict right
+    const VEC whole = V_SET1((short) (scale >> 16));
+    const VEC part = V_SET1((short) (scale & 0xffff));
+    const VEC partTop = V_SET1((short) (scale & 0x8000 ? -1 : 0));
+    int over = batch->capacity;
+
+    for (int i = 0; i < batch->capacity; i += WIDTH) {
+        VEC bx = V_LOAD(batch->ballX + i);
+        VEC by = V_LOAD(batch->ballY + i);
+        VEC dx = V_LOAD(batch->ballDirX + i);
+        VEC dy = V_LOAD(batch->ballDirY + i);
+        VEC sp = V_LOAD(batch->ballSpeed + i);
+        VEC py = V_LOAD(batch->playerY + i);
+        VEC ay = V_LOAD(batch->aiY + i);
+        VEC ps = V_LOAD(batch->playerScore + i);
+        VEC as = V_LOAD(batch->aiScore + i);
+        VEC ls = V_LOAD(batch->lastScore + i);
+        VEC go = V_LOAD(batch->gameOver + i);
+
+        //gameLogic: a lane at 9 points only sets gameOver
+        VEC done = V_OR(V_CMPEQ(ps, nine), V_CMPEQ(as, nine));
+
+        //updateBall: move horizontally, walls are checked before moving vertically
+        VEC fx = zero, fy = zero, af = zero;
+        VEC newFx = zero, newFy = zero, newAf = zero;
+        VEC nx, ny;
+        int fractions = !reference;
+        if (reference) {
+            nx = V_ADD(bx, V_MUL(sp, dx));
+            ny = V_ADD(by, V_MUL(sp, dy));
+        } else {
+            fx = newFx = V_LOAD(batch->ballFractionX + i);
+            fy = newFy = V_LOAD(batch->ballFractionY + i);
+            af = newAf = V_LOAD(batch->aiFraction + i);
+            nx = KERNEL_CONCAT(fixedMove, KERNEL_SUFFIX)(bx, &newFx, V_MUL(sp, dx), whole, part, partTop);
+            ny = KERNEL_CONCAT(fixedMove, KERNEL_SUFFIX)(by, &newFy, V_MUL(sp, dy), whole, part, partTop);
+        }
+        VEC hitX = V_OR(V_CMPGT(wallMin, nx), V_CMPGT(nx, maxX));
+        VEC hitY = V_ANDNOT(hitX, V_OR(V_CMPGT(wallMin, ny), V_CMPGT(ny, maxY)));
+        VEC wall = V_OR(hitX, hitY);
+
+        VEC playerHit = V_AND(V_AND(V_CMPGT(V_ADD(nx, side), playerX), V_CMPGT(V_ADD(playerX, width), nx)),
+                              V_AND(V_CMPGT(V_ADD(ny, side), py), V_CMPGT(V_ADD(py, length), ny)));
+        VEC aiHit = V_AND(V_AND(V_CMPGT(V_ADD(nx, side), aiX), V_CMPGT(V_ADD(aiX, width), nx)),
+                          V_AND(V_CMPGT(V_ADD(ny, side), ay), V_CMPGT(V_ADD(ay, length), ny)));
+        playerHit = V_ANDNOT(wall, playerHit);
+        aiHit = V_ANDNOT(V_OR(wall, playerHit), aiHit);
+
+        VEC negX = V_OR(playerHit, aiHit);
+        VEC newX = nx;
+        VEC newY = ny;
+        VEC newDx;
+        VEC newDy = V_BLEND(dy, V_SUB(zero, dy), hitY);
+        VEC newSpeed = V_SUB(sp, aiHit);
+        VEC newLast = ls;
+        VEC newPs = ps;
+        VEC newAs = as;
+
+        //the side walls are rare, so goal posts and scoring are skipped unless a lane reached one
+        if (!V_NONE(hitX)) {
+            VEC inGoal = V_AND(V_CMPGT(bottom, V_ADD(by, side)), V_CMPGT(by, top));
+            VEC goal = V_AND(hitX, inGoal);
+            VEC aiScored = V_AND(goal, V_CMPEQ(dx, one));
+            VEC playerScored = V_ANDNOT(aiScored, goal);
+            if (reference) {
+                //a state loaded with fractions keeps them at the reference rate, until a goal
+                fx = newFx = V_LOAD(batch->ballFractionX + i);
+                fy = newFy = V_LOAD(batch->ballFractionY + i);
+                af = newAf = V_LOAD(batch->aiFraction + i);
+                fractions = 1;
+            }
+
+            //goal posts bounce the ball back and y is not moved on this frame
+            negX = V_OR(negX, V_ANDNOT(inGoal, hitX));
+            newY = V_BLEND(V_BLEND(ny, by, hitX), centerY, goal);
+            newX = V_BLEND(nx, centerX, goal);
+            newFx = V_BLEND(newFx, zero, goal);
+            newFy = V_BLEND(V_BLEND(newFy, fy, hitX), zero, goal);
+            newDy = V_BLEND(newDy, serveY, goal);
+            newSpeed = V_BLEND(newSpeed, startSpeed, goal);
+            newLast = V_BLEND(V_BLEND(ls, one, aiScored), zero, playerScored);
+            newPs = V_SUB(ps, playerScored);
+            newAs = V_SUB(as, aiScored);
+
+            newDx = V_BLEND(V_BLEND(dx, V_SUB(zero, dx), negX), V_BLEND(V_SUB(zero, serveX), serveX, aiScored), goal);
+        } else {
+            newDx = V_BLEND(dx, V_SUB(zero, dx), negX);
+        }
+
+        //updateAI: follow the ball's y while it is on the left half
+        VEC aiActive = V_CMPGT(half, newX);
+        VEC aiUp = V_AND(aiActive, V_CMPGT(ay, newY));
+        VEC aiDown = V_AND(aiActive, V_CMPGT(newY, ay));
+        VEC newAy;
+        if (reference) {
+            newAy = V_SUB(V_ADD(ay, V_AND(aiDown, aiSpeed)), V_AND(aiUp, aiSpeed));
+        } else {
+            VEC aiStep = V_SUB(V_AND(aiDown, aiSpeed), V_AND(aiUp, aiSpeed));
+            newAy = KERNEL_CONCAT(fixedMove, KERNEL_SUFFIX)(ay, &newAf, aiStep, whole, part, partTop);
+        }
+
+        //finished lanes keep their state, only gameOver is raised
+        if (!V_NONE(done)) {
+            newX = V_BLEND(newX, bx, done);
+            newY = V_BLEND(newY, by, done);
+            newDx = V_BLEND(newDx, dx, done);
+            newDy = V_BLEND(newDy, dy, done);
+            newSpeed = V_BLEND(newSpeed, sp, done);
+            newAy = V_BLEND(newAy, ay, done);
+            newPs = V_BLEND(newPs, ps, done);
+            newAs = V_BLEND(newAs, as, done);
+            newLast = V_BLEND(newLast, ls, done);
+            newFx = V_BLEND(newFx, fx, done);
+            newFy = V_BLEND(newFy, fy, done);
+            newAf = V_BLEND(newAf, af, done);
+            go = V_BLEND(go, one, done);
+            V_STORE(batch->gameOver + i, go);
+        }
+
+        V_STORE(batch->ballX + i, newX);
+        V_STORE(batch->ballY + i, newY);
+        V_STORE(batch->ballDirX + i, newDx);
+        V_STORE(batch->ballDirY + i, newDy);
+        V_STORE(batch->ballSpeed + i, newSpeed);
+        V_STORE(batch->aiY + i, newAy);
+        V_STORE(batch->playerScore + i, newPs);
+        V_STORE(batch->aiScore + i, newAs);
+        V_STORE(batch->lastScore + i, newLast);
+        if (fractions) {
+            V_STORE(batch->ballFractionX + i, newFx);
+            V_STORE(batch->ballFractionY + i, newFy);
+            V_STORE(batch->aiFraction + i, newAf);
+        }
+
+        //counted in an int, a 16 bit lane counter would wrap on batches of more than 32767 vectors
+        over -= V_COUNT(V_CMPEQ(go, zero));
+    }
+
+    //padding lanes are frozen with gameOver set
+    return over - (batch->capacity - batch->count);
+}
+
+//simTrackPaddle for the player side of every lane, as masks: the step is taken only while the
+//ball is on the right half and the centres differ
+KERNEL_TARGET
+static void KERNEL_CONCAT(trackPlayer, KERNEL_SUFFIX)(MatchBatch* batch, int speed){
+    const VEC half = V_SET1(screenWidth / 2);
+    const VEC zero = V_SET1(0);
+    const VEC step = V_SET1(speed);
+    const VEC ballCenter = V_SET1(ballSideLength / 2);
+    const VEC paddleCenter = V_SET1(paddleLength / 2);
+
+    for (int i = 0; i < batch->capacity; i += WIDTH) {
+        VEC bx = V_LOAD(batch->ballX + i);
+        VEC by = V_LOAD(batch->ballY + i);
+        VEC py = V_LOAD(batch->playerY + i);
+        VEC go = V_LOAD(batch->gameOver + i);
+
+        VEC active = V_ANDNOT(V_CMPGT(half, bx), V_CMPEQ(go, zero));
+        VEC diff = V_SUB(V_ADD(by, ballCenter), V_ADD(py, paddleCenter));
+        VEC down = V_AND(active, V_CMPGT(diff, zero));
+        VEC up = V_AND(active, V_CMPGT(zero, diff));
+        V_STORE(batch->playerY + i, V_SUB(V_ADD(py, V_AND(down, step)), V_AND(up, step)));
+    }
+}
+
+#undef KERNEL_CONCAT
+#undef KERNEL_CONCAT_
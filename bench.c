@@ -0,0 +1,484 @@
+// Microbenchmarks
+// Times the rules (the assembly updateBall, updateAI, gameLogic and resetBall next to their C
+// and branchless versions, and gameLogic on every physics backend) and the CPU side of drawing
+// on realistic state distributions: free flight in a rally, wall and paddle hits, goals, all of
+// those shuffled, and states sampled from whole matches. Every benchmark is run for a number of
+// samples; the report is JSON with ns/op, TSC cycles/op, hardware branch misses/op where the
+// kernel lets us count them, and their spread, so runs before and after a change can be compared.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "pong.h"
+#include "physics.h"
+#include "scene.h"
+#include "testutil.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define benchHasTsc 1
+#else
+#define benchHasTsc 0
+#endif
+
+#define benchStates 4096 //states per distribution, a power of two
+#define benchPhysicsChunk 256 //matches handed to a physics backend per step, divides benchStates
+
+typedef struct Distribution{
+    const char* name;
+    Global states[benchStates];
+} Distribution;
+
+typedef enum Kind{
+    KIND_ASM, //function on the global state, the state is copied in before every call
+    KIND_SIM, //function on a state of the distribution, copied to a scratch state first
+    KIND_SCENE, //builds geometry from a state of the distribution
+    KIND_PHYSICS //gameLogic through a physics backend, benchPhysicsChunk states copied in per step
+} Kind;
+
+typedef struct Benchmark{
+    const char* name;
+    Kind kind;
+    void (*asmFunction)(void);
+    void (*simFunction)(Global* g);
+    void (*sceneFunction)(Scene* scene, const Global* g);
+    const Distribution* states;
+    const char* physics; //backend name for KIND_PHYSICS
+} Benchmark;
+
+typedef struct Summary{
+    double mean;
+    double median;
+    double min;
+    double stddev;
+    double variance;
+} Summary;
+
+static int branchMissCounter = -1; //perf event fd, -1 if the kernel or the machine has no counter
+
+static double nowNanoseconds(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec * 1e9 + (double) ts.tv_nsec;
+}
+
+static unsigned long long readCycles(){
+#if benchHasTsc
+    _mm_lfence();
+    unsigned long long cycles = __rdtsc();
+    _mm_lfence();
+    return cycles;
+#else
+    return 0;
+#endif
+}
+
+//Hardware branch misses of this thread in user space, counted only while enabled
+static int openBranchMissCounter(){
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static void startBranchMisses(){
+    if (branchMissCounter >= 0) {
+        ioctl(branchMissCounter, PERF_EVENT_IOC_RESET, 0);
+        ioctl(branchMissCounter, PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+static long long stopBranchMisses(){
+    long long misses = 0;
+    if (branchMissCounter >= 0) {
+        ioctl(branchMissCounter, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(branchMissCounter, &misses, sizeof(misses)) != (ssize_t) sizeof(misses)) {
+            misses = 0;
+        }
+    }
+    return misses;
+}
+
+//A state in the middle of a match: random scores, speed and paddle positions
+static void randomState(Global* g){
+    simInitGlobals(g);
+    g->playerScore = testRandomBetween(0, winningScore - 1);
+    g->aiScore = testRandomBetween(0, winningScore - 1);
+    g->ballSpeed = testRandomBetween(initialBallSpeed, initialBallSpeed + 6);
+    g->ballDirection = (Point) {testRandomSign(), testRandomSign()};
+    g->playerPaddlePosition.y = testRandomBetween(0, screenHeight - paddleLength);
+    g->aiPaddlePosition.y = testRandomBetween(0, screenHeight - paddleLength);
+    g->lastScore = (int) (testRandom() & 1);
+}
+
+//Ball in open field, nothing to hit within the next frame
+static void makeRally(Distribution* d){
+    d->name = "rally";
+    for (int i = 0; i < benchStates; i++) {
+        randomState(&d->states[i]);
+        d->states[i].ballPosition.x = testRandomBetween(400, screenWidth - 400);
+        d->states[i].ballPosition.y = testRandomBetween(100, screenHeight - 200);
+    }
+}
+
+//Ball about to bounce off the top or bottom wall
+static void makeWallHits(Distribution* d){
+    d->name = "wall";
+    for (int i = 0; i < benchStates; i++) {
+        Global* g = &d->states[i];
+        randomState(g);
+        g->ballPosition.x = testRandomBetween(400, screenWidth - 400);
+        if (testRandom() & 1) {
+            g->ballPosition.y = testRandomBetween(10, 10 + g->ballSpeed);
+            g->ballDirection.y = -1;
+        } else {
+            g->ballPosition.y = testRandomBetween(ballMaxY - g->ballSpeed, ballMaxY);
+            g->ballDirection.y = 1;
+        }
+    }
+}
+
+//Ball about to hit the face of either paddle
+static void makePaddleHits(Distribution* d){
+    d->name = "paddle";
+    for (int i = 0; i < benchStates; i++) {
+        Global* g = &d->states[i];
+        randomState(g);
+        const Point* paddle;
+        if (testRandom() & 1) {
+            paddle = &g->aiPaddlePosition;
+            g->ballPosition.x = paddle->x + paddleWidth + testRandomBetween(0, g->ballSpeed - 1);
+            g->ballDirection.x = -1;
+        } else {
+            paddle = &g->playerPaddlePosition;
+            g->ballPosition.x = paddle->x - ballSideLength - testRandomBetween(0, g->ballSpeed - 1);
+            g->ballDirection.x = 1;
+        }
+        g->ballPosition.y = paddle->y + testRandomBetween(0, paddleLength - ballSideLength);
+    }
+}
+
+//Ball about to leave the field through a goal, paddles out of the way
+static void makeGoals(Distribution* d){
+    d->name = "goal";
+    for (int i = 0; i < benchStates; i++) {
+        Global* g = &d->states[i];
+        randomState(g);
+        g->ballPosition.y = testRandomBetween(goalTop, goalBottom - ballSideLength);
+        g->playerPaddlePosition.y = g->ballPosition.y > screenHeight / 2 ? 0 : screenHeight - paddleLength;
+        g->aiPaddlePosition.y = g->playerPaddlePosition.y;
+        if (testRandom() & 1) {
+            g->ballPosition.x = testRandomBetween(0, g->ballSpeed - 1);
+            g->ballDirection.x = -1;
+        } else {
+            g->ballPosition.x = testRandomBetween(ballMaxX - g->ballSpeed + 1, ballMaxX);
+            g->ballDirection.x = 1;
+        }
+    }
+}
+
+//Rally, wall, paddle and goal states shuffled together, so no outcome is predictable from the last
+static void makeMixed(Distribution* d, const Distribution* const* sources, int sourceCount){
+    d->name = "mixed";
+    for (int i = 0; i < benchStates; i++) {
+        const Distribution* source = sources[testRandom() % (unsigned int) sourceCount];
+        d->states[i] = source->states[testRandom() & (benchStates - 1)];
+    }
+}
+
+//Every tick of whole matches, the player paddle following the ball on its half
+static void makeMatches(Distribution* d){
+    d->name = "match";
+    Global g;
+    simInitGlobals(&g);
+    int stride = 7; //keep one tick in stride, so the pool spans several matches
+    long tick = 0;
+    for (int i = 0; i < benchStates; tick++) {
+        if (g.gameOver) {
+            simInitGlobals(&g);
+            g.ballDirection.y = testRandomSign();
+        }
+        int center = g.playerPaddlePosition.y + paddleLength / 2;
+        int target = g.ballPosition.y + ballSideLength / 2;
+        if (g.ballPosition.x >= screenWidth / 2 && center != target) {
+            g.playerPaddlePosition.y += center < target ? 4 : -4;
+        }
+        if (tick % stride == 0) {
+            d->states[i++] = g;
+        }
+        simGameLogic(&g);
+    }
+}
+
+//Anywhere on the field with any score, the score squares make the draw cost depend on the score
+static void makeScores(Distribution* d){
+    d->name = "scores";
+    for (int i = 0; i < benchStates; i++) {
+        randomState(&d->states[i]);
+        d->states[i].ballPosition.x = testRandomBetween(0, ballMaxX);
+        d->states[i].ballPosition.y = testRandomBetween(10, ballMaxY);
+        d->states[i].playerScore = testRandomBetween(0, winningScore);
+        d->states[i].aiScore = testRandomBetween(0, winningScore);
+    }
+}
+
+static Distribution rally, wall, paddle, goal, mixed, match, scores;
+
+//Scene builders that take no state, wrapped to the common signature
+static void sceneWallsWrapper(Scene* scene, const Global* g){
+    (void) g;
+    sceneWalls(scene);
+}
+
+static void sceneFrame(Scene* scene, const Global* g){
+    sceneWalls(scene);
+    scenePaddles(scene, g);
+    sceneBall(scene, g);
+    sceneScore(scene, g);
+}
+
+static const Benchmark benchmarks[] = {
+    {.name = "updateBall/rally", .kind = KIND_ASM, .asmFunction = updateBall, .states = &rally},
+    {.name = "updateBall/wall", .kind = KIND_ASM, .asmFunction = updateBall, .states = &wall},
+    {.name = "updateBall/paddle", .kind = KIND_ASM, .asmFunction = updateBall, .states = &paddle},
+    {.name = "updateBall/goal", .kind = KIND_ASM, .asmFunction = updateBall, .states = &goal},
+    {.name = "updateBall/match", .kind = KIND_ASM, .asmFunction = updateBall, .states = &match},
+    {.name = "simUpdateBall/rally", .kind = KIND_SIM, .simFunction = simUpdateBall, .states = &rally},
+    {.name = "simUpdateBall/wall", .kind = KIND_SIM, .simFunction = simUpdateBall, .states = &wall},
+    {.name = "simUpdateBall/paddle", .kind = KIND_SIM, .simFunction = simUpdateBall, .states = &paddle},
+    {.name = "simUpdateBall/goal", .kind = KIND_SIM, .simFunction = simUpdateBall, .states = &goal},
+    {.name = "simUpdateBall/match", .kind = KIND_SIM, .simFunction = simUpdateBall, .states = &match},
+    {.name = "updateBall/mixed", .kind = KIND_ASM, .asmFunction = updateBall, .states = &mixed},
+    {.name = "simUpdateBall/mixed", .kind = KIND_SIM, .simFunction = simUpdateBall, .states = &mixed},
+    {.name = "simUpdateBallBranchless/rally", .kind = KIND_SIM, .simFunction = simUpdateBallBranchless, .states = &rally},
+    {.name = "simUpdateBallBranchless/wall", .kind = KIND_SIM, .simFunction = simUpdateBallBranchless, .states = &wall},
+    {.name = "simUpdateBallBranchless/paddle", .kind = KIND_SIM, .simFunction = simUpdateBallBranchless, .states = &paddle},
+    {.name = "simUpdateBallBranchless/goal", .kind = KIND_SIM, .simFunction = simUpdateBallBranchless, .states = &goal},
+    {.name = "simUpdateBallBranchless/mixed", .kind = KIND_SIM, .simFunction = simUpdateBallBranchless, .states = &mixed},
+    {.name = "simUpdateBallBranchless/match", .kind = KIND_SIM, .simFunction = simUpdateBallBranchless, .states = &match},
+    {.name = "simUpdateBallSwept/match", .kind = KIND_SIM, .simFunction = simUpdateBallSwept, .states = &match},
+    {.name = "updateAI/match", .kind = KIND_ASM, .asmFunction = updateAI, .states = &match},
+    {.name = "updateAI/rally", .kind = KIND_ASM, .asmFunction = updateAI, .states = &rally},
+    {.name = "simUpdateAI/match", .kind = KIND_SIM, .simFunction = simUpdateAI, .states = &match},
+    {.name = "gameLogic/match", .kind = KIND_ASM, .asmFunction = gameLogic, .states = &match},
+    {.name = "gameLogic/goal", .kind = KIND_ASM, .asmFunction = gameLogic, .states = &goal},
+    {.name = "simGameLogic/match", .kind = KIND_SIM, .simFunction = simGameLogic, .states = &match},
+    {.name = "simGameLogic/goal", .kind = KIND_SIM, .simFunction = simGameLogic, .states = &goal},
+    {.name = "simGameLogicBranchless/match", .kind = KIND_SIM, .simFunction = simGameLogicBranchless, .states = &match},
+    {.name = "simGameLogicBranchless/goal", .kind = KIND_SIM, .simFunction = simGameLogicBranchless, .states = &goal},
+    {.name = "resetBall/goal", .kind = KIND_ASM, .asmFunction = resetBall, .states = &goal},
+    {.name = "simResetBall/goal", .kind = KIND_SIM, .simFunction = simResetBall, .states = &goal},
+    {.name = "physics/asm/match", .kind = KIND_PHYSICS, .states = &match, .physics = "asm"},
+    {.name = "physics/c/match", .kind = KIND_PHYSICS, .states = &match, .physics = "c"},
+    {.name = "physics/branchless/match", .kind = KIND_PHYSICS, .states = &match, .physics = "branchless"},
+    {.name = "physics/avx512/match", .kind = KIND_PHYSICS, .states = &match, .physics = "avx512"},
+    {.name = "physics/avx2/match", .kind = KIND_PHYSICS, .states = &match, .physics = "avx2"},
+    {.name = "physics/sse4.1/match", .kind = KIND_PHYSICS, .states = &match, .physics = "sse4.1"},
+    {.name = "drawWalls/cpu", .kind = KIND_SCENE, .sceneFunction = sceneWallsWrapper, .states = &match},
+    {.name = "drawPaddle/cpu", .kind = KIND_SCENE, .sceneFunction = scenePaddles, .states = &match},
+    {.name = "drawBall/cpu", .kind = KIND_SCENE, .sceneFunction = sceneBall, .states = &match},
+    {.name = "drawScore/cpu", .kind = KIND_SCENE, .sceneFunction = sceneScore, .states = &scores},
+    {.name = "draw/cpu", .kind = KIND_SCENE, .sceneFunction = sceneFrame, .states = &scores}
+};
+#define benchmarkCount ((int) (sizeof(benchmarks) / sizeof(benchmarks[0])))
+
+static volatile int sink; //results feed into this so no call can be optimized away
+
+//Runs ops calls of the benchmark over its states, returns the elapsed ns and sets *cycles and *misses
+static double runSample(const Benchmark* b, int ops, unsigned long long* cycles, long long* misses){
+    const Global* states = b->states->states;
+    Global scratch;
+    static Global chunk[benchPhysicsChunk];
+    Scene scene;
+    int check = 0;
+    startBranchMisses();
+    double start = nowNanoseconds();
+    unsigned long long startCycles = readCycles();
+    switch (b->kind) {
+        case KIND_ASM:
+            for (int i = 0; i < ops; i++) {
+                global = states[i & (benchStates - 1)];
+                b->asmFunction();
+                check += global.ballPosition.x;
+            }
+            break;
+        case KIND_SIM:
+            for (int i = 0; i < ops; i++) {
+                scratch = states[i & (benchStates - 1)];
+                b->simFunction(&scratch);
+                check += scratch.ballPosition.x;
+            }
+            break;
+        case KIND_SCENE:
+            for (int i = 0; i < ops; i++) {
+                sceneClear(&scene);
+                b->sceneFunction(&scene, &states[i & (benchStates - 1)]);
+                check += scene.vertexCount;
+            }
+            break;
+        case KIND_PHYSICS:
+            for (int i = 0; i < ops; i += benchPhysicsChunk) {
+                int count = ops - i < benchPhysicsChunk ? ops - i : benchPhysicsChunk;
+                memcpy(chunk, &states[i & (benchStates - 1)], sizeof(Global) * (size_t) count);
+                physicsBackend()->step(chunk, count);
+                check += chunk[0].ballPosition.x;
+            }
+            break;
+    }
+    *cycles = readCycles() - startCycles;
+    double elapsed = nowNanoseconds() - start;
+    *misses = stopBranchMisses();
+    sink += check;
+    return elapsed;
+}
+
+static int compareDoubles(const void* a, const void* b){
+    double x = *(const double*) a, y = *(const double*) b;
+    return (x > y) - (x < y);
+}
+
+//Sorts values in place
+static Summary summarize(double* values, int count){
+    Summary s;
+    double sum = 0.0;
+    for (int i = 0; i < count; i++) {
+        sum += values[i];
+    }
+    s.mean = sum / count;
+    double squares = 0.0;
+    for (int i = 0; i < count; i++) {
+        squares += (values[i] - s.mean) * (values[i] - s.mean);
+    }
+    s.variance = count > 1 ? squares / (count - 1) : 0.0;
+    s.stddev = sqrt(s.variance);
+    qsort(values, (size_t) count, sizeof(double), compareDoubles);
+    s.min = values[0];
+    s.median = count % 2 ? values[count / 2] : 0.5 * (values[count / 2 - 1] + values[count / 2]);
+    return s;
+}
+
+static void printSummary(FILE* out, const char* name, const Summary* s){
+    fprintf(out, "\"%s\": {\"mean\": %.4f, \"median\": %.4f, \"min\": %.4f, \"stddev\": %.4f, \"variance\": %.6f}",
+            name, s->mean, s->median, s->min, s->stddev, s->variance);
+}
+
+static void printUsage(const char* name){
+    fprintf(stderr, "usage: %s [--samples N] [--ops N] [--filter TEXT] [--out FILE]\n", name);
+}
+
+int main(int argc, char **argv)
+{
+    int samples = 31;
+    int ops = 1 << 16;
+    const char* filter = NULL;
+    const char* outPath = NULL;
+    for (int i = 1; i < argc; i++) {
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (value == NULL) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        if (strcmp(argv[i], "--samples") == 0) {
+            samples = atoi(value);
+        } else if (strcmp(argv[i], "--ops") == 0) {
+            ops = atoi(value);
+        } else if (strcmp(argv[i], "--filter") == 0) {
+            filter = value;
+        } else if (strcmp(argv[i], "--out") == 0) {
+            outPath = value;
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+        i++;
+    }
+    if (samples < 2 || ops < 1) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    FILE* out = outPath != NULL ? fopen(outPath, "w") : stdout;
+    double* nanoseconds = malloc(sizeof(double) * (size_t) samples);
+    double* cycles = malloc(sizeof(double) * (size_t) samples);
+    double* misses = malloc(sizeof(double) * (size_t) samples);
+    if (out == NULL || nanoseconds == NULL || cycles == NULL || misses == NULL) {
+        fprintf(stderr, "pong_bench: cannot write %s\n", outPath != NULL ? outPath : "results");
+        return 1;
+    }
+
+    makeRally(&rally);
+    makeWallHits(&wall);
+    makePaddleHits(&paddle);
+    makeGoals(&goal);
+    const Distribution* const outcomes[] = {&rally, &wall, &paddle, &goal};
+    makeMixed(&mixed, outcomes, 4);
+    makeMatches(&match);
+    makeScores(&scores);
+
+    fprintf(out, "{\n  \"samples\": %d,\n  \"ops_per_sample\": %d,\n  \"states_per_distribution\": %d,\n",
+            samples, ops, benchStates);
+    //virtual machines and perf_event_paranoid often hide the counters, branch misses are then null
+    branchMissCounter = openBranchMissCounter();
+    fprintf(out, "  \"cycles\": \"%s\",\n  \"branch_misses\": \"%s\",\n  \"results\": [", benchHasTsc ? "tsc" : "none",
+            branchMissCounter >= 0 ? "perf" : "none");
+    int printed = 0;
+    for (int b = 0; b < benchmarkCount; b++) {
+        const Benchmark* benchmark = &benchmarks[b];
+        if (filter != NULL && strstr(benchmark->name, filter) == NULL) {
+            continue;
+        }
+        //backends the CPU cannot run are left out of the report
+        if (benchmark->kind == KIND_PHYSICS && physicsSelect(benchmark->physics) != 0) {
+            continue;
+        }
+        //one untimed sample warms caches and branch predictors
+        unsigned long long sampleCycles;
+        long long sampleMisses;
+        runSample(benchmark, ops, &sampleCycles, &sampleMisses);
+        for (int s = 0; s < samples; s++) {
+            nanoseconds[s] = runSample(benchmark, ops, &sampleCycles, &sampleMisses) / ops;
+            cycles[s] = (double) sampleCycles / ops;
+            misses[s] = (double) sampleMisses / ops;
+        }
+        Summary time = summarize(nanoseconds, samples);
+        Summary cost = summarize(cycles, samples);
+        Summary mispredicted = summarize(misses, samples);
+        fprintf(out, "%s\n    {\"name\": \"%s\", \"states\": \"%s\", \"ns_per_op\": %.4f, \"cycles_per_op\": %.4f,",
+                printed++ ? "," : "", benchmark->name, benchmark->states->name, time.median, cost.median);
+        if (branchMissCounter >= 0) {
+            fprintf(out, " \"branch_misses_per_op\": %.4f,\n      ", mispredicted.median);
+        } else {
+            fprintf(out, " \"branch_misses_per_op\": null,\n      ");
+        }
+        printSummary(out, "ns", &time);
+        fprintf(out, ",\n      ");
+        printSummary(out, "cycles", &cost);
+        if (branchMissCounter >= 0) {
+            fprintf(out, ",\n      ");
+            printSummary(out, "branch_misses", &mispredicted);
+        }
+        fprintf(out, "}");
+        fflush(out);
+    }
+    fprintf(out, "\n  ]\n}\n");
+
+    free(nanoseconds);
+    free(cycles);
+    free(misses);
+    if (branchMissCounter >= 0) {
+        close(branchMissCounter);
+    }
+    if (out != stdout) {
+        fclose(out);
+    }
+    return 0;
+}
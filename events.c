@@ -0,0 +1,153 @@
+// Event-driven simulation, see events.h
+// Within a quiet stretch every quantity the rules branch on is linear in the frame number:
+// the ball moves by ballSpeed on both axes and each paddle by a fixed step whose sign only
+// changes once its target is reached. So the first frame at which any branch would go the
+// other way is found with a division per condition.
+
+#include <limits.h>
+#include "events.h"
+
+#define EVENT_NEVER LONG_MAX
+
+static int sign(long value){
+    return (value > 0) - (value < 0);
+}
+
+//First j >= 0 for which start + j * rate leaves [low, high]
+static long firstOutside(long start, long rate, long low, long high){
+    if (start < low || start > high) {
+        return 0;
+    }
+    if (rate > 0) {
+        return high == EVENT_NEVER ? EVENT_NEVER : (high - start) / rate + 1;
+    }
+    if (rate < 0) {
+        return low == -EVENT_NEVER ? EVENT_NEVER : (start - low) / -rate + 1;
+    }
+    return EVENT_NEVER;
+}
+
+//First j >= 0 for which the sign of start + j * rate differs from the sign of start
+static long firstSignChange(long start, long rate){
+    if (start > 0) {
+        return firstOutside(start, rate, 1, EVENT_NEVER);
+    }
+    if (start < 0) {
+        return firstOutside(start, rate, -EVENT_NEVER, -1);
+    }
+    return firstOutside(start, rate, 0, 0);
+}
+
+//First j >= 0 for which position + j * rate is on the other side of edge (the side of
+//position >= edge versus position < edge)
+static long firstSideChange(long position, long rate, long edge){
+    if (position >= edge) {
+        return firstOutside(position, rate, edge, EVENT_NEVER);
+    }
+    return firstOutside(position, rate, -EVENT_NEVER, edge - 1);
+}
+
+static long minTicks(long a, long b){
+    return a < b ? a : b;
+}
+
+//Narrows [low, high] to the free flight around x that does not touch the paddle's columns,
+//returns -1 if x is in them
+static int clipPaddleColumns(long x, Point paddle, long* low, long* high){
+    long left = paddle.x - ballSideLength + 1;
+    long right = paddle.x + paddleWidth - 1;
+    if (x > right) {
+        if (right + 1 > *low) {
+            *low = right + 1;
+        }
+    } else if (x < left) {
+        if (left - 1 < *high) {
+            *high = left - 1;
+        }
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+long eventQuietTicks(const Global* g, int playerSpeed){
+    if (g->gameOver || g->playerScore == winningScore || g->aiScore == winningScore) {
+        return 0;
+    }
+    long vx = (long) g->ballSpeed * g->ballDirection.x;
+    long vy = (long) g->ballSpeed * g->ballDirection.y;
+    long x0 = g->ballPosition.x;
+    long y0 = g->ballPosition.y;
+    long x1 = x0 + vx; //after this frame's updateBall
+    long y1 = y0 + vy;
+
+    //updateBall: no goal line, wall or paddle column is reached
+    long low = 10;
+    long high = ballMaxX;
+    if (clipPaddleColumns(x1, g->playerPaddlePosition, &low, &high) != 0
+        || clipPaddleColumns(x1, g->aiPaddlePosition, &low, &high) != 0) {
+        return 0;
+    }
+    long quiet = firstOutside(x1, vx, low, high);
+    quiet = minTicks(quiet, firstOutside(y1, vy, 10, ballMaxY));
+
+    //player input: simTrackPaddle, which runs on the right half and steps towards the ball's centre
+    if (playerSpeed > 0) {
+        quiet = minTicks(quiet, firstSideChange(x0, vx, screenWidth / 2));
+        if (x0 >= screenWidth / 2) {
+            long diff = y0 + ballSideLength / 2 - (g->playerPaddlePosition.y + paddleLength / 2);
+            quiet = minTicks(quiet, firstSignChange(diff, vy - sign(diff) * playerSpeed));
+        }
+    }
+
+    //updateAI: runs on the left half after the ball moved and steps towards the ball's top
+    quiet = minTicks(quiet, firstSideChange(x1, vx, screenWidth / 2));
+    if (x1 < screenWidth / 2) {
+        long diff = y1 - g->aiPaddlePosition.y;
+        quiet = minTicks(quiet, firstSignChange(diff, vy - sign(diff) * aiPaddleSpeed));
+    }
+    return quiet;
+}
+
+//Skips ticks quiet frames, which eventQuietTicks guaranteed to be plain flight
+static void skipQuietTicks(Global* g, long ticks, int playerSpeed){
+    long vy = (long) g->ballSpeed * g->ballDirection.y;
+    long x0 = g->ballPosition.x;
+    long x1 = x0 + (long) g->ballSpeed * g->ballDirection.x;
+
+    //simTrackPaddle taken ticks times, the step's sign cannot change within quiet ticks
+    if (playerSpeed > 0 && x0 >= screenWidth / 2) {
+        long diff = g->ballPosition.y + ballSideLength / 2 - (g->playerPaddlePosition.y + paddleLength / 2);
+        g->playerPaddlePosition.y += (int) (ticks * sign(diff) * playerSpeed);
+    }
+    if (x1 < screenWidth / 2) {
+        long diff = g->ballPosition.y + vy - g->aiPaddlePosition.y;
+        g->aiPaddlePosition.y += (int) (ticks * sign(diff) * aiPaddleSpeed);
+    }
+    g->ballPosition.x += (int) (ticks * g->ballSpeed * g->ballDirection.x);
+    g->ballPosition.y += (int) (ticks * vy);
+}
+
+//One frame the slow way: the track policy's mouse event, then simGameLogic
+static void stepFrame(Global* g, int playerSpeed){
+    if (playerSpeed > 0) {
+        g->playerPaddlePosition.y = simTrackPaddle(g, g->playerPaddlePosition.y, playerSpeed,
+                                                   g->ballPosition.x >= screenWidth / 2);
+    }
+    simGameLogic(g);
+}
+
+long eventAdvance(Global* g, long maxTicks, int playerSpeed){
+    long ticks = 0;
+    while (!g->gameOver && ticks < maxTicks) {
+        long quiet = minTicks(eventQuietTicks(g, playerSpeed), maxTicks - ticks);
+        if (quiet > 0) {
+            skipQuietTicks(g, quiet, playerSpeed);
+            ticks += quiet;
+        } else {
+            stepFrame(g, playerSpeed);
+            ticks++;
+        }
+    }
+    return ticks;
+}
@@ -0,0 +1,20 @@
+// Event-driven simulation
+// Plays the simGameLogic rules without stepping through straight-line flight: the number of
+// frames until the next event (a wall bounce, a goal or paddle plane, the ball crossing the
+// middle line or a paddle reaching its target) is computed analytically and skipped in one go.
+// The events themselves run through simGameLogic, so the result is identical to tick stepping.
+
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include "pong.h"
+
+//Advances g by up to maxTicks frames, stopping once the game is over, and returns the number
+//of frames played. Before each frame the player paddle follows the headless track policy at
+//playerSpeed pixels per frame (0 = idle), like a mouse event before gameLogic.
+long eventAdvance(Global* g, long maxTicks, int playerSpeed);
+
+//Frames from now that are certain to be plain flight, 0 if the next frame is an event
+long eventQuietTicks(const Global* g, int playerSpeed);
+
+#endif
@@ -0,0 +1,177 @@
+// Sub-pixel rules tests
+// Plays the same matches at several tick rates with the C rules, the branchless rules and every
+// batch kernel the CPU supports, which all have to stay bit for bit identical tick by tick, and at
+// 60 Hz against the assembly rules as well. Then checks that the ball covers the same distance in
+// the same game time at every rate, with both the stepped and the swept rules. Exits non-zero on
+// the first failure.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "batch.h"
+#include "testutil.h"
+
+#define testLanes 64
+#define testSeconds 90 //game time per match, most of them finish before it
+#define trackSpeed 12 //player paddle pixels per tick
+
+static const int tickRates[] = {60, 20, 30, 50, 120, 144, 240, 1000};
+#define tickRateCount ((int) (sizeof(tickRates) / sizeof(tickRates[0])))
+
+static const char* const kernelNames[] = {"scalar", "sse4.1", "avx2", "avx512"};
+#define kernelCount ((int) (sizeof(kernelNames) / sizeof(kernelNames[0])))
+
+//A fresh match with the ball somewhere along the centre line, so the lanes take different paths
+static void startState(Global* g, int lane, int tickRate){
+    simInitGlobals(g);
+    g->tickScale = simTickScale(tickRate);
+    g->ballPosition.y = testRandomBetween(100, 899);
+    g->ballDirection.x = lane & 1 ? 1 : -1;
+    g->ballDirection.y = lane & 2 ? 1 : -1;
+    g->lastScore = lane & 1;
+}
+
+//The batch kernel's trackPlayer, one tick of simTrackPaddle for the player
+static void trackPlayer(Global* g){
+    if (!g->gameOver) {
+        g->playerPaddlePosition.y = simTrackPaddle(g, g->playerPaddlePosition.y, trackSpeed,
+                                                   g->ballPosition.x >= screenWidth / 2);
+    }
+}
+
+static int differs(const char* name, int tickRate, int lane, long tick, const Global* expected, const Global* actual){
+    if (memcmp(expected, actual, sizeof(Global)) == 0) {
+        return 0;
+    }
+    fprintf(stderr, "fixed_test: %s differs from the C rules at %d Hz, lane %d, tick %ld\n", name, tickRate, lane, tick);
+    testPrintState("c", expected);
+    testPrintState(name, actual);
+    return 1;
+}
+
+//C, branchless and batch lanes side by side for one tick rate
+static int compareBackends(int tickRate, long* ticksPlayed){
+    Global reference[testLanes], branchless[testLanes];
+    MatchBatch batches[kernelCount];
+    int supported[kernelCount];
+    for (int lane = 0; lane < testLanes; lane++) {
+        startState(&reference[lane], lane, tickRate);
+        branchless[lane] = reference[lane];
+    }
+    for (int k = 0; k < kernelCount; k++) {
+        supported[k] = batchKernelsSupported(kernelNames[k]);
+        if (batchInit(&batches[k], testLanes) != 0) {
+            fprintf(stderr, "fixed_test: out of memory\n");
+            exit(1);
+        }
+        batches[k].tickScale = simTickScale(tickRate);
+        for (int lane = 0; lane < testLanes; lane++) {
+            batchLoad(&batches[k], lane, &reference[lane]);
+        }
+    }
+
+    int failed = 0;
+    long ticks = (long) testSeconds * tickRate;
+    for (long tick = 1; tick <= ticks && !failed; tick++) {
+        int finished = 0;
+        for (int lane = 0; lane < testLanes; lane++) {
+            trackPlayer(&reference[lane]);
+            simGameLogic(&reference[lane]);
+            trackPlayer(&branchless[lane]);
+            simGameLogicBranchless(&branchless[lane]);
+            failed |= differs("branchless", tickRate, lane, tick, &reference[lane], &branchless[lane]);
+            finished += reference[lane].gameOver != 0;
+        }
+        for (int k = 0; k < kernelCount && !failed; k++) {
+            if (!supported[k]) {
+                continue;
+            }
+            batchTrackPlayer(&batches[k], trackSpeed);
+            batchGameLogicWith(&batches[k], kernelNames[k]);
+            for (int lane = 0; lane < testLanes && !failed; lane++) {
+                Global stored;
+                batchStore(&batches[k], lane, &stored);
+                failed |= differs(kernelNames[k], tickRate, lane, tick, &reference[lane], &stored);
+            }
+        }
+        *ticksPlayed += testLanes;
+        if (finished == testLanes) {
+            break;
+        }
+    }
+    for (int k = 0; k < kernelCount; k++) {
+        batchFree(&batches[k]);
+    }
+    return failed ? -1 : 0;
+}
+
+//At 60 Hz the sub-pixel rules have to play exactly like the assembly
+static int compareAssembly(){
+    for (int lane = 0; lane < testLanes; lane++) {
+        Global reference;
+        startState(&reference, lane, 60);
+        global = reference;
+        for (long tick = 1; tick <= testSeconds * 60L && !reference.gameOver; tick++) {
+            trackPlayer(&reference);
+            simGameLogic(&reference);
+            trackPlayer(&global);
+            gameLogic();
+            global.tickScale = reference.tickScale;
+            if (differs("asm", 60, lane, tick, &reference, &global)) {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+//Game seconds until the ball served from the centre has moved distance pixels to the right
+static double secondsToCover(int tickRate, int distance, void (*rules)(Global*)){
+    Global g;
+    simInitGlobals(&g);
+    g.tickScale = simTickScale(tickRate);
+    //parked out of the ball's way
+    g.playerPaddlePosition.y = screenHeight;
+    long tick = 0;
+    while (g.ballPosition.x < initialBallPosition.x + distance) {
+        rules(&g);
+        tick++;
+    }
+    return (double) tick / tickRate;
+}
+
+//The ball has to arrive within a tick of the 60 Hz time, at every rate and with either rules
+static int compareSpeeds(){
+    void (*const rules[])(Global*) = {simGameLogic, simGameLogicBranchless, simGameLogicSwept};
+    const char* const names[] = {"c", "branchless", "swept"};
+    const int distance = 600;
+    for (int r = 0; r < 3; r++) {
+        double expected = secondsToCover(60, distance, rules[r]);
+        for (int i = 0; i < tickRateCount; i++) {
+            double seconds = secondsToCover(tickRates[i], distance, rules[r]);
+            double slack = 1.0 / tickRates[i] + 1.0 / 60;
+            if (seconds < expected - slack || seconds > expected + slack) {
+                fprintf(stderr, "fixed_test: %s rules cover %d pixels in %.3f s at %d Hz but %.3f s at 60 Hz\n",
+                        names[r], distance, seconds, tickRates[i], expected);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+int main(){
+    testSeed(2463534242u);
+    long ticks = 0;
+    for (int i = 0; i < tickRateCount; i++) {
+        if (compareBackends(tickRates[i], &ticks) != 0) {
+            return 1;
+        }
+    }
+    if (compareAssembly() != 0 || compareSpeeds() != 0) {
+        return 1;
+    }
+    printf("fixed_test: %ld match ticks at %d tick rates agree on every backend, speeds match 60 Hz\n", ticks,
+           tickRateCount);
+    return 0;
+}
@@ -0,0 +1,954 @@
+// Headless simulation mode
+// Drives gameLogic (and through it updateBall/updateAI) in a tight loop.
+// The player paddle is moved by a scripted policy instead of the mouse.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "pong.h"
+#include "batch.h"
+#include "physics.h"
+#include "events.h"
+#include "replay.h"
+#include "rollback.h"
+#include "netclient.h"
+#include "spectator.h"
+#include "timestep.h"
+#include "headless.h"
+
+typedef enum PlayerPolicy{
+    PLAYER_TRACK,  //mirror of the AI, follows the ball on the right half
+    PLAYER_RANDOM, //wanders between random targets, seeded
+    PLAYER_IDLE    //never moves
+} PlayerPolicy;
+
+typedef struct HeadlessOptions{
+    long matches;
+    long maxTicks; //per match, matches hitting the cap are counted as aborted
+    PlayerPolicy policy;
+    int playerSpeed; //Pixels/Frame
+    unsigned int seed;
+    int randomServe; //0 = serve from the centre like initGlobals, 1 = random height and direction
+    int batchWidth; //0 = one match at a time through gameLogic, otherwise lanes in the batch engine
+    int check; //replay every batch match through gameLogic and compare
+    const char* batchKernels; //NULL = picked from the CPU features
+    const char* physics; //backend for one match at a time, NULL = the assembly
+    int sweptCollisions; //1 = continuous collision rules (simGameLogicSwept)
+    int events; //1 = skip straight-line flight with the event-driven simulator
+    const char* recordPath; //write every match to this replay file
+    const char* replayPath; //play the matches in this replay file instead
+    int rollbackDelay; //-1 = off, else ticks the remote player's input arrives late
+    int rollbackJitter; //up to this many more ticks of delay, seeded, so inputs also arrive out of order
+    const char* connectAddress; //play the matches on this server instead
+    int bots; //0 = one predicting client per match, else this many simple clients at once for load tests
+    const char* watchAddress; //spectate matches on this server
+    int viewers;
+    int viewerRate; //bytes/sec each viewer asks for, 0 = the server's default
+    int linkRate; //bytes/sec each viewer's emulated link passes, 0 = no limit
+} HeadlessOptions;
+
+typedef struct HeadlessTotals{
+    long playerWins;
+    long aiWins;
+    long aborted;
+    long long ticks;
+} HeadlessTotals;
+
+static unsigned int rngState;
+static int randomTarget = screenHeight / 2; //paddle centre the random policy heads for
+static ReplayWriter* recorder; //NULL unless --record
+
+//How a match ended, kept under --check so the reference runs happen after the timed loop
+typedef struct PlayedMatch{
+    Global state;
+    long ticks;
+    unsigned int rng; //random policy state when the match started
+    int target;
+} PlayedMatch;
+static PlayedMatch* played; //one per match index, NULL unless --check
+
+//xorshift32, good enough for scripted input
+static unsigned int nextRandom(){
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return rngState;
+}
+
+//Moves the player paddle one step towards targetY (paddle centre) and feeds it through mouse()
+static void movePlayerTo(int centerY){
+    mouse(0, centerY);
+    if (recorder != NULL) {
+        replayMouse(recorder, centerY);
+    }
+}
+
+static void movePlayerTowards(int targetY, int speed){
+    int centerY = global.playerPaddlePosition.y + paddleLength / 2;
+    if (centerY < targetY) {
+        centerY += speed;
+    } else if (centerY > targetY) {
+        centerY -= speed;
+    }
+    movePlayerTo(centerY);
+}
+
+//Applies one frame of scripted player input, called before gameLogic like a GLUT motion event
+static void playerInput(const HeadlessOptions* options, long tick){
+    switch (options->policy) {
+        case PLAYER_TRACK:
+            //mouse events only while the ball is on the right half, like the original recordings
+            if (global.ballPosition.x >= screenWidth / 2) {
+                movePlayerTo(simTrackPaddle(&global, global.playerPaddlePosition.y, options->playerSpeed, 1)
+                             + paddleLength / 2);
+            }
+            break;
+        case PLAYER_RANDOM:
+            if (tick % 30 == 0) {
+                randomTarget = (int) (nextRandom() % screenHeight);
+            }
+            movePlayerTowards(randomTarget, options->playerSpeed);
+            break;
+        case PLAYER_IDLE:
+            break;
+    }
+}
+
+//Deterministic per match serve, so a match can be replayed from its index alone
+static void applyServe(const HeadlessOptions* options, long match, Global* g){
+    if (!options->randomServe) {
+        return;
+    }
+    unsigned int h = options->seed * 2654435761u ^ (unsigned int) match * 2246822519u;
+    h ^= h >> 15;
+    h *= 2654435761u;
+    h ^= h >> 13;
+    g->ballPosition.y = 10 + (int) (h % (ballMaxY - 10 + 1));
+    g->ballDirection.x = (h >> 20) & 1 ? 1 : -1;
+    g->ballDirection.y = (h >> 21) & 1 ? 1 : -1;
+}
+
+static void tallyMatch(HeadlessTotals* totals, const Global* g, long ticks){
+    totals->ticks += ticks;
+    if (!g->gameOver) {
+        totals->aborted++;
+    } else if (g->playerScore > g->aiScore) {
+        totals->playerWins++;
+    } else {
+        totals->aiWins++;
+    }
+}
+
+//The assembly gameLogic, the reference the other implementations are checked against
+static void referenceGameLogic(Global* g){
+    (void) g; //always the global state here
+    gameLogic();
+}
+
+//Plays one match on the global state through logic, returns the number of frames
+static long runScalarMatch(const HeadlessOptions* options, long match, void (*logic)(Global*)){
+    initGlobals();
+    applyServe(options, match, &global);
+    if (recorder != NULL) {
+        replayBeginMatch(recorder, &global, 60, options->sweptCollisions, options->seed);
+    }
+    long tick = 0;
+    while (!global.gameOver && tick < options->maxTicks) {
+        playerInput(options, tick);
+        if (recorder != NULL) {
+            replayTick(recorder, &global);
+        }
+        logic(&global);
+        tick++;
+    }
+    if (recorder != NULL) {
+        replayEndMatch(recorder, &global);
+    }
+    return tick;
+}
+
+static void keepPlayed(long match, const Global* g, long ticks, unsigned int rng, int target){
+    if (played != NULL) {
+        played[match] = (PlayedMatch){*g, ticks, rng, target};
+    }
+}
+
+//Replays every kept match through the assembly gameLogic, returns 0 if all ended in the same
+//state. The random policy is rewound to where each match started first.
+static int checkPlayed(const HeadlessOptions* options){
+    int status = 0;
+    for (long match = 0; match < options->matches; match++) {
+        const PlayedMatch* kept = &played[match];
+        rngState = kept->rng;
+        randomTarget = kept->target;
+        long ticks = runScalarMatch(options, match, referenceGameLogic);
+        if (ticks == kept->ticks && memcmp(&global, &kept->state, sizeof(Global)) == 0) {
+            continue;
+        }
+        fprintf(stderr, "headless: match %ld differs, gameLogic %ld ticks %d-%d, checked %ld ticks %d-%d\n",
+                match, ticks, global.playerScore, global.aiScore, kept->ticks,
+                kept->state.playerScore, kept->state.aiScore);
+        status = -1;
+    }
+    return status;
+}
+
+static int runScalar(const HeadlessOptions* options, HeadlessTotals* totals){
+    ReplayWriter writer;
+    if (!options->sweptCollisions) {
+        printf("headless: %s physics\n", physicsBackend()->name);
+    }
+    if (options->recordPath != NULL) {
+        if (replayCreate(&writer, options->recordPath) != 0) {
+            fprintf(stderr, "headless: could not create %s\n", options->recordPath);
+            return -1;
+        }
+        recorder = &writer;
+    }
+    void (*logic)(Global*) = options->sweptCollisions ? simGameLogicSwept : physicsGameLogic;
+    for (long match = 0; match < options->matches; match++) {
+        unsigned int rng = rngState;
+        int target = randomTarget;
+        long ticks = runScalarMatch(options, match, logic);
+        tallyMatch(totals, &global, ticks);
+        keepPlayed(match, &global, ticks, rng, target);
+    }
+    if (recorder != NULL) {
+        recorder = NULL;
+        if (replayClose(&writer) != 0) {
+            fprintf(stderr, "headless: failed to write %s\n", options->recordPath);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+//Plays every match of a replay file as fast as possible and checks the final scores
+static int runReplay(const HeadlessOptions* options, HeadlessTotals* totals){
+    ReplayFile file;
+    if (replayOpen(&file, options->replayPath) != 0) {
+        fprintf(stderr, "headless: could not open %s\n", options->replayPath);
+        return -1;
+    }
+    ReplayMatch match;
+    Global g;
+    long differ = 0;
+    int read;
+    while ((read = replayNextMatch(&file, &match)) == 1) {
+        g = match.initial;
+        long ticks = 0;
+        int played;
+        while ((played = replayStep(&match, &g)) == 1) {
+            ticks++;
+        }
+        if (played < 0) {
+            read = -1;
+            break;
+        }
+        tallyMatch(totals, &g, ticks);
+        if (match.hashMismatch >= 0 || (match.finalPlayerScore >= 0
+            && (g.playerScore != match.finalPlayerScore || g.aiScore != match.finalAiScore))) {
+            differ++;
+        }
+    }
+    replayUnmap(&file);
+    if (read < 0) {
+        fprintf(stderr, "headless: %s is corrupt\n", options->replayPath);
+        return -1;
+    }
+    printf("headless: replayed %s, %ld bytes, %ld matches differ from the recording\n",
+           options->replayPath, (long) file.offset, differ);
+    return differ == 0 ? 0 : -1;
+}
+
+//Jumps from event to event instead of stepping every frame
+static int runEvents(const HeadlessOptions* options, HeadlessTotals* totals){
+    int playerSpeed = options->policy == PLAYER_TRACK ? options->playerSpeed : 0;
+    Global g;
+
+    for (long match = 0; match < options->matches; match++) {
+        simInitGlobals(&g);
+        applyServe(options, match, &g);
+        long ticks = eventAdvance(&g, options->maxTicks, playerSpeed);
+        tallyMatch(totals, &g, ticks);
+        keepPlayed(match, &g, ticks, rngState, randomTarget);
+    }
+    return 0;
+}
+
+//Remote input on its way, delivered at deliverTick
+typedef struct DelayedInput{
+    long tick;
+    long deliverTick;
+    int paddleY;
+} DelayedInput;
+
+//Appends to a growing per tick log, returns -1 if it cannot grow
+static int logInput(int** log, long* capacity, long tick, int value){
+    if (tick >= *capacity) {
+        long grown = *capacity ? *capacity * 2 : 4096;
+        int* bigger = realloc(*log, sizeof(int) * (size_t) grown);
+        if (bigger == NULL) {
+            return -1;
+        }
+        *log = bigger;
+        *capacity = grown;
+    }
+    (*log)[tick] = value;
+    return 0;
+}
+
+//Two players on the rollback engine: the local one's input is applied right away, the remote
+//one's arrives rollbackDelay (+ jitter) ticks late and is predicted until then. Every match is
+//then played again with all inputs on time, which has to end in the same state.
+static int runRollback(const HeadlessOptions* options, HeadlessTotals* totals){
+    int window = options->rollbackDelay + options->rollbackJitter + 1;
+    Rollback live, reference;
+    if (rollbackInit(&live, window + 1, 2, options->sweptCollisions) != 0) {
+        return -1;
+    }
+    if (rollbackInit(&reference, 2, 2, options->sweptCollisions) != 0) {
+        rollbackFree(&live);
+        return -1;
+    }
+    DelayedInput* pending = malloc(sizeof(DelayedInput) * (size_t) window);
+    int* localLog = NULL;
+    int* remoteLog = NULL;
+    long localCapacity = 0, remoteCapacity = 0;
+    int status = pending != NULL ? 0 : -1;
+    long rollbacks = 0, resimulated = 0, differ = 0;
+    double worstAdvance = 0.0, totalAdvance = 0.0;
+
+    for (long match = 0; match < options->matches && status == 0; match++) {
+        Global initial;
+        simInitGlobals(&initial);
+        applyServe(options, match, &initial);
+        rollbackReset(&live, &initial);
+        int count = 0;
+        long tick = 0;
+
+        while (tick < options->maxTicks) {
+            const Global* present = &live.state;
+            if (present->gameOver) {
+                //the remaining late inputs may still change the outcome
+                for (int i = 0; i < count; i++) {
+                    rollbackInput(&live, 1, pending[i].tick, pending[i].paddleY);
+                }
+                count = 0;
+                rollbackSync(&live);
+                if (live.state.gameOver) {
+                    break;
+                }
+            }
+            int localY = simTrackPaddle(present, present->playerPaddlePosition.y, options->playerSpeed,
+                                        present->ballPosition.x >= screenWidth / 2);
+            int remoteY = simTrackPaddle(present, present->aiPaddlePosition.y, aiPaddleSpeed,
+                                         present->ballPosition.x < screenWidth / 2);
+            if (logInput(&localLog, &localCapacity, tick, localY) != 0
+                || logInput(&remoteLog, &remoteCapacity, tick, remoteY) != 0) {
+                status = -1;
+                break;
+            }
+            rollbackInput(&live, 0, tick, localY);
+            int jitter = options->rollbackJitter > 0 ? (int) (nextRandom() % (unsigned int) (options->rollbackJitter + 1)) : 0;
+            pending[count++] = (DelayedInput) {tick, tick + options->rollbackDelay + jitter, remoteY};
+            for (int i = 0; i < count;) {
+                if (pending[i].deliverTick <= tick) {
+                    rollbackInput(&live, 1, pending[i].tick, pending[i].paddleY);
+                    pending[i] = pending[--count];
+                } else {
+                    i++;
+                }
+            }
+
+            double start = timestepNow();
+            rollbackAdvance(&live);
+            double spent = timestepNow() - start;
+            totalAdvance += spent;
+            if (spent > worstAdvance) {
+                worstAdvance = spent;
+            }
+            tick++;
+        }
+
+        //the same inputs, all on time
+        rollbackReset(&reference, &initial);
+        for (long t = 0; t < tick; t++) {
+            rollbackInput(&reference, 0, t, localLog[t]);
+            rollbackInput(&reference, 1, t, remoteLog[t]);
+            rollbackAdvance(&reference);
+        }
+        if (memcmp(&reference.state, &live.state, sizeof(Global)) != 0) {
+            differ++;
+        }
+        rollbacks += live.rollbacks;
+        resimulated += live.resimulated;
+        tallyMatch(totals, &live.state, tick);
+    }
+
+    if (status == 0) {
+        printf("headless: rollback, remote input %d+%d ticks late, %ld rollbacks, %.1f ticks re-simulated each\n",
+               options->rollbackDelay, options->rollbackJitter, rollbacks, rollbacks ? (double) resimulated / rollbacks : 0.0);
+        printf("headless: advance %.2f us mean, %.2f us worst (frame budget %.0f us at 60 Hz)\n",
+               totals->ticks ? totalAdvance * 1e6 / totals->ticks : 0.0, worstAdvance * 1e6, 1e6 / 60.0);
+        printf("headless: %ld matches differ from playing with all inputs on time\n", differ);
+        if (differ != 0) {
+            status = -1;
+        }
+    }
+    free(pending);
+    free(localLog);
+    free(remoteLog);
+    rollbackFree(&live);
+    rollbackFree(&reference);
+    return status;
+}
+
+//Plays the matches on a server in real time at its tick rate, tracking the ball with the
+//predicted state, and reports how often the server corrected the prediction
+static int runNetwork(const HeadlessOptions* options, HeadlessTotals* totals){
+    long corrections = 0, snapshots = 0;
+    long long bytesSent = 0, bytesReceived = 0;
+    double roundTrip = 0.0, elapsed = 0.0;
+
+    for (long match = 0; match < options->matches; match++) {
+        NetClient client;
+        if (netClientConnect(&client, options->connectAddress, options->sweptCollisions) != 0) {
+            fprintf(stderr, "headless: no answer from %s\n", options->connectAddress);
+            return -1;
+        }
+        FixedTimestep step;
+        double start = timestepNow();
+        timestepInit(&step, client.tickRate, 5, start);
+        long tick = 0;
+        while (!netClientState(&client)->gameOver && !client.disconnected && tick < options->maxTicks) {
+            int ticks = timestepAdvance(&step, timestepNow());
+            for (int i = 0; i < ticks; i++) {
+                const Global* g = netClientState(&client);
+                netClientTick(&client, simTrackPaddle(g, g->playerPaddlePosition.y, options->playerSpeed,
+                                                      g->ballPosition.x >= screenWidth / 2));
+                tick++;
+            }
+            double wait = timestepUntilNextTick(&step);
+            struct timespec ts = {(time_t) wait, (long) ((wait - (double) (time_t) wait) * 1e9)};
+            nanosleep(&ts, NULL);
+        }
+        //the end of the match is only certain once the server confirmed it
+        double deadline = timestepNow() + 1.0;
+        while (client.acked < client.prediction.tick && !client.disconnected && timestepNow() < deadline) {
+            struct timespec pause = {0, 1000000};
+            nanosleep(&pause, NULL);
+            netClientReceive(&client);
+        }
+        elapsed += timestepNow() - start;
+        tallyMatch(totals, netClientState(&client), tick);
+        roundTrip += client.roundTrip;
+        corrections += client.corrections;
+        snapshots += client.snapshots;
+        bytesSent += client.bytesSent;
+        bytesReceived += client.bytesReceived;
+        int lost = client.disconnected;
+        netClientClose(&client);
+        if (lost) {
+            fprintf(stderr, "headless: lost the connection to %s\n", options->connectAddress);
+            return -1;
+        }
+    }
+    printf("headless: network, %.3f ms round trip, %ld snapshots, %ld corrections\n",
+           roundTrip * 1e3 / (double) options->matches, snapshots, corrections);
+    printf("headless: %.0f bytes/sec up, %.0f bytes/sec down\n", (double) bytesSent / elapsed, (double) bytesReceived / elapsed);
+    return 0;
+}
+
+//One load test client, it follows the ball with the newest snapshot and does not predict
+typedef struct Bot{
+    int fd;
+    int welcomed;
+    long tick; //newest snapshot tick
+    Global state;
+} Bot;
+
+//Many bots on one server at once for maxTicks of the server's ticks, reports what came back
+static int runBots(const HeadlessOptions* options){
+    struct sockaddr_in server;
+    if (netResolve(options->connectAddress, &server) != 0) {
+        fprintf(stderr, "headless: cannot resolve %s\n", options->connectAddress);
+        return -1;
+    }
+    Bot* bots = calloc((size_t) options->bots, sizeof(Bot));
+    if (bots == NULL) {
+        return -1;
+    }
+    NetPacket packet;
+    memset(&packet, 0, sizeof(packet));
+    int opened = 0;
+    for (; opened < options->bots; opened++) {
+        bots[opened].fd = netOpenSocket(0, 0);
+        if (bots[opened].fd < 0) {
+            fprintf(stderr, "headless: could only open %d sockets\n", opened);
+            break;
+        }
+        simInitGlobals(&bots[opened].state);
+    }
+
+    int tickRate = 60;
+    long snapshots = 0, refused = 0;
+    int welcomed = 0;
+    FixedTimestep step;
+    timestepInit(&step, tickRate, 5, timestepNow());
+    double start = timestepNow();
+    long tick = 0;
+    while (tick < options->maxTicks && opened > 0) {
+        int ticks = timestepAdvance(&step, timestepNow());
+        for (int i = 0; i < opened; i++) {
+            Bot* bot = &bots[i];
+            struct sockaddr_in from;
+            NetPacket reply;
+            while (netReceive(bot->fd, &from, &reply, NULL)) {
+                if (reply.type == NET_WELCOME && !bot->welcomed) {
+                    bot->welcomed = 1;
+                    bot->tick = reply.tick;
+                    welcomed++;
+                    if (reply.tickRate != tickRate && reply.tickRate > 0) {
+                        tickRate = reply.tickRate;
+                        timestepInit(&step, tickRate, 5, timestepNow());
+                    }
+                } else if (reply.type == NET_SNAPSHOT && reply.tick > bot->tick) {
+                    bot->tick = reply.tick;
+                    bot->state = reply.state;
+                    snapshots++;
+                } else if (reply.type == NET_BYE) {
+                    refused++;
+                    bot->welcomed = -1;
+                }
+            }
+            if (ticks == 0 || bot->welcomed < 0) {
+                continue;
+            }
+            if (!bot->welcomed) {
+                packet.type = NET_HELLO;
+                packet.nonce = (unsigned int) i;
+            } else {
+                packet.type = NET_INPUT;
+                packet.tick = bot->tick + 2;
+                packet.inputCount = 1;
+                packet.inputs[0] = simTrackPaddle(&bot->state, bot->state.playerPaddlePosition.y,
+                                                  options->playerSpeed, bot->state.ballPosition.x >= screenWidth / 2);
+            }
+            netSend(bot->fd, &server, &packet);
+        }
+        tick += ticks;
+        double wait = timestepUntilNextTick(&step);
+        struct timespec ts = {(time_t) wait, (long) ((wait - (double) (time_t) wait) * 1e9)};
+        nanosleep(&ts, NULL);
+    }
+    double elapsed = timestepNow() - start;
+
+    packet.type = NET_BYE;
+    for (int i = 0; i < opened; i++) {
+        netSend(bots[i].fd, &server, &packet);
+        close(bots[i].fd);
+    }
+    free(bots);
+    printf("headless: %d bots, %d welcomed, %ld refused, %.0f snapshots/sec, %.1f per bot and second\n",
+           opened, welcomed, refused, snapshots / elapsed, welcomed ? snapshots / elapsed / welcomed : 0.0);
+    return opened == options->bots && refused == 0 ? 0 : -1;
+}
+
+//Viewers spread over the server's matches for maxTicks of its ticks, reports what arrived
+static int runWatch(const HeadlessOptions* options){
+    Spectator* viewers = calloc((size_t) options->viewers, sizeof(Spectator));
+    if (viewers == NULL) {
+        return -1;
+    }
+    int opened = 0;
+    for (; opened < options->viewers; opened++) {
+        if (spectatorConnect(&viewers[opened], options->watchAddress, opened, options->viewerRate) != 0) {
+            fprintf(stderr, "headless: no match to watch on %s after %d viewers\n", options->watchAddress, opened);
+            break;
+        }
+        viewers[opened].linkRate = options->linkRate;
+    }
+    if (opened == 0) {
+        free(viewers);
+        return -1;
+    }
+
+    FixedTimestep step;
+    timestepInit(&step, viewers[0].tickRate, 5, timestepNow());
+    double start = timestepNow();
+    long tick = 0;
+    while (tick < options->maxTicks) {
+        tick += timestepAdvance(&step, timestepNow());
+        for (int i = 0; i < opened; i++) {
+            spectatorReceive(&viewers[i]);
+        }
+        double wait = timestepUntilNextTick(&step);
+        struct timespec ts = {(time_t) wait, (long) ((wait - (double) (time_t) wait) * 1e9)};
+        nanosleep(&ts, NULL);
+    }
+    double elapsed = timestepNow() - start;
+
+    long deltas = 0, keyFrames = 0, bad = 0, dropped = 0, lost = 0;
+    long long down = 0, up = 0;
+    for (int i = 0; i < opened; i++) {
+        deltas += viewers[i].deltas;
+        keyFrames += viewers[i].keyFrames;
+        bad += viewers[i].badDeltas;
+        dropped += viewers[i].dropped;
+        lost += viewers[i].disconnected;
+        down += viewers[i].bytesReceived;
+        up += viewers[i].bytesSent;
+        spectatorClose(&viewers[i]);
+    }
+    free(viewers);
+    printf("headless: %d viewers, %.1f states/sec each, %ld key frames, %ld bad deltas, %ld lost connections\n",
+           opened, (double) deltas / elapsed / opened, keyFrames, bad, lost);
+    printf("headless: %.0f bytes/sec down and %.0f up per viewer, %.1f bytes per state, %ld dropped by the link\n",
+           (double) down / elapsed / opened, (double) up / elapsed / opened,
+           deltas ? (double) down / (double) deltas : 0.0, dropped);
+    return opened == options->viewers && bad == 0 && lost == 0 ? 0 : -1;
+}
+
+//Keeps every lane busy: when a match ends its lane is refilled with the next one
+static int runBatch(const HeadlessOptions* options, HeadlessTotals* totals){
+    int width = options->batchWidth;
+    if (width > options->matches) {
+        width = (int) options->matches;
+    }
+    MatchBatch batch;
+    if (batchInit(&batch, width) != 0) {
+        fprintf(stderr, "headless: could not allocate %d lanes\n", width);
+        return -1;
+    }
+    long* laneMatch = malloc(sizeof(long) * width);
+    long* laneStart = malloc(sizeof(long) * width);
+    if (laneMatch == NULL || laneStart == NULL) {
+        free(laneMatch);
+        free(laneStart);
+        batchFree(&batch);
+        return -1;
+    }
+
+    Global g;
+    long nextMatch = 0;
+    int running = 0;
+    for (int lane = 0; lane < width; lane++) {
+        simInitGlobals(&g);
+        applyServe(options, nextMatch, &g);
+        batchLoad(&batch, lane, &g);
+        laneMatch[lane] = nextMatch++;
+        laneStart[lane] = 0;
+        running++;
+    }
+
+    int idle = 0; //lanes left finished because no matches remain
+    long tick = 0;
+    long deadline = options->maxTicks; //earliest tick at which a running lane hits the cap
+    while (running > 0) {
+        if (options->policy == PLAYER_TRACK) {
+            batchTrackPlayer(&batch, options->playerSpeed);
+        }
+        int over = batchGameLogic(&batch);
+        tick++;
+
+        //the lanes are only scanned when a match ended or hit the tick cap
+        if (over == idle && tick < deadline) {
+            continue;
+        }
+        deadline = tick + options->maxTicks;
+        for (int lane = 0; lane < width; lane++) {
+            if (laneMatch[lane] < 0) {
+                continue;
+            }
+            long ticks = tick - laneStart[lane];
+            if (!batch.gameOver[lane] && ticks < options->maxTicks) {
+                if (laneStart[lane] + options->maxTicks < deadline) {
+                    deadline = laneStart[lane] + options->maxTicks;
+                }
+                continue;
+            }
+            batchStore(&batch, lane, &g);
+            tallyMatch(totals, &g, ticks);
+            keepPlayed(laneMatch[lane], &g, ticks, rngState, randomTarget);
+
+            if (nextMatch < options->matches) {
+                simInitGlobals(&g);
+                applyServe(options, nextMatch, &g);
+                laneMatch[lane] = nextMatch++;
+                laneStart[lane] = tick;
+            } else {
+                //park the lane in a finished state
+                g.playerScore = winningScore;
+                g.gameOver = 1;
+                laneMatch[lane] = -1;
+                running--;
+                idle++;
+            }
+            batchLoad(&batch, lane, &g);
+        }
+    }
+
+    free(laneMatch);
+    free(laneStart);
+    batchFree(&batch);
+    return 0;
+}
+
+static void printUsage(const char* name){
+    fprintf(stderr,
+            "usage: %s --headless [--matches N] [--player track|random|idle]\n"
+            "       [--player-speed N] [--seed N] [--max-ticks N] [--serve center|random]\n"
+            "       [--batch LANES] [--batch-kernels avx512|avx2|sse4.1|scalar] [--events] [--check] [--ccd]\n"
+            "       [--physics " physicsNames "]\n"
+            "       [--record FILE] [--replay FILE] [--rollback DELAY] [--jitter TICKS]\n"
+            "       [--connect HOST[:PORT]] [--bots N]\n"
+            "       [--watch HOST[:PORT]] [--viewers N] [--rate BYTES] [--link BYTES]\n", name);
+}
+
+static int parseOptions(int argc, char **argv, HeadlessOptions* options){
+    options->matches = 1000;
+    options->maxTicks = 1000000;
+    options->policy = PLAYER_TRACK;
+    options->playerSpeed = aiPaddleSpeed;
+    options->seed = 1;
+    options->randomServe = 0;
+    options->batchWidth = 0;
+    options->check = 0;
+    options->batchKernels = NULL;
+    options->physics = NULL;
+    options->sweptCollisions = 0;
+    options->events = 0;
+    options->recordPath = NULL;
+    options->replayPath = NULL;
+    options->rollbackDelay = -1;
+    options->rollbackJitter = 0;
+    options->connectAddress = NULL;
+    options->bots = 0;
+    options->watchAddress = NULL;
+    options->viewers = 1;
+    options->viewerRate = 0;
+    options->linkRate = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (strcmp(arg, "--headless") == 0) {
+            continue;
+        }
+        if (strcmp(arg, "--check") == 0) {
+            options->check = 1;
+            continue;
+        }
+        if (strcmp(arg, "--ccd") == 0) {
+            options->sweptCollisions = 1;
+            continue;
+        }
+        if (strcmp(arg, "--events") == 0) {
+            options->events = 1;
+            continue;
+        }
+        if (value == NULL) {
+            fprintf(stderr, "Unknown or incomplete option: %s\n", arg);
+            return -1;
+        }
+        if (strcmp(arg, "--matches") == 0) {
+            options->matches = atol(value);
+        } else if (strcmp(arg, "--max-ticks") == 0) {
+            options->maxTicks = atol(value);
+        } else if (strcmp(arg, "--player-speed") == 0) {
+            options->playerSpeed = atoi(value);
+        } else if (strcmp(arg, "--seed") == 0) {
+            options->seed = (unsigned int) strtoul(value, NULL, 10);
+        } else if (strcmp(arg, "--batch") == 0) {
+            options->batchWidth = atoi(value);
+        } else if (strcmp(arg, "--record") == 0) {
+            options->recordPath = value;
+        } else if (strcmp(arg, "--replay") == 0) {
+            options->replayPath = value;
+        } else if (strcmp(arg, "--rollback") == 0) {
+            options->rollbackDelay = atoi(value);
+        } else if (strcmp(arg, "--watch") == 0) {
+            options->watchAddress = value;
+        } else if (strcmp(arg, "--viewers") == 0) {
+            options->viewers = atoi(value);
+        } else if (strcmp(arg, "--rate") == 0) {
+            options->viewerRate = atoi(value);
+        } else if (strcmp(arg, "--link") == 0) {
+            options->linkRate = atoi(value);
+        } else if (strcmp(arg, "--bots") == 0) {
+            options->bots = atoi(value);
+        } else if (strcmp(arg, "--connect") == 0) {
+            options->connectAddress = value;
+        } else if (strcmp(arg, "--jitter") == 0) {
+            options->rollbackJitter = atoi(value);
+        } else if (strcmp(arg, "--batch-kernels") == 0) {
+            options->batchKernels = value;
+        } else if (strcmp(arg, "--physics") == 0) {
+            options->physics = value;
+        } else if (strcmp(arg, "--serve") == 0) {
+            if (strcmp(value, "center") == 0) {
+                options->randomServe = 0;
+            } else if (strcmp(value, "random") == 0) {
+                options->randomServe = 1;
+            } else {
+                fprintf(stderr, "Unknown serve: %s\n", value);
+                return -1;
+            }
+        } else if (strcmp(arg, "--player") == 0) {
+            if (strcmp(value, "track") == 0) {
+                options->policy = PLAYER_TRACK;
+            } else if (strcmp(value, "random") == 0) {
+                options->policy = PLAYER_RANDOM;
+            } else if (strcmp(value, "idle") == 0) {
+                options->policy = PLAYER_IDLE;
+            } else {
+                fprintf(stderr, "Unknown player policy: %s\n", value);
+                return -1;
+            }
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", arg);
+            return -1;
+        }
+        i++;
+    }
+
+    if (options->matches <= 0 || options->maxTicks <= 0 || options->playerSpeed < 0 || options->batchWidth < 0) {
+        fprintf(stderr, "Match count and tick cap must be positive, player speed and batch width must not be negative\n");
+        return -1;
+    }
+    if (options->batchKernels != NULL && batchSelectKernels(options->batchKernels) != 0) {
+        fprintf(stderr, "Batch kernels not available on this CPU: %s\n", options->batchKernels);
+        return -1;
+    }
+    //replays, rollback and network runs play on engines of their own, and only the matches played
+    //here are kept for --check
+    int local = options->replayPath == NULL && options->connectAddress == NULL && options->watchAddress == NULL
+                && options->rollbackDelay < 0;
+    if (!local && (options->batchWidth > 0 || options->events || options->physics != NULL)) {
+        fprintf(stderr, "--batch, --events and --physics do not support --replay, --connect, --rollback or --watch\n");
+        return -1;
+    }
+    //the backends step one match at a time, the batch and event engines have their own
+    if (options->physics != NULL && (options->batchWidth > 0 || options->events)) {
+        fprintf(stderr, "--physics does not support --batch or --events\n");
+        return -1;
+    }
+    if (options->physics != NULL && physicsSelect(options->physics) != 0) {
+        fprintf(stderr, "Physics backend unknown or not available on this CPU: %s\n", options->physics);
+        return -1;
+    }
+    //the batch engine only vectorizes the deterministic policies and the original collision rules
+    if (options->batchWidth > 0 && options->policy == PLAYER_RANDOM) {
+        fprintf(stderr, "The random player policy is not supported with --batch\n");
+        return -1;
+    }
+    if (options->batchWidth > 0 && options->sweptCollisions) {
+        fprintf(stderr, "--ccd is not supported with --batch\n");
+        return -1;
+    }
+    //events are only predicted for the deterministic policies and the original collision rules
+    if (options->events && (options->policy == PLAYER_RANDOM || options->sweptCollisions || options->batchWidth > 0)) {
+        fprintf(stderr, "--events does not support the random player policy, --ccd or --batch\n");
+        return -1;
+    }
+    //recording needs every frame's input to go through mouse()
+    if (options->recordPath != NULL && (options->events || options->batchWidth > 0)) {
+        fprintf(stderr, "--record does not support --events or --batch\n");
+        return -1;
+    }
+    if (options->rollbackDelay >= 0 && options->recordPath != NULL) {
+        fprintf(stderr, "--rollback does not support --record\n");
+        return -1;
+    }
+    if (options->connectAddress != NULL && (options->recordPath != NULL || options->rollbackDelay >= 0)) {
+        fprintf(stderr, "--connect does not support --record or --rollback\n");
+        return -1;
+    }
+    if (options->viewers < 1 || options->viewerRate < 0 || options->linkRate < 0) {
+        fprintf(stderr, "--viewers must be positive, --rate and --link must not be negative\n");
+        return -1;
+    }
+    if (options->rollbackJitter < 0) {
+        fprintf(stderr, "--jitter must not be negative\n");
+        return -1;
+    }
+    //one match at a time there is only something to check when it ran on another backend
+    int checkable = local && (options->batchWidth > 0 || options->events
+                              || (!options->sweptCollisions && strcmp(physicsBackend()->name, "asm") != 0));
+    if (options->check && !checkable) {
+        fprintf(stderr, "--check needs --batch, --events or a --physics backend other than asm, without --ccd, "
+                "--replay, --connect, --rollback or --watch\n");
+        return -1;
+    }
+    //xorshift gets stuck on 0
+    if (options->seed == 0) {
+        options->seed = 1;
+    }
+    return 0;
+}
+
+int runHeadless(int argc, char **argv){
+    HeadlessOptions options;
+    if (parseOptions(argc, argv, &options) != 0) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    rngState = options.seed;
+    if (options.check) {
+        played = calloc((size_t) options.matches, sizeof(PlayedMatch));
+        if (played == NULL) {
+            fprintf(stderr, "headless: no memory to keep %ld matches for --check\n", options.matches);
+            return 1;
+        }
+    }
+
+    HeadlessTotals totals = {0, 0, 0, 0};
+    double start = timestepNow();
+    int status;
+    if (options.watchAddress != NULL) {
+        return runWatch(&options) == 0 ? 0 : 1;
+    } else if (options.replayPath != NULL) {
+        status = runReplay(&options, &totals);
+    } else if (options.connectAddress != NULL && options.bots > 0) {
+        return runBots(&options) == 0 ? 0 : 1;
+    } else if (options.connectAddress != NULL) {
+        status = runNetwork(&options, &totals);
+    } else if (options.rollbackDelay >= 0) {
+        status = runRollback(&options, &totals);
+    } else if (options.batchWidth > 0) {
+        status = runBatch(&options, &totals);
+    } else if (options.events) {
+        status = runEvents(&options, &totals);
+    } else {
+        status = runScalar(&options, &totals);
+    }
+    double elapsed = timestepNow() - start;
+    if (elapsed <= 0.0) {
+        elapsed = 1e-9;
+    }
+    int checked = -1;
+    if (played != NULL) {
+        checked = status == 0 ? checkPlayed(&options) : -1;
+        free(played);
+        played = NULL;
+    }
+
+    if (options.batchWidth > 0) {
+        printf("headless: batch engine, %d lanes, %s kernels\n", options.batchWidth, batchBackendName());
+    } else if (options.events) {
+        printf("headless: event-driven\n");
+    }
+    long matches = totals.playerWins + totals.aiWins + totals.aborted;
+    printf("headless: %ld matches, %lld ticks in %.3f s\n", matches, totals.ticks, elapsed);
+    printf("headless: %.0f ticks/sec, %.1f matches/sec\n", (double) totals.ticks / elapsed, (double) matches / elapsed);
+    printf("headless: player won %ld, ai won %ld, aborted %ld\n", totals.playerWins, totals.aiWins, totals.aborted);
+    if (options.check) {
+        printf("headless: check against gameLogic %s\n", checked == 0 ? "passed" : "FAILED");
+        status = checked;
+    }
+    return status == 0 ? 0 : 1;
+}
@@ -0,0 +1,11 @@
+// Headless simulation mode
+// Runs the game rules in a tight loop without GLUT or a window and reports throughput.
+
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+//Parses the headless command line options and runs the requested matches
+//Returns the process exit code
+int runHeadless(int argc, char **argv);
+
+#endif
@@ -0,0 +1,8 @@
+// Entry point of the pong_headless target, which builds without GLUT, GLFW or OpenGL.
+
+#include "headless.h"
+
+int main(int argc, char **argv)
+{
+    return runHeadless(argc, argv);
+}
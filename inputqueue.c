@@ -0,0 +1,38 @@
+// Input queue, see inputqueue.h
+// The producer publishes an event by storing head with release order after writing the slot,
+// the consumer frees the slot the same way with tail, each side reads the other's index with
+// acquire order. A full ring drops the new event rather than make a callback wait for a tick.
+
+#include "inputqueue.h"
+
+void inputQueueInit(InputQueue* queue){
+    atomic_init(&queue->head, 0);
+    atomic_init(&queue->tail, 0);
+    atomic_init(&queue->dropped, 0);
+}
+
+int inputPush(InputQueue* queue, InputKind kind, int value, long long time){
+    unsigned long head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    unsigned long tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+    if (head - tail == inputQueueSize) {
+        atomic_fetch_add_explicit(&queue->dropped, 1, memory_order_relaxed);
+        return -1;
+    }
+    InputEvent* event = &queue->events[head & (inputQueueSize - 1)];
+    event->time = time;
+    event->kind = kind;
+    event->value = value;
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+    return 0;
+}
+
+int inputPop(InputQueue* queue, InputEvent* out){
+    unsigned long tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    unsigned long head = atomic_load_explicit(&queue->head, memory_order_acquire);
+    if (tail == head) {
+        return 0;
+    }
+    *out = queue->events[tail & (inputQueueSize - 1)];
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+    return 1;
+}
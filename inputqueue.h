@@ -0,0 +1,39 @@
+// Input queue
+// Lock-free single producer, single consumer ring of timestamped input events. The GLUT
+// callbacks push what they receive and return, the simulation drains the ring at the start of
+// each tick and applies every event in order, so the rules never see input change mid-tick.
+
+#ifndef INPUTQUEUE_H
+#define INPUTQUEUE_H
+
+#include <stdatomic.h>
+
+#define inputQueueSize 1024 //events between two ticks, a power of two
+
+typedef enum InputKind{
+    INPUT_MOUSE, //value = mouse y
+    INPUT_KEY    //value = key
+} InputKind;
+
+typedef struct InputEvent{
+    long long time; //telemetry clock (ns) when the callback received it
+    InputKind kind;
+    int value;
+} InputEvent;
+
+typedef struct InputQueue{
+    InputEvent events[inputQueueSize];
+    atomic_ulong head; //next slot the producer writes
+    atomic_ulong tail; //next slot the consumer reads
+    atomic_ulong dropped; //events pushed while the ring was full
+} InputQueue;
+
+void inputQueueInit(InputQueue* queue);
+
+//Producer side, returns -1 and counts the event as dropped if the ring is full
+int inputPush(InputQueue* queue, InputKind kind, int value, long long time);
+
+//Consumer side, returns 1 with the oldest event in *out or 0 if the ring is empty
+int inputPop(InputQueue* queue, InputEvent* out);
+
+#endif
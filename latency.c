@@ -0,0 +1,65 @@
+// Input-to-photon latency, see latency.h
+// The input times wait in a ring. Three cursors walk it behind the writer: the inputs before
+// applied were picked up by a tick, those before drawn by a draw, those before presented are done.
+// The simulation side owns written and applied, the render side drawn and presented; applied
+// reaches the render side inside the state snapshot, presented goes back with release order so
+// the simulation only reuses slots the renderer is done with.
+
+#include <stdatomic.h>
+#include "latency.h"
+#include "telemetry.h"
+
+#define latencyRingSize 4096 //inputs waiting for a present, a power of two
+
+static long long inputs[latencyRingSize];
+static unsigned long written;
+static unsigned long applied;
+static unsigned long drawn;
+static atomic_ulong presented;
+static atomic_long dropped;
+static long long lastPresent;
+static long long lastInterval;
+
+void latencyInput(long long now){
+    //a stalled present must not stall input, inputs that do not fit are not followed
+    if (written - atomic_load_explicit(&presented, memory_order_acquire) == latencyRingSize) {
+        atomic_fetch_add_explicit(&dropped, 1, memory_order_relaxed);
+        return;
+    }
+    inputs[written++ & (latencyRingSize - 1)] = now;
+}
+
+unsigned long latencyTick(long long now){
+    for (; applied != written; applied++) {
+        telemetryRecord(TELEMETRY_INPUT_TICK, now - inputs[applied & (latencyRingSize - 1)]);
+    }
+    return applied;
+}
+
+unsigned long latencyDraw(long long now, unsigned long stateApplied){
+    for (; drawn != stateApplied; drawn++) {
+        telemetryRecord(TELEMETRY_INPUT_DRAW, now - inputs[drawn & (latencyRingSize - 1)]);
+    }
+    return drawn;
+}
+
+void latencyPresent(long long now, unsigned long frameDrawn){
+    unsigned long done = atomic_load_explicit(&presented, memory_order_relaxed);
+    for (; done != frameDrawn; done++) {
+        telemetryRecord(TELEMETRY_INPUT_PRESENT, now - inputs[done & (latencyRingSize - 1)]);
+    }
+    atomic_store_explicit(&presented, done, memory_order_release);
+    if (lastPresent != 0) {
+        long long interval = now - lastPresent;
+        telemetryRecord(TELEMETRY_PRESENT, interval);
+        if (lastInterval != 0) {
+            telemetryRecord(TELEMETRY_JITTER, interval > lastInterval ? interval - lastInterval : lastInterval - interval);
+        }
+        lastInterval = interval;
+    }
+    lastPresent = now;
+}
+
+long latencyDropped(){
+    return atomic_load_explicit(&dropped, memory_order_relaxed);
+}
@@ -0,0 +1,30 @@
+// Input-to-photon latency
+// Follows every input event through the pipeline: the simulation tick that applies it, the draw
+// that renders the resulting state and the swap that puts that frame on screen. Each stage's
+// delay since the input is recorded in the telemetry histograms, together with the interval
+// between presents and its jitter (how much each interval differs from the one before).
+// Input and ticks are reported from the simulation thread, draws and presents from the render
+// thread; the two may be the same thread.
+
+#ifndef LATENCY_H
+#define LATENCY_H
+
+//An input event happened at now, telemetry clock (ns)
+void latencyInput(long long now);
+
+//A tick applied every input received so far, returns the cursor the state it produced carries
+//to latencyDraw
+unsigned long latencyTick(long long now);
+
+//A draw started from the state of the tick that returned applied, returns the cursor to hand
+//to latencyPresent once that frame's present time is known
+unsigned long latencyDraw(long long now, unsigned long applied);
+
+//The frame of the draw that returned drawn reached the screen at presented. Presents may be
+//reported a frame or two after their draw, but in draw order.
+void latencyPresent(long long presented, unsigned long drawn);
+
+//Input events not followed because more than the ring holds were waiting for a present
+long latencyDropped();
+
+#endif
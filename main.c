@@ -4,531 +4,609 @@
 // allan.wei@mail.mcgill.ca
 
 
+#define _GNU_SOURCE //pthread_setaffinity_np
+#include <pthread.h>
+#include <sched.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "glad.h"
 #include <GLFW/glfw3.h>
 #include <GL/glut.h>
+#include <GL/glx.h>
 #include <math.h>
+#include <time.h>
+#include "pong.h"
+#include "physics.h"
+#include "headless.h"
+#include "timestep.h"
+#include "replay.h"
+#include "netclient.h"
+#include "spectator.h"
+#include "scene.h"
+#include "telemetry.h"
+#include "trace.h"
+#include "latency.h"
+#include "inputqueue.h"
+#include "statebuffer.h"
+#include "renderer.h"
+
+
+
+//Immediate mode submission of a frame's shapes, the geometry itself comes from scene.c
+void drawScene(const Scene* scene){
+    for (int i = 0; i < scene->shapeCount; i++) {
+        const SceneShape* shape = &scene->shapes[i];
+        glBegin(shape->mode == SCENE_LINES ? GL_LINES : GL_TRIANGLE_FAN);
+        for (int v = shape->first; v < shape->first + shape->count; v++) {
+            const SceneVertex* vertex = &scene->vertices[v];
+            glColor3ub(vertex->r, vertex->g, vertex->b);
+            glVertex2f(pixelToScreenX(vertex->x), pixelToScreenY(vertex->y));
+        }
+        glEnd();
+    }
+}
 
+//The frame goes to OpenGL in one batch through renderer.c, or shape by shape in immediate mode
+//with --immediate or when the context has no OpenGL 3.3
+int batchedRenderer = 1;
 
 
-
-//Represents a point in 2D space
-//x and y are in pixels
-typedef struct Point{
-    int x; //Pixels
-    int y; //Pixels
-} Point;
-
-//Color struct
-//OpenGl can use either float or unsigned char for color values.
-//This struct uses GLubyte which is the same as unsigned char.
-//Make sure that you are calling the correct color function in OpenGL, when using this struct.
-typedef struct Color{
-    GLubyte r; //0-255
-    GLubyte g; //0-255
-    GLubyte b; //0-255
-} Color;
-
-//Global variables struct
-typedef struct Global{
-    Point playerPaddlePosition;
-    Point aiPaddlePosition;
-    int playerScore;
-    int aiScore;
-    Point ballPosition;
-    int ballSpeed; //Pixels/Frame
-    Point ballDirection;
-    int lastScore; //0 = player, 1 = ai
-    int gameOver; //0 = false, 1 = true
-} Global;
-Global global;
-
-//Consts you should not change these values.
-#define screenWidth 1920
-#define screenHeight 1080
-#define paddleOffset 120
-#define scoreSize 22
-#define scorePosition (screenHeight * 0.9)
-const int aiPaddleSpeed = 5;
-const int scoreGap = 50;
-const int ballSpeedupFactor = 1;
-const int paddleWidth = 40;
-const int paddleLength = 200;
-const int ballSideLength = 30;
-const int initialBallSpeed = 5;
-const Color paddleColor = (Color){255, 255, 255};
-const Point playerScorePosition = (Point){screenWidth - paddleOffset, scorePosition};
-const Point aiScorePosition = (Point){paddleOffset - scoreSize, scorePosition};
-const Point initialBallPosition = (Point) {screenWidth / 2, screenHeight / 2};
-const Point initialBallDirection = (Point) {1, 1};
-
-void initGlobals(){
-    //Initializes the global variables
-    //They are all under the global struct, and can be access using global.variableName
-    //You should not change this function.
-    global.playerPaddlePosition = (Point){screenWidth - paddleOffset - paddleWidth, (screenHeight / 2) - paddleLength / 2};
-    global.aiPaddlePosition = (Point){paddleOffset, (screenHeight / 2) - (paddleLength / 2)};
-    global.playerScore = 0;
-    global.aiScore = 0;
-    global.ballPosition = initialBallPosition;
-    global.ballSpeed = initialBallSpeed;
-    global.ballDirection = initialBallDirection;
-    global.lastScore = 0;
-    global.gameOver = 0;
+//helper function to draw/print characters in terms of strings to given coordinates
+void renderBitmapString(float x, float y, void* font, const char* string) {
+    const char* c;
+    glRasterPos2f(x, y);
+    for (c = string; *c != '\0'; c++) {
+        glutBitmapCharacter(font, *c);
+    }
 }
 
-
-//Helper functions to convert from pixel coordinates into screen space, which OpenGl expects.
-//You should use these functions to convert your pixel coordinates into screen space.
-//We use pixel coordinates because it is easier to work with in assembly, than floating point numbers.
-float pixelToScreenX(int x){
-    return (2.0f * (float) x / (float) (screenWidth - 1) - 1.0f);
-}
-float pixelToScreenY(int y){
-    return -(2.0f * (float) y / (float) (screenHeight - 1) - 1.0f);
+long long lastSwap = 0; //telemetry clock, 0 before the first frame
+
+//The simulation publishes a snapshot after its ticks, draw() shows the newest one
+StateBuffer states;
+const SimSnapshot* shown = NULL; //snapshot of the last draw, render thread only
+
+//--interpolate draws the state between the last two ticks where the clock is, so a low tick rate
+//still moves smoothly at a high frame rate, one tick behind the simulation. --extrapolate-paddle
+//draws the player paddle at the latest mouse position instead, ahead of the next tick.
+int interpolate = 0;
+int extrapolatePaddle = 0;
+int latestMouseY = -1; //render thread, -1 before the first mouse event
+double tickSeconds = 1.0 / 60;
+
+//The state to draw from the newest snapshot
+void frameState(const SimSnapshot* snapshot, Global* out){
+    *out = snapshot->state;
+    if (interpolate) {
+        double alpha = (timestepNow() - snapshot->time) / tickSeconds;
+        alpha = alpha < 0.0 ? 0.0 : alpha > 1.0 ? 1.0 : alpha;
+        sceneInterpolate(&snapshot->previous, &snapshot->state, alpha, out);
+    }
+    if (extrapolatePaddle && latestMouseY >= 0 && !out->gameOver) {
+        out->playerPaddlePosition.y = latestMouseY - paddleLength / 2; //where mouse() puts it
+    }
 }
 
-// Helper function to draw walls around the field
-void drawWalls(){
-    float beginningX = pixelToScreenX(0);
-    float beginningY = pixelToScreenY(0);
-    float endX = pixelToScreenX(screenWidth);
-    float endY = pixelToScreenY(screenHeight);
+//--latency follows every input to the screen. With GLX_OML_sync_control a frame's present is
+//the UST of its swap, looked up by its SBC (swap buffer count) after the next frame's swap, when
+//it has long completed, so the render thread never waits for the swap it just issued. Without
+//the extension a present is timed by the return of the swap.
+int latencyMode = 0;
+PFNGLXWAITFORSBCOMLPROC waitForSwap = NULL;
+int64_t swapsIssued = 0; //SBC the last swap completes with
+//The previous frame, waiting for its present time
+int64_t pendingSbc = -1;
+unsigned long pendingDrawn = 0;
+long long pendingSwapStart = 0;
+long long pendingSwapped = 0;
+
+//Looks for GLX_OML_sync_control on the current context
+void initPresentTiming(){
+    Display* display = glXGetCurrentDisplay();
+    if (display == NULL) {
+        return;
+    }
+    const char* extensions = glXQueryExtensionsString(display, DefaultScreen(display));
+    if (extensions != NULL && strstr(extensions, "GLX_OML_sync_control") != NULL) {
+        PFNGLXGETSYNCVALUESOMLPROC getSyncValues =
+            (PFNGLXGETSYNCVALUESOMLPROC) glXGetProcAddressARB((const GLubyte*) "glXGetSyncValuesOML");
+        int64_t ust, msc;
+        waitForSwap = (PFNGLXWAITFORSBCOMLPROC) glXGetProcAddressARB((const GLubyte*) "glXWaitForSbcOML");
+        if (getSyncValues == NULL || !getSyncValues(display, glXGetCurrentDrawable(), &ust, &msc, &swapsIssued)) {
+            waitForSwap = NULL;
+        }
+    }
+    printf("Latency: presents timed by %s\n", waitForSwap != NULL ? "GLX_OML_sync_control" : "the swap return");
+}
 
-    // goal is 3 times the paddle length?
-    float goalUpY = pixelToScreenY(screenHeight / 2 - 1.5 * paddleLength);
-    float goalDownY = pixelToScreenY(screenHeight / 2 + 1.5 * paddleLength);
+//Reports the present of the frame just swapped, or with GLX_OML_sync_control the one before it.
+//swapStart and swapped bracket the glutSwapBuffers call, drawn is latencyDraw's cursor.
+void presentFrame(long long swapStart, long long swapped, unsigned long drawn){
+    if (waitForSwap == NULL) {
+        latencyPresent(swapped, drawn);
+        return;
+    }
+    if (pendingSbc >= 0) {
+        int64_t ust, msc, sbc;
+        long long presented = pendingSwapped;
+        //a frame later the swap is done, so this returns right away with the time it completed
+        if (waitForSwap(glXGetCurrentDisplay(), glXGetCurrentDrawable(), pendingSbc, &ust, &msc, &sbc)) {
+            //UST is CLOCK_MONOTONIC in microseconds on Linux drivers, but the spec leaves the clock open
+            long long completed = (long long) ust * 1000;
+            if (completed < pendingSwapStart || completed > telemetryNow()) {
+                printf("Latency: GLX_OML_sync_control runs on another clock, presents timed by the swap return\n");
+                waitForSwap = NULL;
+            } else {
+                presented = completed;
+            }
+        }
+        latencyPresent(presented, pendingDrawn);
+        if (waitForSwap == NULL) {
+            latencyPresent(swapped, drawn);
+            return;
+        }
+    }
+    pendingSbc = ++swapsIssued;
+    pendingDrawn = drawn;
+    pendingSwapStart = swapStart;
+    pendingSwapped = swapped;
+}
 
+void draw(){
+    long long zone = traceBegin();
+    long long start = telemetryNow();
+    shown = stateBufferLatest(&states);
+    Global frame;
+    frameState(shown, &frame);
+    const Global* g = &frame;
+    unsigned long drawn = latencyMode ? latencyDraw(start, shown->inputsApplied) : 0;
+    glClear(GL_COLOR_BUFFER_BIT);
+    //walls around the field, both paddles and the ball in white, then the score: one square per
+    //point, green for the player on the right and red for the AI on the left
+    Scene scene;
+    sceneClear(&scene);
+    long long lap = telemetryNow();
+    sceneWalls(&scene);
+    lap = telemetryLap(TELEMETRY_DRAW_WALLS, lap);
+    scenePaddles(&scene, g);
+    lap = telemetryLap(TELEMETRY_DRAW_PADDLE, lap);
+    sceneBall(&scene, g);
+    lap = telemetryLap(TELEMETRY_DRAW_BALL, lap);
+    sceneScore(&scene, g);
+    lap = telemetryLap(TELEMETRY_DRAW_SCORE, lap);
     glLineWidth(10.0f); //10 pixel width lines
-
-    glBegin(GL_LINES);
-    glColor3ub(255, 0, 0);
-    glVertex2f(beginningX, endY);
-    glVertex2f(endX, endY);
-    glVertex2f(beginningX, beginningY);
-    glVertex2f(beginningX, goalUpY);
-    glVertex2f(beginningX, goalDownY);
-    glVertex2f(beginningX, endY);
-    glVertex2f(endX, goalDownY);
-    glVertex2f(endX, endY);
-    glVertex2f(endX, beginningY);
-    glVertex2f(endX, goalUpY);
-    glVertex2f(beginningX, beginningY);
-    glVertex2f(endX, beginningY);
-    glEnd();
-};
-
-void drawBall(){
-    //EXAMPLE:
-    //This is an example of how your OpenGL code should look like.
-    //You can use this as a template for your own code.
-    //You must use glBegin and glEnd to draw your shapes.
-    //You must convert the pixel coordinates to screen coordinates using pixelToScreenX and pixelToScreenY.
-    //The pixelToScreen functions are nonlinear meaning that f(x + y) != f(x) + f(y).
-    //So you have to add the pixel values before you convert to screen space.
-    float x = pixelToScreenX(global.ballPosition.x);
-    float y = pixelToScreenY(global.ballPosition.y);
-    float widthX = pixelToScreenX(global.ballPosition.x + ballSideLength);
-    float lengthY = pixelToScreenY(global.ballPosition.y + ballSideLength);
-
-    glBegin(GL_TRIANGLE_FAN);
-    glColor3ub(paddleColor.r, paddleColor.g, paddleColor.b);
-    glVertex2f(x, y);
-    glVertex2f(widthX, y);
-    glVertex2f(widthX, lengthY);
-    glVertex2f(x, y);
-    glVertex2f(widthX, lengthY);
-    glVertex2f(x, lengthY);
-    glEnd();
+    if (batchedRenderer) {
+        rendererDraw(&scene);
+    } else {
+        drawScene(&scene);
+    }
+    lap = telemetryLap(TELEMETRY_SUBMIT, lap);
+    if(g->gameOver){        //game over screen
+        glColor3ub(255, 255, 255);
+        renderBitmapString(-0.25f, 0.5f, GLUT_BITMAP_TIMES_ROMAN_24, "End of Game! Press any key to end or r to restart.");
+        lap = telemetryNow();
+    }
+    long long swapZone = traceBegin();
+    glutSwapBuffers();
+    traceEnd("swap", swapZone);
+    long long swapped = telemetryLap(TELEMETRY_SWAP, lap);
+    if (latencyMode) {
+        presentFrame(lap, swapped, drawn);
+    }
+    telemetryRecord(TELEMETRY_DRAW, swapped - start);
+    if (lastSwap != 0) {
+        telemetryRecord(TELEMETRY_FRAME, swapped - lastSwap);
+    }
+    lastSwap = swapped;
+    traceEnd("draw", zone);
 }
 
-void drawPaddle(){
-    //Draws the player paddle and the AI paddle
-    //The paddle is a rectangle with a width of paddleWidth and a length of paddleLength
-    //Both paddles are white
-    //The player paddle is on the right, the AI paddle is on the left
-    //The paddles are placed at global.playerPaddlePosition and global.aiPaddlePosition
-
-    //Similar logic to ball
-    float playerX = pixelToScreenX(global.playerPaddlePosition.x);
-    float playerY = pixelToScreenY(global.playerPaddlePosition.y);
-    float aiX = pixelToScreenX(global.aiPaddlePosition.x);
-    float aiY = pixelToScreenY(global.aiPaddlePosition.y);
-
-    float playerWidthX = pixelToScreenX(global.playerPaddlePosition.x + paddleWidth);
-    float playerLengthY = pixelToScreenY(global.playerPaddlePosition.y + paddleLength);
-    float aiWidthX = pixelToScreenX(global.aiPaddlePosition.x + paddleWidth);
-    float aiLengthY = pixelToScreenY(global.aiPaddlePosition.y + paddleLength);
-
-    glBegin(GL_TRIANGLE_FAN);
-    glColor3ub(paddleColor.r, paddleColor.g, paddleColor.b);
-    glVertex2f(playerX, playerY);
-    glVertex2f(playerWidthX, playerY);
-    glVertex2f(playerWidthX, playerLengthY);
-    glVertex2f(playerX, playerLengthY);
-    glEnd();
-
-    glBegin(GL_TRIANGLE_FAN);
-    glColor3ub(paddleColor.r, paddleColor.g, paddleColor.b);
-    glVertex2f(aiX, aiY);
-    glVertex2f(aiWidthX, aiY);
-    glVertex2f(aiWidthX, aiLengthY);
-    glVertex2f(aiX, aiLengthY);
-    glEnd();
+//Simulation runs at a fixed tick rate, rendering on its own cadence
+//Speeds in the rules are pixels per 60 Hz frame, each tick moves by simTickScale(tickRate) frames
+int tickRate = 60; //Ticks/Second
+int renderRate = 60; //Frames/Second, 0 = render on every idle pass
+int maxCatchUp = 5; //most ticks simulated for one idle pass
+int sweptCollisions = 0; //--ccd, continuous collision rules instead of updateBall
+int physicsChosen = 0; //--physics was given, the backend is not switched behind the user's back
+FixedTimestep timestep;
+double nextRender = 0.0;
+unsigned long inputsApplied = 0; //latency cursor of the last tick
+Global beforeTick; //state before the last tick
+
+//--sim-thread runs the ticks on a thread of their own, so a slow swap or driver stall never
+//holds up the rules or the input, --sim-core pins that thread and --sim-priority raises it
+int simThreaded = 0;
+int simCore = -1;
+int simPriority = 0;
+pthread_t simThread;
+atomic_int simRunning;
+atomic_int quitRequested; //set by the tick that applies a quitting key, idle() exits on the GLUT thread
+
+//--record writes every input to a replay file, --replay plays one back instead of taking input
+const char* recordPath = NULL;
+const char* replayPath = NULL;
+ReplayWriter recording;
+ReplayFile replayFile;
+ReplayMatch replayMatch;
+int replayPlaying = 0; //0 once every match in the file was played
+
+//--connect plays on a server, the rules run there and locally only as a prediction
+const char* connectAddress = NULL;
+NetClient client;
+int networkMouseY = screenHeight / 2; //last mouse y, sent to the server on every tick
+
+//Frame and tick timings are reported here at exit and on SIGUSR1, "-" = stdout
+const char* telemetryPath = "-";
+
+//--trace writes a Chrome trace-event timeline of startup and every frame
+const char* tracePath = NULL;
+
+//The input callbacks only queue events, each tick applies them
+InputQueue input;
+
+//--watch spectates a match on a server, the state only ever comes from there
+const char* watchAddress = NULL;
+Spectator spectator;
+
+//Next match of the replay, the game stays on the last frame after the final one
+void nextReplayMatch(){
+    replayPlaying = replayNextMatch(&replayFile, &replayMatch) == 1;
+    if (replayPlaying) {
+        global = replayMatch.initial;
+        sweptCollisions = replayMatch.sweptCollisions;
+    }
 }
 
-void drawScore(){
-    int coordX;
-    int coordY;
-    float x;
-    float y;
-    float widthX;
-    float lengthY;
-    //Draws the score for both the player and the AI
-    //Player score is green, AI score is red
-    //Player score is on the right, AI score is on the left
-    //Score is drawn as a series of squares
-    //The number of squares is equal to the score
-    //The squares are drawn in a row, with the scoreGap between each square
-    //The squares have a side length of scoreSize
-
-    //nonlinear pixel func
-    //player score goes LEFT (-X AXIS)
-    for(int i=0; i<global.playerScore; i++){
-        coordX = playerScorePosition.x - (i * (scoreSize + scoreGap));
-        coordY = playerScorePosition.y;
-        widthX = pixelToScreenX(coordX - scoreSize);
-        lengthY = pixelToScreenY(coordY + scoreSize);
-        x = pixelToScreenX(coordX);
-        y = pixelToScreenY(coordY);
-
-        glBegin(GL_TRIANGLE_FAN);
-        glColor3ub(0, 255, 0);
-        glVertex2f(x,y);
-        glVertex2f(widthX,y);
-        glVertex2f(widthX,lengthY);
-        glVertex2f(x,lengthY);
-        glEnd();
+//Applies every input event since the last tick in the order they arrived, the recorder sees
+//each one on its way to the rules
+void drainInput(){
+    InputEvent event;
+    while (inputPop(&input, &event)) {
+        if (latencyMode) {
+            latencyInput(event.time);
+        }
+        if (event.kind == INPUT_MOUSE && connectAddress != NULL) {
+            networkMouseY = event.value;
+        } else if (event.kind == INPUT_MOUSE) {
+            mouse(0, event.value);
+            if (recordPath != NULL) {
+                replayMouse(&recording, event.value);
+            }
+        } else {
+            if (recordPath != NULL) {
+                replayKey(&recording, (unsigned char) event.value);
+            }
+            if (global.gameOver && event.value != 'r') {
+                //keyboard() would call exit here, which must not run on the sim thread
+                atomic_store(&quitRequested, 1);
+                return;
+            }
+            int finished = global.gameOver;
+            keyboard((unsigned char) event.value, 0, 0);
+            if (finished && !global.gameOver) {
+                //initGlobals only resets what the assembly rules know about
+                global.ballFraction = (Point){0, 0};
+                global.aiPaddleFraction = 0;
+            }
+        }
     }
+}
 
-    //ai score goes RIGHT (+X AXIS)
-    for (int i = 0; i < global.aiScore; i++) {
-        coordX = aiScorePosition.x + (i * (scoreSize + scoreGap));
-        coordY = aiScorePosition.y;
-        widthX = pixelToScreenX(coordX + scoreSize);
-        lengthY = pixelToScreenY(coordY + scoreSize);
-        x = pixelToScreenX(coordX);
-        y = pixelToScreenY(coordY);
-
-        glBegin(GL_TRIANGLE_FAN);
-        glColor3ub(255, 0, 0);
-        glVertex2f(x,y);
-        glVertex2f(widthX,y);
-        glVertex2f(widthX,lengthY);
-        glVertex2f(x,lengthY);
-        glEnd();
+void reportInputDrops(){
+    unsigned long dropped = atomic_load(&input.dropped);
+    if (dropped > 0) {
+        fprintf(stderr, "Input: %lu events dropped, the queue was full\n", dropped);
+    }
+    if (latencyDropped() > 0) {
+        fprintf(stderr, "Latency: %ld inputs dropped waiting for a present\n", latencyDropped());
     }
 }
 
-void resetBall(){
-    //EXAMPLE:
-    //This is an example of how your assembly functions should look like.
-    //You can use this as a template for your own code.
-    //I've provided the original C code that I wrote, and the corresponding assembly code.
-    //I recommend that you first write the C code and test if it works. Then you can convert it to assembly.
-
-    //Resets the ball to the initial position and speed.
-    //The ball will go in the opposite direction of the last player to score
-
-    //C code:
-    //global.ballPosition = initialBallPosition;
-    //if (global.lastScore == 0){
-    //    global.ballDirection = (Point) {-initialBallDirection.x, initialBallDirection.y};
-    //}
-    //else {
-    //    global.ballDirection = initialBallDirection;
-    //}
-    //global.ballSpeed = initialBallSpeed;
-
-    //Assembly code:
-    //You should always use __volatile__ to prevent the compiler from incorrectly optimizing away your code.
-    //__asm__ is the keyword to start writing assembly code.
-    //GCC uses AT&T syntax, which is different from Intel syntax that we have been using so far.
-    //The biggest changes are that the parameters are in reverse order.
-    //Registers are prefixed with a % sign. (Two % in our case to avoid the compiler from interpreting it as a positional argument)
-    //Integer literals are prefixed with a $ sign.
-    //To refer to the memory pointed to by a register you must use the () syntax.
-    //When a label is created, it can be referenced from anywhere in the code, so ensure your labels are unique.
-    __asm__ __volatile__(
-        //%0 is the first parameter, %1 is the second parameter, and so on.
-        //The parameters start counting from the output parameters then to the input parameters.
-        //So %5 in this case is the first input parameter(initialBallPosition.x).
-        //And %0 is the first output parameter(global.ballPosition.x).
-        //You must include the newline character at the end of each line.
-            "mov %5, %0\n" //This is equivalent to global.ballPosition.x = initialBallPosition.x; in C.
-            "mov %6, %1\n" // global.ballPosition.y = initialBallPosition.y;
-            "cmp $0, %10\n" // if (global.lastScore == 0)
-            "jne resetBallPlayer\n" // {
-            "mov %7, %%eax\n" // eax = initialBallDirection.x
-            "imul $-1, %%eax\n" // eax = -initialBallDirection.x
-            "mov %%eax, %2\n" // global.ballDirection.x = -initialBallDirection.x;
-            "mov %8, %3\n" // global.ballDirection.y = initialBallDirection.y;
-            "jmp resetBallEnd\n" // }
-            "resetBallPlayer:\n" // else {
-            "mov %7, %2\n" // global.ballDirection.x = initialBallDirection.x;
-            "mov %8, %3\n" // global.ballDirection.y = initialBallDirection.y;
-            "resetBallEnd:\n" // }
-            "mov %9, %4\n" // global.ballSpeed = initialBallSpeed;
-            //An example of how to use the eax register, and integer literals.
-            "mov $0, %%eax\n" //Now eax is 0
-            : "=m" (global.ballPosition.x), "=m" (global.ballPosition.y), "=m" (global.ballDirection.x), "=m" (global.ballDirection.y), "=m" (global.ballSpeed)
-        //Output parameters go here. Use "=r" for values stored in registers, use "=m" for values stored in memory
-            : "r" (initialBallPosition.x), "r" (initialBallPosition.y), "r" (initialBallDirection.x), "r" (initialBallDirection.y), "r" (initialBallSpeed), "r" (global.lastScore)
-        //Input parameters go here use "r" for values stored in registers, use "m" for values stored in memory
-            : "eax"
-        //You should list all the registers you use here, because they will be clobbered and the compiler has to know which ones to save
-            );
+//One simulation tick, from the replay or from the live input
+void tick(){
+    drainInput();
+    if (watchAddress != NULL) {
+        if (!spectator.disconnected && spectatorReceive(&spectator)) {
+            global = spectator.state;
+        }
+        return;
+    }
+    if (connectAddress != NULL) {
+        if (!client.disconnected) {
+            netClientTick(&client, networkMouseY - paddleLength / 2);
+            global = *netClientState(&client);
+            if (latencyMode) {
+                inputsApplied = latencyTick(telemetryNow());
+            }
+        }
+        return;
+    }
+    if (replayPath != NULL) {
+        while (replayPlaying && replayStep(&replayMatch, &global) != 1) {
+            nextReplayMatch();
+        }
+        return;
+    }
+    if (recordPath != NULL) {
+        replayTick(&recording, &global);
+    }
+    long long zone = traceBegin();
+    long long start = telemetryNow();
+    if (sweptCollisions) {
+        simGameLogicSwept(&global);
+    } else {
+        physicsGameLogic(&global);
+    }
+    long long ticked = telemetryLap(TELEMETRY_SIM, start);
+    traceEnd("gameLogic", zone);
+    if (latencyMode) {
+        inputsApplied = latencyTick(ticked);
+    }
 }
 
-void updateBall(){
-    //Check if the ball collides with the edges of the screen, and check if it collides with the paddles. DONE
-    //If the ball collides with the edges of the screen, it will add a point to the other player and reset the ball. DONE
-    //If the ball collides with the paddles, it will change the x direction of the ball. DONE
-    //If the ball collides with the top or bottom of the screen, it will change the y direction of the ball. DONE
-    //The ball will also increase in speed every time it collides with the AI paddle. DONE
-    //Update the ball position using the global.ballSpeed and global.ballDirection variables DONE
-    //Make sure to update the global.lastScore variable to indicate who scored the last point DONE
-    __asm__ __volatile__(
-            "mov %4, %%eax\n"   //ballspeed
-            "imul %2, %%eax\n"  // ballspeed * x_dir
-            "add %%eax, %0\n"   // move horizontally
-
-            "mov $10, %%eax\n"  //left wall
-            "cmp %%eax, %0\n"
-            "jl check_goal\n"    //collision
-
-            "cmp %8, %0\n"  //right wall
-            "jg check_goal\n"    //collision
-
-            "mov %4, %%eax\n"
-            "imul %3, %%eax\n"
-            "add %%eax, %1\n"   //move vertically
-
-            "mov $10, %%eax\n"
-            "cmp %%eax, %1\n"   //upper wall
-            "jl neg_y\n"    //collision
-
-            "cmp %9, %1\n"  //lower wall
-            "jg neg_y\n"    //collision
-
-            "mov %0, %%eax\n"   //paddle left
-            "add %10, %%eax\n"
-            "cmp %11, %%eax\n"
-            "jng left_paddle_check\n"
-
-            "mov %11, %%eax\n"   //paddle right
-            "add %13, %%eax\n"
-            "cmp %%eax, %0\n"
-            "jnl left_paddle_check\n"
-
-            "mov %1, %%eax\n"   //paddle top
-            "add %10, %%eax\n"
-            "cmp %12, %%eax\n"
-            "jng left_paddle_check\n"
-
-            "mov %12, %%eax\n"   //paddle bottom
-            "add %14, %%eax\n"
-            "cmp %%eax, %1\n"
-            "jnl left_paddle_check\n"
-
-            //for sure in paddle range (hits from bottom or top will trickle :/)
-            "jmp neg_x\n"
-
-            "left_paddle_check:\n"  //ai paddle
-            // same logic here as right paddle
-            "mov %0, %%eax\n"
-            "add %10, %%eax\n"
-            "cmp %15, %%eax\n"
-            "jng update_ball\n"
-
-            "mov %15, %%eax\n"
-            "add %13, %%eax\n"
-            "cmp %%eax, %0\n"
-            "jnl update_ball\n"
-
-            "mov %1, %%eax\n"
-            "add %10, %%eax\n"
-            "cmp %16, %%eax\n"
-            "jng update_ball\n"
-
-            "mov %16, %%eax\n"
-            "add %14, %%eax\n"
-            "cmp %%eax, %1\n"
-            "jnl update_ball\n"
-
-            "add $1, %4\n" //ball speed up when ai hits
-            "jmp neg_x\n"
-
-            "neg_x:\n"  //negate ball direction x axis
-            "neg %2\n"
-            "jmp update_ball\n"
-
-            "neg_y:\n"  //negate ball direction y axis
-            "neg %3\n"
-            "jmp update_ball\n"
-
-            "check_goal:\n"
-            "mov %1, %%eax\n"   //goal bottom
-            "add %10, %%eax\n"
-            "cmp %18, %%eax\n"
-            "jge neg_x\n"   //goal post should negate direction no goal
-
-            "cmp %17, %1\n" //goal top
-            "jle neg_x\n"   //goal post should negate direction no goal
-
-            "jmp award_goal\n"  //if inside the goal, award
-
-            "award_goal:\n"
-            "cmp $1, %2\n"      //if ball goes right, ai scored
-            "je ai_score\n"
-
-            "jmp player_score\n"    //else player scored
-
-            "ai_score:\n"
-            "add $1, %6\n"
-            "mov $1, %7\n"
-            "call resetBall\n"  //award points and reset the ball
-            "jmp update_ball\n"
-
-            "player_score:\n"
-            "add $1, %5\n"
-            "mov $0, %7\n"      //award points and reset the ball
-            "call resetBall\n"
-            "update_ball:\n"
-            : "=m" (global.ballPosition.x), "=m" (global.ballPosition.y), "=m" (global.ballDirection.x), "=m" (global.ballDirection.y), "=m" (global.ballSpeed), "=m" (global.playerScore), "=m" (global.aiScore), "=m" (global.lastScore)
-            : "r" (screenWidth-40), "r" (screenHeight-40), "r" (ballSideLength), "r" (global.playerPaddlePosition.x), "r" (global.playerPaddlePosition.y), "r" (paddleWidth), "r" (paddleLength), "r" (global.aiPaddlePosition.x), "r" (global.aiPaddlePosition.y), "r" ((int) (screenHeight / 2 - 1.5 * paddleLength)), "r" ((int) (screenHeight / 2 + 1.5 * paddleLength))
-            : "eax"
-            );
+//Runs the ticks that are due and hands the state after the last one to the renderer
+void simulate(int ticks){
+    for (int i = 0; i < ticks; i++) {
+        beforeTick = global;
+        tick();
+    }
+    if (ticks == 0) {
+        return;
+    }
+    SimSnapshot* next = stateBufferBack(&states);
+    next->state = global;
+    next->previous = beforeTick;
+    next->time = timestep.lastTime - timestep.accumulator;
+    next->tick = timestep.ticks;
+    next->inputsApplied = inputsApplied;
+    stateBufferPublish(&states);
 }
 
-void updateAI(){
-    //The AI is very simple, it just follows the ball on the Y axis only if the ball is on the left side of the screen
-    //It moves at the speed set by the global.aiSpeed variable
-
-    __asm__ __volatile__(
-            "cmp %3, %1\n"      //stay still if ball in the right side of the pitch
-            "jge end\n"
-
-            "cmp %0, %2\n"      //move according to the ball's y
-            "jl decrease_y\n"
-            "jg increase_y\n"
-            "jmp end\n"
+//Sim thread: ticks on the fixed timestep and sleeps in between, independent of the frames
+void* runSimulation(void* arg){
+    (void) arg;
+    traceThreadName("sim");
+    while (atomic_load_explicit(&simRunning, memory_order_relaxed)) {
+        simulate(timestepAdvance(&timestep, timestepNow()));
+        double untilTick = timestepUntilNextTick(&timestep);
+        struct timespec ts;
+        ts.tv_sec = (time_t) untilTick;
+        ts.tv_nsec = (long) ((untilTick - (double) ts.tv_sec) * 1e9);
+        nanosleep(&ts, NULL);
+    }
+    return NULL;
+}
 
-            "decrease_y:\n"
-            "sub %4, %0\n"  //decrease y by ai paddle speed
-            "jmp end\n"
+//Stops the sim thread before the other exit handlers use the state, unless it is the one exiting
+void stopSimulation(){
+    atomic_store(&simRunning, 0);
+    if (!pthread_equal(pthread_self(), simThread)) {
+        pthread_join(simThread, NULL);
+    }
+}
 
-            "increase_y:\n"
-            "add %4, %0\n"  //increase y by ai paddle speed
-            "jmp end\n"
+//Starts the sim thread with --sim-core and --sim-priority, returns -1 if it cannot run
+int startSimulation(){
+    atomic_store(&simRunning, 1);
+    if (pthread_create(&simThread, NULL, runSimulation, NULL) != 0) {
+        return -1;
+    }
+    if (simCore >= 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(simCore, &cpus);
+        if (pthread_setaffinity_np(simThread, sizeof(cpus), &cpus) != 0) {
+            fprintf(stderr, "Failed to pin the sim thread to core %d\n", simCore);
+        }
+    }
+    if (simPriority) {
+        //real-time round robin just above every normal thread, needs CAP_SYS_NICE or an rtprio limit
+        struct sched_param param = {sched_get_priority_min(SCHED_RR)};
+        if (pthread_setschedparam(simThread, SCHED_RR, &param) != 0) {
+            fprintf(stderr, "Failed to raise the sim thread priority, it runs at normal priority\n");
+        }
+    }
+    atexit(stopSimulation);
+    return 0;
+}
 
-            "end:\n"
-            : "=m" (global.aiPaddlePosition.y)
-            : "r" (global.ballPosition.x), "r" (global.ballPosition.y), "r" (screenWidth/2), "r" (aiPaddleSpeed)
-            : "eax"
-            );
+//GLUT input callbacks, queued for the next tick. Played back and spectated matches take no input.
+void onMouse(int x, int y){
+    (void) x;
+    long long zone = traceBegin();
+    if (replayPath == NULL && watchAddress == NULL) {
+        inputPush(&input, INPUT_MOUSE, y, telemetryNow());
+        latestMouseY = y;
+    }
+    traceEnd("mouse", zone);
 }
 
-void gameLogic(){
-    //The game is over when one of the players reaches 9 points otherwise call updateBall and updateAI
-    //Make sure to update the global.gameOver variable
-    __asm__ __volatile__(
-            "mov $9, %%eax\n"   //check if game ended
-            "cmp %1, %%eax\n"
-            "je player_wins\n"
-
-            "mov $9, %%eax\n"   //check if game ended
-            "cmp %2, %%eax\n"
-            "je ai_wins\n"
-
-            "call updateBall\n"     //if didn't end continue calling updateball and ai
-            "call updateAI\n"
-            "jmp not_over\n"
-
-            "player_wins:\n"
-            //do smt                no instruction given in terms of celebration for player
-            "jmp game_end\n"
-
-            "ai_wins:\n"
-            //do another thing      no instruction given in terms of celebration for ai
-            "jmp game_end\n"
-
-            "game_end:\n"
-            "mov $1, %0\n"          //game_over = 1
-            "not_over:\n"
-            : "=m" (global.gameOver)
-            : "r" (global.playerScore), "r" (global.aiScore)
-            : "eax"
-            );
+void onKeyboard(unsigned char key, int x, int y){
+    int gameOver = shown != NULL && shown->state.gameOver;
+    if (replayPath != NULL || watchAddress != NULL || (connectAddress != NULL && gameOver)) {
+        exit(0); //any key ends a playback, spectating or a finished network match
+    }
+    (void) x;
+    (void) y;
+    if (connectAddress != NULL) {
+        return;
+    }
+    long long zone = traceBegin();
+    inputPush(&input, INPUT_KEY, key, telemetryNow());
+    traceEnd("keyboard", zone);
 }
 
+//The game quits through exit, so the recording is finished from an atexit handler
+void finishRecording(){
+    replayEndMatch(&recording, &global);
+    if (replayClose(&recording) != 0) {
+        fprintf(stderr, "Failed to write replay: %s\n", recordPath);
+    }
+}
 
-void mouse(int x, int y){
-    //The paddle is always centered on the mouse
-    __asm__ __volatile__(
-            "mov %1, %%eax\n"
-            "sub %2, %%eax\n"   // player paddle middle
-            "mov %%eax, %0\n"   //move with the mouse
-            : "=m" (global.playerPaddlePosition.y)
-            : "r" (y), "r" (paddleLength/2)
-            : "%eax"
-            );
+void leaveServer(){
+    if (watchAddress != NULL) {
+        spectatorClose(&spectator);
+    } else {
+        netClientClose(&client);
+    }
 }
 
-void keyboard(unsigned char key, int x, int y){
-    //Pressing 'r' resets the game if the game is over
-    __asm__ __volatile__(
-            "cmp $0, %0\n"
-            "je no_reset\n" //when game continues do nothing
-
-            "game_over:\n"
-            "cmp $'r', %1\n"    //check if person hits r
-            "je restart_game\n"
-
-            "call exit\n"   //if not exit
-
-            "restart_game:\n"
-            "call initGlobals\n"    //initglobals = reset
-            "no_reset:\n"
-            : "=m" (global.gameOver)
-            : "r" (key)
-            : "eax"
-            );
+//Connects to the server or opens the replay or recording named on the command line,
+//returns -1 on failure
+int startReplay(){
+    if (watchAddress != NULL) {
+        if (spectatorConnect(&spectator, watchAddress, 0, 0) != 0) {
+            fprintf(stderr, "No match to watch on server: %s\n", watchAddress);
+            return -1;
+        }
+        tickRate = spectator.tickRate;
+        atexit(leaveServer);
+    } else if (connectAddress != NULL) {
+        if (netClientConnect(&client, connectAddress, sweptCollisions) != 0) {
+            fprintf(stderr, "No answer from server: %s\n", connectAddress);
+            return -1;
+        }
+        //the server sets the pace
+        tickRate = client.tickRate;
+        global = *netClientState(&client);
+        atexit(leaveServer);
+    } else if (replayPath != NULL) {
+        if (replayOpen(&replayFile, replayPath) != 0) {
+            fprintf(stderr, "Failed to open replay: %s\n", replayPath);
+            return -1;
+        }
+        nextReplayMatch();
+        if (!replayPlaying) {
+            fprintf(stderr, "No match in replay: %s\n", replayPath);
+            return -1;
+        }
+        tickRate = replayMatch.tickRate > 0 ? replayMatch.tickRate : tickRate;
+    } else if (recordPath != NULL) {
+        if (replayCreate(&recording, recordPath) != 0) {
+            fprintf(stderr, "Failed to create replay: %s\n", recordPath);
+            return -1;
+        }
+        replayBeginMatch(&recording, &global, tickRate, sweptCollisions, 0);
+        atexit(finishRecording);
+    }
+    return 0;
 }
 
-//helper function to draw/print characters in terms of strings to given coordinates
-void renderBitmapString(float x, float y, void* font, const char* string) {
-    const char* c;
-    glRasterPos2f(x, y);
-    for (c = string; *c != '\0'; c++) {
-        glutBitmapCharacter(font, *c);
+void idle(){
+    telemetryPoll();
+    double now = timestepNow();
+    double untilWake = 1.0 / tickRate; //with the sim thread, wake once a tick to queue the input in time
+    if (!simThreaded) {
+        simulate(timestepAdvance(&timestep, now));
+        untilWake = timestepUntilNextTick(&timestep);
+    }
+    if (atomic_load(&quitRequested)) {
+        exit(0);
     }
+
+    if (renderRate == 0 || now >= nextRender) {
+        glutPostRedisplay();
+        if (renderRate > 0) {
+            //stay on the render grid, unless we fell more than a frame behind
+            nextRender += 1.0 / renderRate;
+            if (nextRender < now) {
+                nextRender = now + 1.0 / renderRate;
+            }
+        }
+        return;
+    }
+    if (nextRender - now < untilWake) {
+        untilWake = nextRender - now;
+    }
+    //sleep until the next tick or frame is due instead of spinning a core
+    struct timespec ts;
+    ts.tv_sec = (time_t) untilWake;
+    ts.tv_nsec = (long) ((untilWake - (double) ts.tv_sec) * 1e9);
+    nanosleep(&ts, NULL);
 }
 
-void draw(){
-    glClear(GL_COLOR_BUFFER_BIT);
-    drawWalls();
-    drawPaddle();
-    drawBall();
-    drawScore();
-    if(global.gameOver){        //game over screen
-        glColor3ub(255, 255, 255);
-        renderBitmapString(-0.25f, 0.5f, GLUT_BITMAP_TIMES_ROMAN_24, "End of Game! Press any key to end or r to restart.");
+//Reads --tick-rate, --fps, --max-catch-up, --ccd, --record, --replay, --connect, --watch,
+//--physics, --telemetry, --trace, --latency, --sim-thread, --sim-core, --sim-priority,
+//--interpolate, --extrapolate-paddle and --immediate, returns -1 on a bad value
+int parseTimingOptions(int argc, char **argv){
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--ccd") == 0) {
+            sweptCollisions = 1;
+        } else if (strcmp(argv[i], "--latency") == 0) {
+            latencyMode = 1;
+        } else if (strcmp(argv[i], "--sim-thread") == 0) {
+            simThreaded = 1;
+        } else if (strcmp(argv[i], "--sim-priority") == 0) {
+            simPriority = 1;
+        } else if (strcmp(argv[i], "--interpolate") == 0) {
+            interpolate = 1;
+        } else if (strcmp(argv[i], "--extrapolate-paddle") == 0) {
+            extrapolatePaddle = 1;
+        } else if (strcmp(argv[i], "--immediate") == 0) {
+            batchedRenderer = 0;
+        }
     }
-    glutSwapBuffers();
-    glutPostRedisplay();
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--tick-rate") == 0) {
+            tickRate = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--fps") == 0) {
+            renderRate = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--max-catch-up") == 0) {
+            maxCatchUp = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--record") == 0) {
+            recordPath = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0) {
+            replayPath = argv[++i];
+        } else if (strcmp(argv[i], "--connect") == 0) {
+            connectAddress = argv[++i];
+        } else if (strcmp(argv[i], "--watch") == 0) {
+            watchAddress = argv[++i];
+        } else if (strcmp(argv[i], "--telemetry") == 0) {
+            telemetryPath = argv[++i];
+        } else if (strcmp(argv[i], "--trace") == 0) {
+            tracePath = argv[++i];
+        } else if (strcmp(argv[i], "--sim-core") == 0) {
+            simCore = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--physics") == 0) {
+            physicsChosen = 1;
+            if (physicsSelect(argv[++i]) != 0) {
+                fprintf(stderr, "Physics backend unknown or not available on this CPU: %s (%s)\n", argv[i], physicsNames);
+                return -1;
+            }
+        }
+    }
+    if (tickRate <= 0 || renderRate < 0 || maxCatchUp <= 0) {
+        fprintf(stderr, "--tick-rate and --max-catch-up must be positive, --fps must not be negative\n");
+        return -1;
+    }
+    //speeds are per 60 Hz frame and the other rules scale each tick's motion to the tick rate,
+    //the assembly only moves by whole frames
+    if (tickRate != 60 && strcmp(physicsBackend()->name, "asm") == 0) {
+        if (physicsChosen) {
+            fprintf(stderr, "--physics asm only plays at --tick-rate 60, the other backends play at any rate\n");
+            return -1;
+        }
+        physicsSelect("c");
+    }
+    if ((simCore >= 0 || simPriority) && !simThreaded) {
+        fprintf(stderr, "--sim-core and --sim-priority need --sim-thread\n");
+        return -1;
+    }
+    if (telemetryInstall(telemetryPath) != 0) {
+        fprintf(stderr, "Failed to install the telemetry report\n");
+        return -1;
+    }
+    if (tracePath != NULL) {
+        if (traceStart(tracePath) != 0) {
+            fprintf(stderr, "Failed to start the trace: %s\n", tracePath);
+            return -1;
+        }
+        traceThreadName("main");
+    }
+    printf("Physics: %s backend%s\n", physicsBackend()->name, sweptCollisions ? ", swept collisions on the C rules" : "");
+    return 0;
 }
 
 //callback function for intro screen to disappear
@@ -601,13 +679,17 @@ int runintro() {
     glfwMakeContextCurrent(window);
 
     // check glad's opengl funcs
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+    long long zone = traceBegin();
+    int loaded = gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+    traceEnd("gladLoadGLLoader", zone);
+    if (!loaded) {
         fprintf(stderr, "Failed to initialize GLAD\n");
         glfwTerminate();
         return -1;
     }
 
     // Create and compile the vertex shader for sphere
+    zone = traceBegin();
     GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
     glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
     glCompileShader(vertexShader);
@@ -626,8 +708,10 @@ int runintro() {
     GLuint fragmentShader3 = glCreateShader(GL_FRAGMENT_SHADER);
     glShaderSource(fragmentShader3, 1, &fragmentShaderSource3, NULL);
     glCompileShader(fragmentShader3);
+    traceEnd("compileShaders", zone);
 
     // Create the shader programs and link the shaders
+    zone = traceBegin();
     GLuint shaderProgram = glCreateProgram();
     glAttachShader(shaderProgram, vertexShader);
     glAttachShader(shaderProgram, fragmentShader);
@@ -640,6 +724,7 @@ int runintro() {
     GLuint shaderProgram3 = glCreateProgram();
     glAttachShader(shaderProgram3, fragmentShader3);
     glLinkProgram(shaderProgram3);
+    traceEnd("linkPrograms", zone);
 
     // Clean up the shaders
     glDeleteShader(vertexShader);
@@ -744,11 +829,25 @@ int runintro() {
 
 int main(int argc, char **argv)
 {
+    //headless mode never touches GLUT, GLFW or OpenGL
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--headless") == 0) {
+            return runHeadless(argc, argv);
+        }
+    }
+
     // Initialize GLUT and process user parameters
     glutInit(&argc, argv);
+    if (parseTimingOptions(argc, argv) != 0) {
+        return 1;
+    }
     //run intro
     runintro();
     initGlobals();
+    global.tickScale = simTickScale(tickRate);
+    if (startReplay() != 0) {
+        return 1;
+    }
 
     // Request double buffered true color window
     glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB);
@@ -756,13 +855,37 @@ int main(int argc, char **argv)
     glutInitWindowPosition(0, 0);
 
     // Create window
+    long long zone = traceBegin();
     glutCreateWindow("COMP308 Pong");
+    traceEnd("glutCreateWindow", zone);
+    //glad was loaded for the intro's GLFW context, this is another one
+    if (batchedRenderer && (!gladLoadGL() || rendererInit(screenWidth, screenHeight) != 0)) {
+        fprintf(stderr, "No OpenGL 3.3 on this context, drawing in immediate mode\n");
+        batchedRenderer = 0;
+    }
+    if (latencyMode) {
+        initPresentTiming();
+    }
 
     // Callback functions
     glutDisplayFunc(draw);
-    glutIdleFunc(gameLogic);
-    glutPassiveMotionFunc(mouse);
-    glutKeyboardFunc(keyboard);
+    glutIdleFunc(idle);
+    glutPassiveMotionFunc(onMouse);
+    glutKeyboardFunc(onKeyboard);
+
+    inputQueueInit(&input);
+    atexit(reportInputDrops);
+    SimSnapshot initial = {global, global, 0.0, 0, 0};
+    stateBufferInit(&states, &initial);
+    tickSeconds = 1.0 / tickRate;
+
+    // Start the clock right before the loop so the intro screen is not simulated
+    timestepInit(&timestep, tickRate, maxCatchUp, timestepNow());
+    nextRender = timestep.lastTime;
+    if (simThreaded && startSimulation() != 0) {
+        fprintf(stderr, "Failed to start the sim thread\n");
+        return 1;
+    }
 
     // Pass control to GLUT for events
     glutMainLoop();
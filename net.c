@@ -0,0 +1,405 @@
+// Network protocol, see net.h
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "net.h"
+
+#define netStateFields 13
+
+static unsigned char* put16(unsigned char* p, int value){
+    p[0] = (unsigned char) (value & 0xff);
+    p[1] = (unsigned char) ((value >> 8) & 0xff);
+    return p + 2;
+}
+
+static unsigned char* put32(unsigned char* p, unsigned long value){
+    for (int i = 0; i < 4; i++) {
+        p[i] = (unsigned char) ((value >> (8 * i)) & 0xff);
+    }
+    return p + 4;
+}
+
+static int get16(const unsigned char* p){
+    return (short) (p[0] | p[1] << 8);
+}
+
+static unsigned long get32(const unsigned char* p){
+    return (unsigned long) p[0] | (unsigned long) p[1] << 8 | (unsigned long) p[2] << 16 | (unsigned long) p[3] << 24;
+}
+
+//Global as 16 bit fields, every value the rules produce fits
+static int* stateField(Global* g, int i){
+    int* fields[netStateFields] = {
+        &g->playerPaddlePosition.x, &g->playerPaddlePosition.y, &g->aiPaddlePosition.x, &g->aiPaddlePosition.y,
+        &g->playerScore, &g->aiScore, &g->ballPosition.x, &g->ballPosition.y, &g->ballSpeed,
+        &g->ballDirection.x, &g->ballDirection.y, &g->lastScore, &g->gameOver
+    };
+    return fields[i];
+}
+
+int netEncode(const NetPacket* packet, unsigned char* buffer){
+    unsigned char* p = buffer;
+    *p++ = (unsigned char) packet->type;
+    switch (packet->type) {
+        case NET_HELLO:
+            p = put32(p, packet->nonce);
+            break;
+        case NET_WELCOME:
+            p = put32(p, packet->nonce);
+            p = put32(p, (unsigned long) packet->tick);
+            p = put16(p, packet->tickRate);
+            break;
+        case NET_INPUT:
+            p = put32(p, (unsigned long) packet->tick);
+            *p++ = (unsigned char) packet->inputCount;
+            for (int i = 0; i < packet->inputCount; i++) {
+                p = put16(p, packet->inputs[i]);
+            }
+            break;
+        case NET_SNAPSHOT: {
+            Global state = packet->state;
+            p = put32(p, (unsigned long) packet->tick);
+            p = put16(p, packet->inputLead);
+            for (int i = 0; i < netStateFields; i++) {
+                p = put16(p, *stateField(&state, i));
+            }
+            //the client predicts from this state, so it needs the sub-pixel parts as well
+            p = put16(p, state.ballFraction.x);
+            p = put16(p, state.ballFraction.y);
+            p = put16(p, state.aiPaddleFraction);
+            break;
+        }
+        case NET_BYE:
+            break;
+        case NET_WATCH:
+            p = put32(p, packet->nonce);
+            p = put16(p, packet->match);
+            p = put32(p, (unsigned long) packet->rate);
+            break;
+        case NET_DELTA:
+            p = put32(p, (unsigned long) packet->tick);
+            *p++ = (unsigned char) (packet->tick - packet->baseTick);
+            p = put16(p, packet->checksum);
+            memcpy(p, packet->delta, (size_t) packet->deltaSize);
+            p += packet->deltaSize;
+            break;
+        case NET_ACK:
+            p = put32(p, (unsigned long) packet->tick);
+            p = put32(p, (unsigned long) packet->received);
+            break;
+    }
+    return (int) (p - buffer);
+}
+
+int netDecode(const unsigned char* buffer, int size, NetPacket* packet){
+    static const int sizes[] = {0, 5, 11, 6, 7 + 2 * (netStateFields + 3), 1, 11, 8, 9};
+    if (size < 1 || buffer[0] < NET_HELLO || buffer[0] > NET_ACK || size < sizes[buffer[0]]) {
+        return -1;
+    }
+    const unsigned char* p = buffer + 1;
+    memset(packet, 0, sizeof(NetPacket));
+    packet->type = (NetMessage) buffer[0];
+    switch (packet->type) {
+        case NET_HELLO:
+            packet->nonce = (unsigned int) get32(p);
+            break;
+        case NET_WELCOME:
+            packet->nonce = (unsigned int) get32(p);
+            packet->tick = (long) get32(p + 4);
+            packet->tickRate = get16(p + 8);
+            break;
+        case NET_INPUT:
+            packet->tick = (long) get32(p);
+            packet->inputCount = p[4];
+            if (packet->inputCount < 1 || packet->inputCount > netInputRedundancy || size < 6 + 2 * packet->inputCount) {
+                return -1;
+            }
+            for (int i = 0; i < packet->inputCount; i++) {
+                packet->inputs[i] = get16(p + 5 + 2 * i);
+            }
+            break;
+        case NET_SNAPSHOT:
+            packet->tick = (long) get32(p);
+            packet->inputLead = get16(p + 4);
+            for (int i = 0; i < netStateFields; i++) {
+                *stateField(&packet->state, i) = get16(p + 6 + 2 * i);
+            }
+            p += 6 + 2 * netStateFields;
+            packet->state.ballFraction = (Point){get16(p) & 0xffff, get16(p + 2) & 0xffff};
+            packet->state.aiPaddleFraction = get16(p + 4) & 0xffff;
+            break;
+        case NET_BYE:
+            break;
+        case NET_WATCH:
+            packet->nonce = (unsigned int) get32(p);
+            packet->match = (unsigned short) get16(p + 4);
+            packet->rate = (int) get32(p + 6);
+            break;
+        case NET_DELTA:
+            packet->tick = (long) get32(p);
+            packet->baseTick = packet->tick - p[4];
+            packet->checksum = (unsigned short) get16(p + 5);
+            packet->deltaSize = size - 8;
+            if (packet->deltaSize > netMaxDelta) {
+                return -1;
+            }
+            memcpy(packet->delta, p + 7, (size_t) packet->deltaSize);
+            break;
+        case NET_ACK:
+            packet->tick = (long) get32(p);
+            packet->received = (long) get32(p + 4);
+            break;
+    }
+    return 0;
+}
+
+//How each state field is packed, in stateField order
+typedef enum FieldKind{
+    FIELD_POSITION, //12 bit zigzag, or 6 bit zigzag difference to the base
+    FIELD_SCORE, //4 bits
+    FIELD_SPEED, //8 bits
+    FIELD_DIRECTION, //+1 or -1, a change is always a flip so it needs no bits
+    FIELD_FLAG //1 bit
+} FieldKind;
+
+static const FieldKind fieldKinds[netStateFields] = {
+    FIELD_POSITION, FIELD_POSITION, FIELD_POSITION, FIELD_POSITION, FIELD_SCORE, FIELD_SCORE,
+    FIELD_POSITION, FIELD_POSITION, FIELD_SPEED, FIELD_DIRECTION, FIELD_DIRECTION, FIELD_FLAG, FIELD_FLAG
+};
+static const int fieldWidths[] = {12, 4, 8, 0, 1};
+
+#define netSmallDeltaBits 6
+
+typedef struct BitStream{
+    unsigned char* bytes;
+    int size; //bytes available
+    int position; //bits written or read
+} BitStream;
+
+static void putBits(BitStream* s, unsigned int value, int width){
+    for (int i = 0; i < width; i++, s->position++) {
+        if (value >> i & 1u) {
+            s->bytes[s->position >> 3] |= (unsigned char) (1u << (s->position & 7));
+        }
+    }
+}
+
+//Returns -1 past the end
+static int getBits(BitStream* s, int width, unsigned int* value){
+    if (s->position + width > s->size * 8) {
+        return -1;
+    }
+    *value = 0;
+    for (int i = 0; i < width; i++, s->position++) {
+        *value |= (unsigned int) (s->bytes[s->position >> 3] >> (s->position & 7) & 1u) << i;
+    }
+    return 0;
+}
+
+static unsigned int zigzag(int value){
+    return value < 0 ? ((unsigned int) -(value + 1) << 1) | 1u : (unsigned int) value << 1;
+}
+
+static int unzigzag(unsigned int value){
+    return value & 1u ? -(int) (value >> 1) - 1 : (int) (value >> 1);
+}
+
+static int fieldFits(FieldKind kind, int value, int base){
+    switch (kind) {
+        case FIELD_POSITION:
+            return zigzag(value) < 1u << fieldWidths[kind];
+        case FIELD_DIRECTION:
+            return (value == 1 || value == -1) && (base == 1 || base == -1);
+        default:
+            return value >= 0 && value < 1 << fieldWidths[kind];
+    }
+}
+
+int netEncodeDelta(const Global* base, const Global* state, unsigned char* out){
+    Global initial, current = *state;
+    if (base == NULL) {
+        simInitGlobals(&initial);
+        base = &initial;
+    }
+    Global reference = *base;
+    memset(out, 0, netMaxDelta);
+    BitStream s = {out, netMaxDelta, 0};
+
+    int fits = 1;
+    for (int i = 0; i < netStateFields; i++) {
+        fits &= fieldFits(fieldKinds[i], *stateField(&current, i), *stateField(&reference, i));
+    }
+    putBits(&s, fits ? 0u : 1u, 1);
+    if (!fits) {
+        for (int i = 0; i < netStateFields; i++) {
+            putBits(&s, (unsigned int) *stateField(&current, i) & 0xffffu, 16);
+        }
+        return (s.position + 7) / 8;
+    }
+
+    for (int i = 0; i < netStateFields; i++) {
+        int value = *stateField(&current, i);
+        int old = *stateField(&reference, i);
+        putBits(&s, value != old, 1);
+        if (value == old || fieldKinds[i] == FIELD_DIRECTION) {
+            continue;
+        }
+        if (fieldKinds[i] == FIELD_POSITION) {
+            unsigned int difference = zigzag(value - old);
+            int small = difference < 1u << netSmallDeltaBits;
+            putBits(&s, small ? 0u : 1u, 1);
+            putBits(&s, small ? difference : zigzag(value), small ? netSmallDeltaBits : fieldWidths[FIELD_POSITION]);
+        } else {
+            putBits(&s, (unsigned int) value, fieldWidths[fieldKinds[i]]);
+        }
+    }
+    return (s.position + 7) / 8;
+}
+
+int netDecodeDelta(const Global* base, const unsigned char* delta, int size, Global* out){
+    Global initial;
+    if (base == NULL) {
+        simInitGlobals(&initial);
+        base = &initial;
+    }
+    Global result = *base;
+    BitStream s = {(unsigned char*) delta, size, 0};
+    unsigned int bits;
+
+    if (getBits(&s, 1, &bits) != 0) {
+        return -1;
+    }
+    if (bits) {
+        for (int i = 0; i < netStateFields; i++) {
+            if (getBits(&s, 16, &bits) != 0) {
+                return -1;
+            }
+            *stateField(&result, i) = (short) bits;
+        }
+        *out = result;
+        return 0;
+    }
+
+    for (int i = 0; i < netStateFields; i++) {
+        int* field = stateField(&result, i);
+        if (getBits(&s, 1, &bits) != 0) {
+            return -1;
+        }
+        if (!bits) {
+            continue;
+        }
+        if (fieldKinds[i] == FIELD_DIRECTION) {
+            *field = -*field;
+        } else if (fieldKinds[i] == FIELD_POSITION) {
+            if (getBits(&s, 1, &bits) != 0) {
+                return -1;
+            }
+            int small = !bits;
+            if (getBits(&s, small ? netSmallDeltaBits : fieldWidths[FIELD_POSITION], &bits) != 0) {
+                return -1;
+            }
+            *field = small ? *field + unzigzag(bits) : unzigzag(bits);
+        } else {
+            if (getBits(&s, fieldWidths[fieldKinds[i]], &bits) != 0) {
+                return -1;
+            }
+            *field = (int) bits;
+        }
+    }
+    *out = result;
+    return 0;
+}
+
+int netStateChecksum(const Global* g){
+    //the low bits of the rules' own state hash, over the same 16 bit fields the snapshots carry
+    Global state = *g;
+    for (int i = 0; i < netStateFields; i++) {
+        *stateField(&state, i) = (short) *stateField(&state, i);
+    }
+    //the sub-pixel fields are not sent either
+    state.ballFraction = (Point){0, 0};
+    state.aiPaddleFraction = 0;
+    state.tickScale = 0;
+    unsigned int hash = simStateHash(&state);
+    return (int) ((hash ^ hash >> 16) & 0xffffu);
+}
+
+int netOpenSocket(int port, int sharePort){
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    int on = 1;
+    if (sharePort && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) != 0) {
+        close(fd);
+        return -1;
+    }
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons((unsigned short) port);
+    if (bind(fd, (struct sockaddr*) &address, sizeof(address)) != 0
+        || fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int netResolve(const char* address, struct sockaddr_in* out){
+    char host[256];
+    int port = netDefaultPort;
+    strncpy(host, address, sizeof(host) - 1);
+    host[sizeof(host) - 1] = '\0';
+    char* colon = strrchr(host, ':');
+    if (colon != NULL) {
+        *colon = '\0';
+        port = atoi(colon + 1);
+    }
+
+    struct addrinfo hints;
+    struct addrinfo* result;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    if (port <= 0 || port > 65535 || getaddrinfo(host, NULL, &hints, &result) != 0) {
+        return -1;
+    }
+    *out = *(struct sockaddr_in*) result->ai_addr;
+    out->sin_port = htons((unsigned short) port);
+    freeaddrinfo(result);
+    return 0;
+}
+
+int netSend(int fd, const struct sockaddr_in* to, const NetPacket* packet){
+    unsigned char buffer[netMaxDatagram];
+    int size = netEncode(packet, buffer);
+    return sendto(fd, buffer, (size_t) size, 0, (const struct sockaddr*) to, sizeof(*to)) == size ? size : -1;
+}
+
+int netReceive(int fd, struct sockaddr_in* from, NetPacket* packet, int* bytes){
+    unsigned char buffer[netMaxDatagram];
+    for (;;) {
+        socklen_t length = sizeof(*from);
+        ssize_t size = recvfrom(fd, buffer, sizeof(buffer), 0, (struct sockaddr*) from, &length);
+        if (size < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return 0;
+        }
+        //anything malformed is dropped, the next datagram may be fine
+        if (netDecode(buffer, (int) size, packet) == 0) {
+            if (bytes != NULL) {
+                *bytes = (int) size;
+            }
+            return 1;
+        }
+    }
+}
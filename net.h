@@ -0,0 +1,75 @@
+// Network protocol
+// The server is authoritative: it runs the rules and sends snapshots of the state, clients only
+// send their paddle input tagged with the tick it is meant for. Everything travels as small UDP
+// datagrams with fixed little endian layouts, so nothing depends on struct padding or byte order.
+
+#ifndef NET_H
+#define NET_H
+
+#include <netinet/in.h>
+#include "pong.h"
+
+#define netDefaultPort 30800
+#define netMaxDatagram 512
+#define netInputRedundancy 4 //every input is sent this many times, a lost datagram costs nothing
+#define netTimeoutSeconds 5.0 //a peer that stays silent this long is dropped
+#define netMaxDelta 32 //largest bit-packed state delta in bytes
+#define netDeltaHistory 64 //ticks a delta base may lie back, both ends keep this many states
+#define netUdpOverhead 28 //IPv4 + UDP header bytes per datagram, counted against a viewer's rate
+
+typedef enum NetMessage{
+    NET_HELLO = 1, //client -> server, asks for a match
+    NET_WELCOME,   //server -> client, the current tick to line up with
+    NET_INPUT,     //client -> server, paddle top y for the last few ticks
+    NET_SNAPSHOT,  //server -> client, the full state before a tick
+    NET_BYE,       //either way, leaving
+    NET_WATCH,     //viewer -> server, asks to spectate a match
+    NET_DELTA,     //server -> viewer, the state after a tick as a delta against an acked one
+    NET_ACK        //viewer -> server, newest delta decoded
+} NetMessage;
+
+typedef struct NetPacket{
+    NetMessage type;
+    unsigned int nonce; //HELLO/WELCOME, echoed to measure the round trip
+    long tick; //WELCOME/SNAPSHOT: server tick, INPUT: tick of the newest input
+    int tickRate; //WELCOME
+    int inputCount; //INPUT, inputs[0] is for tick, inputs[i] for tick - i
+    int inputs[netInputRedundancy];
+    int inputLead; //SNAPSHOT: newest input tick the server had minus tick, negative if inputs are late
+    Global state; //SNAPSHOT, without the tick scale, which follows from the WELCOME's tick rate
+    int match; //WATCH: which of the server's matches, wraps around
+    int rate; //WATCH: most bytes/sec the viewer wants, headers included
+    long baseTick; //DELTA: tick the delta is against, equal to tick for a key frame
+    int checksum; //DELTA: netStateChecksum of the decoded state
+    int deltaSize; //DELTA
+    long received; //ACK: deltas that arrived so far, tells the server how many were lost
+    unsigned char delta[netMaxDelta]; //DELTA: netEncodeDelta output
+} NetPacket;
+
+//Returns the encoded size
+int netEncode(const NetPacket* packet, unsigned char* buffer);
+//Returns -1 if the datagram is not a valid message
+int netDecode(const unsigned char* buffer, int size, NetPacket* packet);
+
+//Bit-packs state as a delta against base, or against the initGlobals state if base is NULL
+//(a key frame). Every field has a small fixed width: scores 4 bits, directions 1, positions
+//12 and a position that moved less than 32 pixels only 7, an unchanged field costs 1 bit.
+//A state that does not fit these widths is sent with 16 bits per field. Returns the size.
+int netEncodeDelta(const Global* base, const Global* state, unsigned char* out);
+//Returns -1 if the delta is malformed
+int netDecodeDelta(const Global* base, const unsigned char* delta, int size, Global* out);
+//16 bit checksum of a state, lets a viewer notice a delta decoded against the wrong base
+int netStateChecksum(const Global* g);
+
+//Non-blocking UDP socket bound to port (0 = any), -1 on failure. With sharePort every socket
+//bound to the port gets its own share of the peers, the kernel hashes each peer to one of them.
+int netOpenSocket(int port, int sharePort);
+//"host:port" or "host" (default port), -1 if it does not resolve
+int netResolve(const char* address, struct sockaddr_in* out);
+
+//Returns the datagram size or -1
+int netSend(int fd, const struct sockaddr_in* to, const NetPacket* packet);
+//Returns 1 if a valid packet was read (its size in *bytes, which may be NULL), 0 if none is waiting
+int netReceive(int fd, struct sockaddr_in* from, NetPacket* packet, int* bytes);
+
+#endif
@@ -0,0 +1,205 @@
+// Codec tests
+// Round trips random base/state pairs through netEncodeDelta/netDecodeDelta: small moves against
+// a recent base, key frames against the initGlobals state, fields that only fit the 16 bit
+// fallback and fields beyond 16 bits, which the fallback truncates like the snapshots do. Every
+// decoded state has to carry the sender's checksum, and truncated or random deltas have to be
+// rejected or decode without reading past their end. Exits non-zero on the first failure.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "net.h"
+#include "testutil.h"
+
+#define testRounds 200000
+
+//The fields the codec carries, in its order
+static int* field(Global* g, int i){
+    int* fields[] = {
+        &g->playerPaddlePosition.x, &g->playerPaddlePosition.y, &g->aiPaddlePosition.x, &g->aiPaddlePosition.y,
+        &g->playerScore, &g->aiScore, &g->ballPosition.x, &g->ballPosition.y, &g->ballSpeed,
+        &g->ballDirection.x, &g->ballDirection.y, &g->lastScore, &g->gameOver
+    };
+    return fields[i];
+}
+#define fieldCount 13
+
+//A state the rules can reach
+static void randomState(Global* g){
+    simInitGlobals(g);
+    g->playerPaddlePosition.y = testRandomBetween(-200, screenHeight);
+    g->aiPaddlePosition.y = testRandomBetween(-200, screenHeight);
+    g->playerScore = testRandomBetween(0, winningScore);
+    g->aiScore = testRandomBetween(0, winningScore);
+    g->ballPosition.x = testRandomBetween(0, ballMaxX + 40);
+    g->ballPosition.y = testRandomBetween(0, ballMaxY + 40);
+    g->ballSpeed = testRandomBetween(1, 40);
+    g->ballDirection.x = testRandomSign();
+    g->ballDirection.y = testRandomSign();
+    g->lastScore = testRandomBetween(0, 1);
+    g->gameOver = testRandomBetween(0, 1);
+}
+
+//A tick or a few later: most fields unchanged, positions moved by a little
+static void nearbyState(const Global* base, Global* g){
+    *g = *base;
+    for (int i = 0; i < fieldCount; i++) {
+        if (testRandom() % 4 != 0) {
+            continue;
+        }
+        switch (i) {
+            case 9:
+            case 10:
+                *field(g, i) = -*field(g, i);
+                break;
+            case 4:
+            case 5:
+                *field(g, i) = testRandomBetween(0, winningScore);
+                break;
+            case 11:
+            case 12:
+                *field(g, i) ^= 1;
+                break;
+            default:
+                *field(g, i) += testRandomBetween(-40, 40);
+                break;
+        }
+    }
+}
+
+//Fields the compact widths cannot hold: directions that are not +-1, negative or huge speeds and
+//scores, and now and then a value beyond 16 bits
+static void outOfRange(Global* g){
+    int i = testRandomBetween(0, fieldCount - 1);
+    switch (testRandom() % 4) {
+        case 0:
+            *field(g, i) = testRandomBetween(-32768, 32767);
+            break;
+        case 1:
+            *field(g, i) = (int) testRandom();
+            break;
+        case 2:
+            *field(g, i) = testRandomBetween(-3, 3);
+            break;
+        default:
+            *field(g, i) = testRandomBetween(4096, 8191);
+            break;
+    }
+}
+
+//What the receiver should end up with: every field as the 16 bits a datagram carries
+static void truncated(const Global* state, Global* out){
+    *out = *state;
+    for (int i = 0; i < fieldCount; i++) {
+        *field(out, i) = (short) *field(out, i);
+    }
+}
+
+static int sameFields(Global* a, Global* b){
+    for (int i = 0; i < fieldCount; i++) {
+        if (*field(a, i) != *field(b, i)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+//Encodes state against base (NULL for a key frame) as a DELTA datagram and decodes it again
+static int roundTrip(long round, const Global* base, const Global* state){
+    NetPacket packet, decoded;
+    memset(&packet, 0, sizeof(packet));
+    packet.type = NET_DELTA;
+    packet.tick = round + 1;
+    packet.baseTick = base == NULL ? packet.tick : round;
+    packet.checksum = netStateChecksum(state);
+    packet.deltaSize = netEncodeDelta(base, state, packet.delta);
+    if (packet.deltaSize <= 0 || packet.deltaSize > netMaxDelta) {
+        fprintf(stderr, "net_test: round %ld, delta of %d bytes\n", round, packet.deltaSize);
+        return -1;
+    }
+
+    unsigned char datagram[netMaxDatagram];
+    int size = netEncode(&packet, datagram);
+    if (netDecode(datagram, size, &decoded) != 0 || decoded.type != NET_DELTA || decoded.tick != packet.tick
+        || decoded.baseTick != packet.baseTick || decoded.checksum != packet.checksum
+        || decoded.deltaSize != packet.deltaSize || memcmp(decoded.delta, packet.delta, (size_t) packet.deltaSize) != 0) {
+        fprintf(stderr, "net_test: round %ld, DELTA datagram did not survive netEncode/netDecode\n", round);
+        return -1;
+    }
+
+    Global result, expected;
+    truncated(state, &expected);
+    if (netDecodeDelta(base, decoded.delta, decoded.deltaSize, &result) != 0 || !sameFields(&result, &expected)
+        || netStateChecksum(&result) != decoded.checksum) {
+        fprintf(stderr, "net_test: round %ld, %s did not decode to the state sent\n", round,
+                base == NULL ? "key frame" : "delta");
+        if (base != NULL) {
+            testPrintState("base", base);
+        }
+        testPrintState("sent", &expected);
+        testPrintState("decoded", &result);
+        return -1;
+    }
+
+    //every shorter prefix is malformed, decoding it must fail instead of reading past the end
+    for (int cut = 0; cut < decoded.deltaSize; cut++) {
+        Global partial;
+        if (netDecodeDelta(base, decoded.delta, cut, &partial) == 0) {
+            fprintf(stderr, "net_test: round %ld, a %d byte prefix of a %d byte delta decoded\n", round, cut,
+                    decoded.deltaSize);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int main(){
+    testSeed(12345);
+    long fallbacks = 0;
+    long keyFrames = 0;
+    long garbage = 0;
+    Global base, state;
+
+    for (long round = 0; round < testRounds; round++) {
+        randomState(&base);
+        switch (round % 4) {
+            case 0:
+                randomState(&state);
+                break;
+            case 1:
+                nearbyState(&base, &state);
+                break;
+            case 2:
+                nearbyState(&base, &state);
+                outOfRange(&state);
+                break;
+            default:
+                randomState(&state);
+                outOfRange(&state);
+                break;
+        }
+        unsigned char delta[netMaxDelta];
+        fallbacks += netEncodeDelta(&base, &state, delta) > 0 && (delta[0] & 1u);
+        if (roundTrip(round, &base, &state) != 0) {
+            return 1;
+        }
+        if (round % 8 == 0) {
+            keyFrames++;
+            if (roundTrip(round, NULL, &state) != 0) {
+                return 1;
+            }
+        }
+
+        //random bytes must either decode or be rejected, never read past their size
+        unsigned char noise[netMaxDelta];
+        int size = testRandomBetween(0, netMaxDelta);
+        for (int i = 0; i < size; i++) {
+            noise[i] = (unsigned char) testRandom();
+        }
+        Global decoded;
+        garbage += netDecodeDelta(&base, noise, size, &decoded) != 0;
+    }
+    printf("net_test: %d round trips, %ld key frames, %ld through the 16 bit fallback, %ld random deltas rejected\n",
+           testRounds, keyFrames, fallbacks, garbage);
+    return 0;
+}
@@ -0,0 +1,164 @@
+// Network client, see netclient.h
+
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include "netclient.h"
+#include "timestep.h"
+
+#define clientPredictionTicks 256 //how far back a snapshot can still correct the prediction
+#define clientMaxLead 8 //input arriving this many ticks early means we run too far ahead
+
+static void sendPacket(NetClient* c, const NetPacket* packet){
+    int size = netSend(c->fd, &c->server, packet);
+    if (size > 0) {
+        c->bytesSent += size;
+    }
+}
+
+static void playTick(NetClient* c, int paddleY);
+
+int netClientConnect(NetClient* c, const char* address, int sweptCollisions){
+    memset(c, 0, sizeof(NetClient));
+    c->fd = -1;
+    if (netResolve(address, &c->server) != 0) {
+        return -1;
+    }
+    c->fd = netOpenSocket(0, 0);
+    if (c->fd < 0 || rollbackInit(&c->prediction, clientPredictionTicks, 1, sweptCollisions) != 0) {
+        if (c->fd >= 0) {
+            close(c->fd);
+        }
+        return -1;
+    }
+
+    //hello every 200 ms until welcomed, for up to the timeout
+    NetPacket hello;
+    memset(&hello, 0, sizeof(hello));
+    hello.type = NET_HELLO;
+    double start = timestepNow();
+    for (unsigned int attempt = 1; timestepNow() - start < netTimeoutSeconds; attempt++) {
+        double sent = timestepNow();
+        hello.nonce = attempt;
+        sendPacket(c, &hello);
+        struct pollfd wait = {c->fd, POLLIN, 0};
+        while (poll(&wait, 1, 200) > 0) {
+            struct sockaddr_in from;
+            NetPacket reply;
+            int bytes;
+            if (!netReceive(c->fd, &from, &reply, &bytes)) {
+                break;
+            }
+            c->bytesReceived += bytes;
+            if (reply.type == NET_BYE) {
+                netClientClose(c);
+                return -1;
+            }
+            if (reply.type != NET_WELCOME || reply.nonce != attempt) {
+                continue;
+            }
+            c->roundTrip = timestepNow() - sent;
+            c->tickRate = reply.tickRate > 0 ? reply.tickRate : 60;
+            c->lastHeard = timestepNow();
+            //a new match starts from initGlobals on tick 0, rejoining jumps to the server's tick
+            //and waits for the first snapshot to correct the state
+            Global initial;
+            simInitGlobals(&initial);
+            initial.tickScale = simTickScale(c->tickRate);
+            rollbackReset(&c->prediction, &initial);
+            rollbackCorrect(&c->prediction, reply.tick, &initial);
+            for (int i = 0; i < netInputRedundancy; i++) {
+                c->history[i] = initial.playerPaddlePosition.y;
+            }
+            c->acked = -1;
+            //run ahead by half the round trip plus a little, so our input arrives in time;
+            //the server repeats the initial paddle position until it hears from us
+            long lead = (long) (c->roundTrip * 0.5 * c->tickRate) + 2;
+            for (long i = 0; i < lead; i++) {
+                playTick(c, initial.playerPaddlePosition.y);
+            }
+            c->inputLead = (int) lead;
+            return 0;
+        }
+    }
+    netClientClose(c);
+    return -1;
+}
+
+void netClientClose(NetClient* c){
+    if (c->fd >= 0) {
+        NetPacket bye;
+        memset(&bye, 0, sizeof(bye));
+        bye.type = NET_BYE;
+        sendPacket(c, &bye);
+        close(c->fd);
+        c->fd = -1;
+    }
+    rollbackFree(&c->prediction);
+}
+
+//Applies every snapshot that arrived, the newest one decides the lead
+void netClientReceive(NetClient* c){
+    struct sockaddr_in from;
+    NetPacket packet;
+    int bytes;
+    while (netReceive(c->fd, &from, &packet, &bytes)) {
+        c->bytesReceived += bytes;
+        c->lastHeard = timestepNow();
+        if (packet.type == NET_BYE) {
+            c->disconnected = 1;
+        }
+        if (packet.type != NET_SNAPSHOT || packet.tick <= c->acked) {
+            continue;
+        }
+        c->acked = packet.tick;
+        c->snapshots++;
+        c->inputLead = packet.inputLead;
+        packet.state.tickScale = simTickScale(c->tickRate);
+        if (rollbackCorrect(&c->prediction, packet.tick, &packet.state) == 1) {
+            c->corrections++;
+        }
+    }
+    if (timestepNow() - c->lastHeard > netTimeoutSeconds) {
+        c->disconnected = 1;
+    }
+}
+
+//Records and sends the input for the present tick, then plays it
+static void playTick(NetClient* c, int paddleY){
+    Rollback* r = &c->prediction;
+    memmove(&c->history[1], &c->history[0], sizeof(int) * 3);
+    c->history[0] = paddleY;
+
+    NetPacket input;
+    memset(&input, 0, sizeof(input));
+    input.type = NET_INPUT;
+    input.tick = r->tick;
+    input.inputCount = netInputRedundancy;
+    for (int i = 0; i < netInputRedundancy; i++) {
+        input.inputs[i] = c->history[i];
+    }
+    sendPacket(c, &input);
+
+    rollbackInput(r, 0, r->tick, paddleY);
+    rollbackAdvance(r);
+}
+
+void netClientTick(NetClient* c, int paddleY){
+    netClientReceive(c);
+    if (c->inputLead > clientMaxLead) {
+        //far ahead of the server, let it catch up
+        c->inputLead--;
+        return;
+    }
+    playTick(c, paddleY);
+    if (c->inputLead < 0) {
+        //our input arrives late, get further ahead
+        playTick(c, paddleY);
+        c->inputLead++;
+    }
+}
+
+const Global* netClientState(const NetClient* c){
+    return &c->prediction.state;
+}
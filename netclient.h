@@ -0,0 +1,47 @@
+// Network client
+// Plays a match on the authoritative server. The client runs ahead of the server by about half
+// a round trip, so its input reaches the server before the tick it is meant for, and predicts
+// the whole state locally with the rollback engine. Every server snapshot is compared with the
+// prediction for its tick; if they differ the snapshot wins and the ticks since are re-simulated.
+
+#ifndef NETCLIENT_H
+#define NETCLIENT_H
+
+#include <netinet/in.h>
+#include "net.h"
+#include "rollback.h"
+
+typedef struct NetClient{
+    int fd;
+    struct sockaddr_in server;
+    int tickRate; //the server's
+    Rollback prediction;
+    int history[netInputRedundancy]; //newest inputs first, resent with every input
+    long acked; //newest snapshot tick received
+    int inputLead; //from the newest snapshot, ticks our input arrives ahead of its tick
+    int disconnected; //the server said bye or went silent
+    double lastHeard;
+    double roundTrip; //seconds, measured on connect
+    long snapshots;
+    long corrections; //snapshots that did not match the prediction
+    long long bytesSent;
+    long long bytesReceived;
+} NetClient;
+
+//Resolves "host[:port]", says hello and waits for the welcome, returns -1 on failure
+int netClientConnect(NetClient* c, const char* address, int sweptCollisions);
+//Says bye and frees everything
+void netClientClose(NetClient* c);
+
+//Plays one tick with paddleY as the player paddle's top, like mouse() before gameLogic,
+//after reconciling with every snapshot that arrived. May play a second tick to catch up
+//with the server or skip one to let it catch up.
+void netClientTick(NetClient* c, int paddleY);
+
+//Reconciles with the snapshots that arrived without playing a tick
+void netClientReceive(NetClient* c);
+
+//Predicted present state
+const Global* netClientState(const NetClient* c);
+
+#endif
@@ -0,0 +1,135 @@
+// Physics backends, see physics.h
+// The asm backend copies each match through the global state, the C backends call the sim*
+// rules directly so the compiler can inline the whole frame, and the SIMD backends load the
+// matches into a per-thread batch and run their own kernel set on it. Selecting a backend never
+// changes the kernels the batch engine picked for its own callers.
+
+#include <pthread.h>
+#include <string.h>
+#include "batch.h"
+#include "physics.h"
+
+static void asmStep(Global* matches, int count){
+    for (int i = 0; i < count; i++) {
+        global = matches[i];
+        gameLogic();
+        matches[i] = global;
+    }
+}
+
+static void cStep(Global* matches, int count){
+    for (int i = 0; i < count; i++) {
+        simGameLogic(&matches[i]);
+    }
+}
+
+static void branchlessStep(Global* matches, int count){
+    for (int i = 0; i < count; i++) {
+        simGameLogicBranchless(&matches[i]);
+    }
+}
+
+//Sized for the largest call on this thread and only reallocated when a call needs more lanes,
+//smaller calls park the lanes they do not use. Freed when the thread exits, through a key
+//whose destructor runs for every thread that allocated one.
+static _Thread_local MatchBatch threadBatch;
+static pthread_key_t threadBatchKey;
+static pthread_once_t threadBatchOnce = PTHREAD_ONCE_INIT;
+
+static void freeThreadBatch(void* batch){
+    batchFree(batch);
+}
+
+static void createThreadBatchKey(){
+    pthread_key_create(&threadBatchKey, freeThreadBatch);
+}
+
+static void batchStep(Global* matches, int count, const char* kernels){
+    if (count <= 0) {
+        return;
+    }
+    if (batchResize(&threadBatch, count) != 0) {
+        batchFree(&threadBatch);
+        if (batchInit(&threadBatch, count) != 0) {
+            cStep(matches, count);
+            return;
+        }
+        pthread_once(&threadBatchOnce, createThreadBatchKey);
+        pthread_setspecific(threadBatchKey, &threadBatch);
+    }
+    //the matches of a server share its tick rate
+    threadBatch.tickScale = matches[0].tickScale;
+    for (int i = 0; i < count; i++) {
+        batchLoad(&threadBatch, i, &matches[i]);
+    }
+    batchGameLogicWith(&threadBatch, kernels);
+    for (int i = 0; i < count; i++) {
+        batchStore(&threadBatch, i, &matches[i]);
+    }
+}
+
+static void avx512Step(Global* matches, int count){
+    batchStep(matches, count, "avx512");
+}
+
+static void avx2Step(Global* matches, int count){
+    batchStep(matches, count, "avx2");
+}
+
+static void sse41Step(Global* matches, int count){
+    batchStep(matches, count, "sse4.1");
+}
+
+static const PhysicsBackend backends[] = {
+    {"asm", asmStep, NULL, 0},
+    {"c", cStep, NULL, 1},
+    {"branchless", branchlessStep, NULL, 1},
+    {"avx512", avx512Step, "avx512", 1},
+    {"avx2", avx2Step, "avx2", 1},
+    {"sse4.1", sse41Step, "sse4.1", 1}
+};
+#define backendCount ((int) (sizeof(backends) / sizeof(backends[0])))
+
+static const PhysicsBackend* selected = &backends[0];
+
+int physicsSelect(const char* name){
+    if (strcmp(name, "simd") == 0) {
+        //widest first, the same order the batch engine picks in
+        for (int i = 0; i < backendCount; i++) {
+            if (backends[i].kernels != NULL && batchKernelsSupported(backends[i].kernels)) {
+                selected = &backends[i];
+                return 0;
+            }
+        }
+        return -1;
+    }
+    for (int i = 0; i < backendCount; i++) {
+        if (strcmp(backends[i].name, name) != 0) {
+            continue;
+        }
+        if (backends[i].kernels != NULL && !batchKernelsSupported(backends[i].kernels)) {
+            return -1;
+        }
+        selected = &backends[i];
+        return 0;
+    }
+    return -1;
+}
+
+const PhysicsBackend* physicsBackend(){
+    return selected;
+}
+
+void physicsGameLogic(Global* g){
+    selected->step(g, 1);
+}
+
+int physicsAvailable(const PhysicsBackend** out, int max){
+    int count = 0;
+    for (int i = 0; i < backendCount && count < max; i++) {
+        if (backends[i].kernels == NULL || batchKernelsSupported(backends[i].kernels)) {
+            out[count++] = &backends[i];
+        }
+    }
+    return count;
+}
@@ -0,0 +1,39 @@
+// Physics backends
+// One interface over every implementation of the tick rules (gameLogic): the inline assembly,
+// the portable C reference, its branchless variant and the SIMD batch kernels. They are bit for
+// bit identical, so any of them can drive a match; one is picked at startup and used for every
+// frame after that.
+
+#ifndef PHYSICS_H
+#define PHYSICS_H
+
+#include "pong.h"
+
+typedef struct PhysicsBackend{
+    const char* name;
+    //Runs gameLogic once on each of count independent matches. The SIMD backends run all of them
+    //in one batch, so one call over many matches is much cheaper than many calls over one.
+    void (*step)(Global* matches, int count);
+    const char* kernels; //batch kernels behind the backend, NULL if it does not use the batch engine
+    int reentrant; //0 = works through the global singleton, only one thread at a time may step
+} PhysicsBackend;
+
+//Picks the backend by name: "asm", "c", "branchless", one of the batch kernel sets "avx512", "avx2", "sse4.1",
+//or "simd" for the widest kernels the CPU supports (CPUID). Returns -1 if the name is unknown
+//or the CPU lacks the instructions. The batch engine's own kernel pick is left alone.
+int physicsSelect(const char* name);
+
+//The selected backend, "asm" until physicsSelect is called
+const PhysicsBackend* physicsBackend();
+
+//gameLogic on one match through the selected backend
+void physicsGameLogic(Global* g);
+
+//Every backend the CPU supports in a fixed order, for tools that compare them
+//Returns the number written, at most max
+int physicsAvailable(const PhysicsBackend** out, int max);
+
+//Names accepted by physicsSelect, for usage messages
+#define physicsNames "asm|c|branchless|simd|avx512|avx2|sse4.1"
+
+#endif
@@ -0,0 +1,673 @@
+// Nuri Ege Zararsiz
+
+// Game rules, split out of main.c so they can run without a window.
+
+#include <stdlib.h>
+#include "pong.h"
+
+Global global;
+
+void initGlobals(){
+    //Initializes the global variables
+    //They are all under the global struct, and can be access using global.variableName
+    //You should not change this function.
+    global.playerPaddlePosition = (Point){screenWidth - paddleOffset - paddleWidth, (screenHeight / 2) - paddleLength / 2};
+    global.aiPaddlePosition = (Point){paddleOffset, (screenHeight / 2) - (paddleLength / 2)};
+    global.playerScore = 0;
+    global.aiScore = 0;
+    global.ballPosition = initialBallPosition;
+    global.ballSpeed = initialBallSpeed;
+    global.ballDirection = initialBallDirection;
+    global.lastScore = 0;
+    global.gameOver = 0;
+}
+
+
+void resetBall(){
+    //EXAMPLE:
+    //This is an example of how your assembly functions should look like.
+    //You can use this as a template for your own code.
+    //I've provided the original C code that I wrote, and the corresponding assembly code.
+    //I recommend that you first write the C code and test if it works. Then you can convert it to assembly.
+
+    //Resets the ball to the initial position and speed.
+    //The ball will go in the opposite direction of the last player to score
+
+    //C code:
+    //global.ballPosition = initialBallPosition;
+    //if (global.lastScore == 0){
+    //    global.ballDirection = (Point) {-initialBallDirection.x, initialBallDirection.y};
+    //}
+    //else {
+    //    global.ballDirection = initialBallDirection;
+    //}
+    //global.ballSpeed = initialBallSpeed;
+
+    //Assembly code:
+    //You should always use __volatile__ to prevent the compiler from incorrectly optimizing away your code.
+    //__asm__ is the keyword to start writing assembly code.
+    //GCC uses AT&T syntax, which is different from Intel syntax that we have been using so far.
+    //The biggest changes are that the parameters are in reverse order.
+    //Registers are prefixed with a % sign. (Two % in our case to avoid the compiler from interpreting it as a positional argument)
+    //Integer literals are prefixed with a $ sign.
+    //To refer to the memory pointed to by a register you must use the () syntax.
+    //When a label is created, it can be referenced from anywhere in the code, so ensure your labels are unique.
+    //%= expands to a number unique to each copy of the asm statement, so every label ends in it: the labels
+    //stay unique when the compiler inlines or clones the function and the statement appears more than once.
+    __asm__ __volatile__(
+        //%0 is the first parameter, %1 is the second parameter, and so on.
+        //The parameters start counting from the output parameters then to the input parameters.
+        //So %5 in this case is the first input parameter(initialBallPosition.x).
+        //And %0 is the first output parameter(global.ballPosition.x).
+        //You must include the newline character at the end of each line.
+            "mov %5, %0\n" //This is equivalent to global.ballPosition.x = initialBallPosition.x; in C.
+            "mov %6, %1\n" // global.ballPosition.y = initialBallPosition.y;
+            "cmp $0, %10\n" // if (global.lastScore == 0)
+            "jne resetBallPlayer%=\n" // {
+            "mov %7, %%eax\n" // eax = initialBallDirection.x
+            "imul $-1, %%eax\n" // eax = -initialBallDirection.x
+            "mov %%eax, %2\n" // global.ballDirection.x = -initialBallDirection.x;
+            "mov %8, %3\n" // global.ballDirection.y = initialBallDirection.y;
+            "jmp resetBallEnd%=\n" // }
+            "resetBallPlayer%=:\n" // else {
+            "mov %7, %2\n" // global.ballDirection.x = initialBallDirection.x;
+            "mov %8, %3\n" // global.ballDirection.y = initialBallDirection.y;
+            "resetBallEnd%=:\n" // }
+            "mov %9, %4\n" // global.ballSpeed = initialBallSpeed;
+            //An example of how to use the eax register, and integer literals.
+            "mov $0, %%eax\n" //Now eax is 0
+            : "=m" (global.ballPosition.x), "=m" (global.ballPosition.y), "=m" (global.ballDirection.x), "=m" (global.ballDirection.y), "=m" (global.ballSpeed)
+        //Output parameters go here. Use "=r" for values stored in registers, use "=m" for values stored in memory
+            : "r" (initialBallPosition.x), "r" (initialBallPosition.y), "r" (initialBallDirection.x), "r" (initialBallDirection.y), "r" (initialBallSpeed), "r" (global.lastScore)
+        //Input parameters go here use "r" for values stored in registers, use "m" for values stored in memory
+            : "eax"
+        //You should list all the registers you use here, because they will be clobbered and the compiler has to know which ones to save
+            );
+}
+
+void updateBall(){
+    //Check if the ball collides with the edges of the screen, and check if it collides with the paddles. DONE
+    //If the ball collides with the edges of the screen, it will add a point to the other player and reset the ball. DONE
+    //If the ball collides with the paddles, it will change the x direction of the ball. DONE
+    //If the ball collides with the top or bottom of the screen, it will change the y direction of the ball. DONE
+    //The ball will also increase in speed every time it collides with the AI paddle. DONE
+    //Update the ball position using the global.ballSpeed and global.ballDirection variables DONE
+    //Make sure to update the global.lastScore variable to indicate who scored the last point DONE
+    __asm__ __volatile__(
+            "mov %4, %%eax\n"   //ballspeed
+            "imul %2, %%eax\n"  // ballspeed * x_dir
+            "add %%eax, %0\n"   // move horizontally
+
+            "mov $10, %%eax\n"  //left wall
+            "cmp %%eax, %0\n"
+            "jl check_goal%=\n"    //collision
+
+            "cmp %8, %0\n"  //right wall
+            "jg check_goal%=\n"    //collision
+
+            "mov %4, %%eax\n"
+            "imul %3, %%eax\n"
+            "add %%eax, %1\n"   //move vertically
+
+            "mov $10, %%eax\n"
+            "cmp %%eax, %1\n"   //upper wall
+            "jl neg_y%=\n"    //collision
+
+            "cmp %9, %1\n"  //lower wall
+            "jg neg_y%=\n"    //collision
+
+            "mov %0, %%eax\n"   //paddle left
+            "add %10, %%eax\n"
+            "cmp %11, %%eax\n"
+            "jng left_paddle_check%=\n"
+
+            "mov %11, %%eax\n"   //paddle right
+            "add %13, %%eax\n"
+            "cmp %%eax, %0\n"
+            "jnl left_paddle_check%=\n"
+
+            "mov %1, %%eax\n"   //paddle top
+            "add %10, %%eax\n"
+            "cmp %12, %%eax\n"
+            "jng left_paddle_check%=\n"
+
+            "mov %12, %%eax\n"   //paddle bottom
+            "add %14, %%eax\n"
+            "cmp %%eax, %1\n"
+            "jnl left_paddle_check%=\n"
+
+            //for sure in paddle range (hits from bottom or top will trickle :/)
+            "jmp neg_x%=\n"
+
+            "left_paddle_check%=:\n"  //ai paddle
+            // same logic here as right paddle
+            "mov %0, %%eax\n"
+            "add %10, %%eax\n"
+            "cmp %15, %%eax\n"
+            "jng update_ball%=\n"
+
+            "mov %15, %%eax\n"
+            "add %13, %%eax\n"
+            "cmp %%eax, %0\n"
+            "jnl update_ball%=\n"
+
+            "mov %1, %%eax\n"
+            "add %10, %%eax\n"
+            "cmp %16, %%eax\n"
+            "jng update_ball%=\n"
+
+            "mov %16, %%eax\n"
+            "add %14, %%eax\n"
+            "cmp %%eax, %1\n"
+            "jnl update_ball%=\n"
+
+            "add $1, %4\n" //ball speed up when ai hits
+            "jmp neg_x%=\n"
+
+            "neg_x%=:\n"  //negate ball direction x axis
+            "neg %2\n"
+            "jmp update_ball%=\n"
+
+            "neg_y%=:\n"  //negate ball direction y axis
+            "neg %3\n"
+            "jmp update_ball%=\n"
+
+            "check_goal%=:\n"
+            "mov %1, %%eax\n"   //goal bottom
+            "add %10, %%eax\n"
+            "cmp %18, %%eax\n"
+            "jge neg_x%=\n"   //goal post should negate direction no goal
+
+            "cmp %17, %1\n" //goal top
+            "jle neg_x%=\n"   //goal post should negate direction no goal
+
+            "jmp award_goal%=\n"  //if inside the goal, award
+
+            "award_goal%=:\n"
+            "cmp $1, %2\n"      //if ball goes right, ai scored
+            "je ai_score%=\n"
+
+            "jmp player_score%=\n"    //else player scored
+
+            "ai_score%=:\n"
+            "add $1, %6\n"
+            "mov $1, %7\n"
+            "call resetBall\n"  //award points and reset the ball
+            "jmp update_ball%=\n"
+
+            "player_score%=:\n"
+            "add $1, %5\n"
+            "mov $0, %7\n"      //award points and reset the ball
+            "call resetBall\n"
+            "update_ball%=:\n"
+            : "=m" (global.ballPosition.x), "=m" (global.ballPosition.y), "=m" (global.ballDirection.x), "=m" (global.ballDirection.y), "=m" (global.ballSpeed), "=m" (global.playerScore), "=m" (global.aiScore), "=m" (global.lastScore)
+            : "r" (ballMaxX), "r" (ballMaxY), "r" (ballSideLength), "r" (global.playerPaddlePosition.x), "r" (global.playerPaddlePosition.y), "r" (paddleWidth), "r" (paddleLength), "r" (global.aiPaddlePosition.x), "r" (global.aiPaddlePosition.y), "r" (goalTop), "r" (goalBottom)
+            : "eax"
+            );
+}
+
+void updateAI(){
+    //The AI is very simple, it just follows the ball on the Y axis only if the ball is on the left side of the screen
+    //It moves at the speed set by the global.aiSpeed variable
+
+    __asm__ __volatile__(
+            "cmp %3, %1\n"      //stay still if ball in the right side of the pitch
+            "jge end%=\n"
+
+            "cmp %0, %2\n"      //move according to the ball's y
+            "jl decrease_y%=\n"
+            "jg increase_y%=\n"
+            "jmp end%=\n"
+
+            "decrease_y%=:\n"
+            "sub %4, %0\n"  //decrease y by ai paddle speed
+            "jmp end%=\n"
+
+            "increase_y%=:\n"
+            "add %4, %0\n"  //increase y by ai paddle speed
+            "jmp end%=\n"
+
+            "end%=:\n"
+            : "=m" (global.aiPaddlePosition.y)
+            : "r" (global.ballPosition.x), "r" (global.ballPosition.y), "r" (screenWidth/2), "r" (aiPaddleSpeed)
+            : "eax"
+            );
+}
+
+void gameLogic(){
+    //The game is over when one of the players reaches 9 points otherwise call updateBall and updateAI
+    //Make sure to update the global.gameOver variable
+    __asm__ __volatile__(
+            "mov $9, %%eax\n"   //check if game ended
+            "cmp %1, %%eax\n"
+            "je player_wins%=\n"
+
+            "mov $9, %%eax\n"   //check if game ended
+            "cmp %2, %%eax\n"
+            "je ai_wins%=\n"
+
+            "call updateBall\n"     //if didn't end continue calling updateball and ai
+            "call updateAI\n"
+            "jmp not_over%=\n"
+
+            "player_wins%=:\n"
+            //do smt                no instruction given in terms of celebration for player
+            "jmp game_end%=\n"
+
+            "ai_wins%=:\n"
+            //do another thing      no instruction given in terms of celebration for ai
+            "jmp game_end%=\n"
+
+            "game_end%=:\n"
+            "mov $1, %0\n"          //game_over = 1
+            "not_over%=:\n"
+            : "=m" (global.gameOver)
+            : "r" (global.playerScore), "r" (global.aiScore)
+            : "eax"
+            );
+}
+
+
+void mouse(int x, int y){
+    //The paddle is always centered on the mouse
+    __asm__ __volatile__(
+            "mov %1, %%eax\n"
+            "sub %2, %%eax\n"   // player paddle middle
+            "mov %%eax, %0\n"   //move with the mouse
+            : "=m" (global.playerPaddlePosition.y)
+            : "r" (y), "r" (paddleLength/2)
+            : "%eax"
+            );
+}
+
+void keyboard(unsigned char key, int x, int y){
+    //Pressing 'r' resets the game if the game is over
+    __asm__ __volatile__(
+            "cmp $0, %0\n"
+            "je no_reset%=\n" //when game continues do nothing
+
+            "game_over%=:\n"
+            "cmp $'r', %1\n"    //check if person hits r
+            "je restart_game%=\n"
+
+            "call exit\n"   //if not exit
+
+            "restart_game%=:\n"
+            "call initGlobals\n"    //initglobals = reset
+            "no_reset%=:\n"
+            : "=m" (global.gameOver)
+            : "r" (key)
+            : "eax"
+            );
+}
+
+//Reentrant C versions of the rules above
+//They operate on any Global instead of the global singleton, so many matches can run side by side.
+//They follow the assembly step by step and must stay bit for bit identical to it.
+
+void simInitGlobals(Global* g){
+    g->playerPaddlePosition = (Point){screenWidth - paddleOffset - paddleWidth, (screenHeight / 2) - paddleLength / 2};
+    g->aiPaddlePosition = (Point){paddleOffset, (screenHeight / 2) - (paddleLength / 2)};
+    g->playerScore = 0;
+    g->aiScore = 0;
+    g->ballPosition = initialBallPosition;
+    g->ballSpeed = initialBallSpeed;
+    g->ballDirection = initialBallDirection;
+    g->lastScore = 0;
+    g->gameOver = 0;
+    g->ballFraction = (Point){0, 0};
+    g->aiPaddleFraction = 0;
+    g->tickScale = 0;
+}
+
+void simResetBall(Global* g){
+    g->ballPosition = initialBallPosition;
+    g->ballFraction = (Point){0, 0};
+    if (g->lastScore == 0){
+        g->ballDirection = (Point) {-initialBallDirection.x, initialBallDirection.y};
+    }
+    else {
+        g->ballDirection = initialBallDirection;
+    }
+    g->ballSpeed = initialBallSpeed;
+}
+
+//60 Hz frames per tick, a zero tickScale is the reference rate
+static int scaleOf(const Global* g){
+    return g->tickScale != 0 ? g->tickScale : fixedOne;
+}
+
+int simTickScale(int tickRate){
+    return (int) ((60L * fixedOne + tickRate / 2) / tickRate);
+}
+
+//Q16.16 position of pixels + fraction
+static long long fixedPosition(int pixels, int fraction){
+    return (long long) pixels * fixedOne + fraction;
+}
+
+//Whole pixels and fraction of a Q16.16 position, rounded towards minus infinity
+static int fixedPixels(long long position){
+    return (int) (position >> 16);
+}
+
+static int fixedFraction(long long position){
+    return (int) (position & (fixedOne - 1));
+}
+
+//Moves *pixels and *fraction by speed pixels per frame for scale frames
+static void fixedMove(int* pixels, int* fraction, int speed, int scale){
+    if (scale == fixedOne) {
+        //whole frames leave the fraction alone, so the 60 Hz case stays the plain int add
+        *pixels += speed;
+        return;
+    }
+    long long position = fixedPosition(*pixels, *fraction) + (long long) speed * scale;
+    *pixels = fixedPixels(position);
+    *fraction = fixedFraction(position);
+}
+
+//true when the ball at (x, y) overlaps the paddle whose top left corner is at paddle
+static int ballHitsPaddle(int x, int y, Point paddle){
+    return x + ballSideLength > paddle.x && x < paddle.x + paddleWidth
+        && y + ballSideLength > paddle.y && y < paddle.y + paddleLength;
+}
+
+void simUpdateBall(Global* g){
+    int scale = scaleOf(g);
+    fixedMove(&g->ballPosition.x, &g->ballFraction.x, g->ballSpeed * g->ballDirection.x, scale);
+
+    if (g->ballPosition.x < 10 || g->ballPosition.x > ballMaxX) {
+        //goal posts bounce the ball back, y is not moved on this frame
+        if (g->ballPosition.y + ballSideLength >= goalBottom || g->ballPosition.y <= goalTop) {
+            g->ballDirection.x = -g->ballDirection.x;
+            return;
+        }
+        if (g->ballDirection.x == 1) {
+            g->aiScore++;
+            g->lastScore = 1;
+        } else {
+            g->playerScore++;
+            g->lastScore = 0;
+        }
+        simResetBall(g);
+        return;
+    }
+
+    fixedMove(&g->ballPosition.y, &g->ballFraction.y, g->ballSpeed * g->ballDirection.y, scale);
+
+    if (g->ballPosition.y < 10 || g->ballPosition.y > ballMaxY) {
+        g->ballDirection.y = -g->ballDirection.y;
+        return;
+    }
+
+    if (ballHitsPaddle(g->ballPosition.x, g->ballPosition.y, g->playerPaddlePosition)) {
+        g->ballDirection.x = -g->ballDirection.x;
+    } else if (ballHitsPaddle(g->ballPosition.x, g->ballPosition.y, g->aiPaddlePosition)) {
+        g->ballSpeed += 1; //ball speed up when ai hits
+        g->ballDirection.x = -g->ballDirection.x;
+    }
+}
+
+void simUpdateAI(Global* g){
+    if (g->ballPosition.x >= screenWidth / 2) {
+        return;
+    }
+    int speed = 0;
+    if (g->ballPosition.y < g->aiPaddlePosition.y) {
+        speed = -aiPaddleSpeed;
+    } else if (g->ballPosition.y > g->aiPaddlePosition.y) {
+        speed = aiPaddleSpeed;
+    }
+    fixedMove(&g->aiPaddlePosition.y, &g->aiPaddleFraction, speed, scaleOf(g));
+}
+
+int simTrackPaddle(const Global* g, int paddleY, int speed, int ourHalf){
+    int centerY = paddleY + paddleLength / 2;
+    int targetY = g->ballPosition.y + ballSideLength / 2;
+    if (!ourHalf || centerY == targetY) {
+        return paddleY;
+    }
+    return paddleY + (centerY < targetY ? speed : -speed);
+}
+
+void simGameLogic(Global* g){
+    if (g->playerScore == winningScore || g->aiScore == winningScore) {
+        g->gameOver = 1;
+        return;
+    }
+    simUpdateBall(g);
+    simUpdateAI(g);
+}
+
+//Branchless version of updateBall
+//updateBall is a chain of data dependent jumps for the walls, both paddles and the goal posts,
+//and the rare cases (a bounce, a goal) are exactly the ones the branch predictor gets wrong.
+//Here every predicate is computed up front, range checks folded into one unsigned compare each,
+//and turned into a mask of all zeros or all ones. Results are picked with mask selects and
+//negated with (v ^ mask) - mask, plain arithmetic with no jumps; plain ternaries are not enough,
+//GCC turns the stores behind them back into branches. Same outcome as simUpdateBall for every state.
+
+//low <= v <= high as one unsigned compare, 0 or 1
+#define inRange(v, low, high) ((unsigned int) ((v) - (low)) <= (unsigned int) ((high) - (low)))
+
+//mask ? a : b
+static int selectMask(int mask, int a, int b){
+    return b ^ ((a ^ b) & mask);
+}
+
+//mask ? -v : v
+static int negateMask(int mask, int v){
+    return (v ^ mask) - mask;
+}
+
+//ballHitsPaddle: the ball's top left corner strictly inside the paddle grown by the ball size
+static int paddleFlag(int x, int y, Point paddle){
+    return inRange(x, paddle.x - ballSideLength + 1, paddle.x + paddleWidth - 1)
+         & inRange(y, paddle.y - ballSideLength + 1, paddle.y + paddleLength - 1);
+}
+
+void simUpdateBallBranchless(Global* g){
+    int speed = g->ballSpeed;
+    int dx = g->ballDirection.x;
+    int dy = g->ballDirection.y;
+    int scale = scaleOf(g);
+    int y = g->ballPosition.y;
+    int x = g->ballPosition.x;
+    int movedY = y;
+    int fractionX = g->ballFraction.x;
+    int fractionY = g->ballFraction.y;
+    //the branch inside depends only on the tick rate, it is always predicted right
+    fixedMove(&x, &fractionX, speed * dx, scale);
+    fixedMove(&movedY, &fractionY, speed * dy, scale);
+
+    //side walls stop the frame before y moves, top and bottom walls before the paddles
+    int hitX = !inRange(x, 10, ballMaxX);
+    int hitY = !hitX & !inRange(movedY, 10, ballMaxY);
+    int open = !(hitX | hitY);
+    int playerHit = open & paddleFlag(x, movedY, g->playerPaddlePosition);
+    int aiHit = open & !playerHit & paddleFlag(x, movedY, g->aiPaddlePosition);
+    int goal = hitX & inRange(y, goalTop + 1, goalBottom - ballSideLength - 1);
+    int aiScored = goal & (dx == 1);
+
+    int goalMask = -goal;
+    int negX = -((hitX & !goal) | playerHit | aiHit);
+    //a goal resets the ball towards the player who conceded, like simResetBall
+    int serveDx = negateMask(aiScored - 1, initialBallDirection.x);
+    g->ballPosition.x = selectMask(goalMask, initialBallPosition.x, x);
+    g->ballPosition.y = selectMask(goalMask, initialBallPosition.y, selectMask(-hitX, y, movedY));
+    g->ballFraction.x = selectMask(goalMask, 0, fractionX);
+    g->ballFraction.y = selectMask(goalMask, 0, selectMask(-hitX, g->ballFraction.y, fractionY));
+    g->ballDirection.x = selectMask(goalMask, serveDx, negateMask(negX, dx));
+    g->ballDirection.y = selectMask(goalMask, initialBallDirection.y, negateMask(-hitY, dy));
+    g->ballSpeed = selectMask(goalMask, initialBallSpeed, speed + aiHit);
+    g->aiScore += aiScored;
+    g->playerScore += goal & !aiScored;
+    g->lastScore = selectMask(goalMask, aiScored, g->lastScore);
+}
+
+void simUpdateAIBranchless(Global* g){
+    int active = g->ballPosition.x < screenWidth / 2;
+    int up = active & (g->ballPosition.y < g->aiPaddlePosition.y);
+    int down = active & (g->ballPosition.y > g->aiPaddlePosition.y);
+    fixedMove(&g->aiPaddlePosition.y, &g->aiPaddleFraction, (down - up) * aiPaddleSpeed, scaleOf(g));
+}
+
+void simGameLogicBranchless(Global* g){
+    //taken once per match, so this branch is always predicted right
+    if (g->playerScore == winningScore || g->aiScore == winningScore) {
+        g->gameOver = 1;
+        return;
+    }
+    simUpdateBallBranchless(g);
+    simUpdateAIBranchless(g);
+}
+
+//Continuous collision version of updateBall
+//updateBall moves the ball a whole step and then tests for overlap, so a fast ball tunnels
+//through the paddles and a ball that clips a paddle's top or bottom edge gets its x direction
+//flipped every frame. Here the ball is swept along its path instead: the time of impact with
+//each wall and paddle is computed exactly, the ball advances to the earliest one, reflects off
+//the face it touched, and carries on with the rest of the step, bouncing as often as needed.
+//The ball always moves diagonally by the same distance on each axis, so every time of impact
+//is a whole number of Q16.16 pixels and the sweep stays in integers.
+
+#define sweptMaxBounces 16
+
+//Distance along the direction of travel until the Q16.16 pos reaches the pixel edge, negative
+//if already past it
+static long long sweptDistance(long long pos, int dir, int edge){
+    long long target = (long long) edge * fixedOne;
+    return dir > 0 ? target - pos : pos - target;
+}
+
+//Time of impact with a paddle for the ball at the Q16.16 (x, y), or -1 if it misses it this step
+//*faceX and *faceY are set to the faces touched, both at a corner
+static long long sweptPaddle(const Global* g, long long x, long long y, Point paddle, long long remaining,
+                             int* faceX, int* faceY){
+    int dx = g->ballDirection.x;
+    int dy = g->ballDirection.y;
+    //slab entry and exit for the ball's top left corner against the paddle grown by the ball size
+    long long enterX = sweptDistance(x, dx, dx > 0 ? paddle.x - ballSideLength : paddle.x + paddleWidth);
+    long long exitX = sweptDistance(x, dx, dx > 0 ? paddle.x + paddleWidth : paddle.x - ballSideLength);
+    long long enterY = sweptDistance(y, dy, dy > 0 ? paddle.y - ballSideLength : paddle.y + paddleLength);
+    long long exitY = sweptDistance(y, dy, dy > 0 ? paddle.y + paddleLength : paddle.y - ballSideLength);
+    long long enter = enterX > enterY ? enterX : enterY;
+    long long exit = exitX < exitY ? exitX : exitY;
+
+    //touching is not a hit, and a ball already inside a paddle is left to move out of it
+    if (enter >= exit || enter < 0 || enter > remaining) {
+        return -1;
+    }
+    *faceX = enterX >= enterY;
+    *faceY = enterY >= enterX;
+    return enter;
+}
+
+//Times and positions are Q16.16 pixels, a tick moves the ball ballSpeed pixels per 60 Hz frame
+void simUpdateBallSwept(Global* g){
+    long long remaining = (long long) g->ballSpeed * scaleOf(g);
+    long long x = fixedPosition(g->ballPosition.x, g->ballFraction.x);
+    long long y = fixedPosition(g->ballPosition.y, g->ballFraction.y);
+
+    for (int bounce = 0; bounce < sweptMaxBounces; bounce++) {
+        int dx = g->ballDirection.x;
+        int dy = g->ballDirection.y;
+        long long sideTime = sweptDistance(x, dx, dx > 0 ? ballMaxX : 10);
+        long long wallTime = sweptDistance(y, dy, dy > 0 ? ballMaxY : 10);
+        int playerFaceX = 0, playerFaceY = 0, aiFaceX = 0, aiFaceY = 0;
+        long long playerTime = sweptPaddle(g, x, y, g->playerPaddlePosition, remaining, &playerFaceX, &playerFaceY);
+        long long aiTime = sweptPaddle(g, x, y, g->aiPaddlePosition, remaining, &aiFaceX, &aiFaceY);
+        if (sideTime < 0) {
+            sideTime = 0;
+        }
+        if (wallTime < 0) {
+            wallTime = 0;
+        }
+
+        //earliest event in this step
+        long long time = remaining + 1;
+        if (sideTime < time) time = sideTime;
+        if (wallTime < time) time = wallTime;
+        if (playerTime >= 0 && playerTime < time) time = playerTime;
+        if (aiTime >= 0 && aiTime < time) time = aiTime;
+        if (time > remaining) {
+            x += dx * remaining;
+            y += dy * remaining;
+            break;
+        }
+
+        x += dx * time;
+        y += dy * time;
+        remaining -= time;
+
+        int negX = 0;
+        int negY = 0;
+        if (sideTime == time) {
+            //same goal and goal post rule as updateBall
+            if (fixedPixels(y) + ballSideLength < goalBottom && fixedPixels(y) > goalTop) {
+                if (dx == 1) {
+                    g->aiScore++;
+                    g->lastScore = 1;
+                } else {
+                    g->playerScore++;
+                    g->lastScore = 0;
+                }
+                simResetBall(g);
+                return;
+            }
+            negX = 1;
+        }
+        if (wallTime == time) {
+            negY = 1;
+        }
+        if (playerTime == time) {
+            negX |= playerFaceX;
+            negY |= playerFaceY;
+        }
+        if (aiTime == time) {
+            negX |= aiFaceX;
+            negY |= aiFaceY;
+            g->ballSpeed += 1; //ball speed up when ai hits, from the next frame on
+        }
+        if (negX) {
+            g->ballDirection.x = -dx;
+        }
+        if (negY) {
+            g->ballDirection.y = -dy;
+        }
+    }
+    g->ballPosition = (Point){fixedPixels(x), fixedPixels(y)};
+    g->ballFraction = (Point){fixedFraction(x), fixedFraction(y)};
+}
+
+void simGameLogicSwept(Global* g){
+    if (g->playerScore == winningScore || g->aiScore == winningScore) {
+        g->gameOver = 1;
+        return;
+    }
+    simUpdateBallSwept(g);
+    simUpdateAI(g);
+}
+
+//FNV-1a over the fields in declaration order, independent of struct padding
+unsigned int simStateHash(const Global* g){
+    const int fields[] = {
+        g->playerPaddlePosition.x, g->playerPaddlePosition.y, g->aiPaddlePosition.x, g->aiPaddlePosition.y,
+        g->playerScore, g->aiScore, g->ballPosition.x, g->ballPosition.y, g->ballSpeed,
+        g->ballDirection.x, g->ballDirection.y, g->lastScore, g->gameOver,
+        g->ballFraction.x, g->ballFraction.y, g->aiPaddleFraction, scaleOf(g)
+    };
+    //the sub-pixel fields are left out on the 60 Hz reference, where they are all at their defaults
+    int subPixel = g->ballFraction.x != 0 || g->ballFraction.y != 0 || g->aiPaddleFraction != 0
+                   || scaleOf(g) != fixedOne;
+    int count = subPixel ? 17 : 13;
+    unsigned int hash = 2166136261u;
+    for (int i = 0; i < count; i++) {
+        unsigned int value = (unsigned int) fields[i];
+        for (int byte = 0; byte < 4; byte++) {
+            hash = (hash ^ (value >> (8 * byte) & 0xffu)) * 16777619u;
+        }
+    }
+    return hash;
+}
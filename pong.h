@@ -0,0 +1,99 @@
+// Game state and rules shared by the windowed game and the headless tools.
+// Nothing in here depends on GLUT, GLFW or OpenGL.
+
+#ifndef PONG_H
+#define PONG_H
+
+//Represents a point in 2D space
+//x and y are in pixels
+typedef struct Point{
+    int x; //Pixels
+    int y; //Pixels
+} Point;
+
+//Global variables struct
+typedef struct Global{
+    Point playerPaddlePosition;
+    Point aiPaddlePosition;
+    int playerScore;
+    int aiScore;
+    Point ballPosition;
+    int ballSpeed; //Pixels/Frame
+    Point ballDirection;
+    int lastScore; //0 = player, 1 = ai
+    int gameOver; //0 = false, 1 = true
+    //Sub-pixel part of the state, used by the C rules when a tick is not one 60 Hz frame
+    //All zero on the 60 Hz reference, so a zeroed or decoded state is a valid 60 Hz state
+    Point ballFraction; //Pixels/65536, 0 to 65535
+    int aiPaddleFraction; //Pixels/65536, 0 to 65535
+    int tickScale; //60 Hz frames per tick in Q16.16, 0 = fixedOne
+} Global;
+extern Global global;
+
+//Consts you should not change these values.
+#define screenWidth 1920
+#define screenHeight 1080
+#define paddleOffset 120
+static const int aiPaddleSpeed = 5;
+static const int ballSpeedupFactor = 1;
+static const int paddleWidth = 40;
+static const int paddleLength = 200;
+static const int ballSideLength = 30;
+static const int initialBallSpeed = 5;
+static const Point initialBallPosition = (Point) {screenWidth / 2, screenHeight / 2};
+static const Point initialBallDirection = (Point) {1, 1};
+
+//Derived bounds used by updateBall
+#define ballMaxX (screenWidth - 40) //right wall, the ball's left edge may not pass it
+#define ballMaxY (screenHeight - 40) //lower wall, the ball's top edge may not pass it
+//goal is 3 times the paddle length, integer math only so every build and backend agrees
+#define goalTop (screenHeight / 2 - 3 * paddleLength / 2)
+#define goalBottom (screenHeight / 2 + 3 * paddleLength / 2)
+#define winningScore 9
+//Q16.16 fixed point: speeds stay in pixels per 60 Hz frame and every tick moves them by tickScale
+//frames, so the game runs at the same speed at any tick rate
+#define fixedOne 65536
+
+void initGlobals();
+void resetBall();
+void updateBall();
+void updateAI();
+void gameLogic();
+void mouse(int x, int y);
+void keyboard(unsigned char key, int x, int y);
+
+//Reentrant versions of the rules, operating on any match state
+//At a tickScale of fixedOne they are bit for bit identical to the assembly above, which stays
+//the 60 Hz reference and ignores the sub-pixel fields.
+void simInitGlobals(Global* g);
+void simResetBall(Global* g);
+void simUpdateBall(Global* g);
+void simUpdateAI(Global* g);
+void simGameLogic(Global* g);
+
+//tickScale for a tick rate in ticks per second, fixedOne at 60
+int simTickScale(int tickRate);
+
+//The "track" paddle policy, the one definition every scripted player and bot follows: the
+//paddle's new top after one step of speed pixels towards the ball's centre, taken only while
+//the ball is on the paddle's half. The batch kernel and the event engine restate it in their
+//own form and cite this function.
+int simTrackPaddle(const Global* g, int paddleY, int speed, int ourHalf);
+
+//Same rules without data dependent branches, every collision is a mask and every update a
+//select, so bounces and goals cost no mispredictions. Bit for bit identical to simGameLogic.
+void simUpdateBallBranchless(Global* g);
+void simUpdateAIBranchless(Global* g);
+void simGameLogicBranchless(Global* g);
+
+//Continuous collision rules: same game, but the ball is swept along its path so it never
+//tunnels through a paddle and bounces off paddle tops and bottoms
+void simUpdateBallSwept(Global* g);
+void simGameLogicSwept(Global* g);
+
+//32 bit hash of every field, cheap enough to take on every tick. Equal states hash equal on
+//every build, so two runs that report the same hashes went through the same states.
+//The sub-pixel fields only count when set, so 60 Hz states hash as they did before them.
+unsigned int simStateHash(const Global* g);
+
+#endif
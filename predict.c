@@ -0,0 +1,65 @@
+// Analytic trajectory predictor, see predict.h
+// The ball moves ballSpeed pixels on each axis per frame. Unfolding the field, i.e. mirroring
+// it at the top and bottom walls, turns the bouncing path into a straight line, and folding
+// the end point back is a modulo over twice the field height.
+//
+// updateBall only flips the y direction once a step has already gone past a wall, so the ball
+// turns around on the first point of its own step grid (y0 + k * ballSpeed) beyond each wall.
+// Those turning points are the effective walls for PREDICT_TICK.
+
+#include "predict.h"
+
+static long floorMod(long a, long m){
+    long r = a % m;
+    return r < 0 ? r + m : r;
+}
+
+int predictBallY(const Global* g, long distance, PredictRules rules, int* directionY){
+    long y = g->ballPosition.y;
+    long top = 10;
+    long bottom = ballMaxY;
+
+    if (rules == PREDICT_TICK) {
+        long speed = g->ballSpeed > 0 ? g->ballSpeed : 1;
+        top = 9 - floorMod(9 - y, speed); //last grid point above the upper wall
+        bottom = ballMaxY + 1 + floorMod(y - ballMaxY - 1, speed); //first grid point below the lower wall
+    }
+
+    long span = bottom - top;
+    int direction = g->ballDirection.y;
+    long folded = floorMod(y - top + direction * distance, 2 * span);
+    //the second half of the unfolded period is the mirrored field, flying through it backwards,
+    //and a ball stopped on a turning point has already flipped its direction
+    if (folded == 0) {
+        *directionY = 1;
+    } else if (folded == span) {
+        *directionY = -1;
+    } else {
+        *directionY = folded < span ? direction : -direction;
+    }
+    return (int) (folded <= span ? top + folded : top + 2 * span - folded);
+}
+
+int predictIntercept(const Global* g, int planeX, PredictRules rules, Intercept* out){
+    long speed = g->ballSpeed > 0 ? g->ballSpeed : 1;
+    long gap = g->ballDirection.x > 0 ? (long) planeX - g->ballPosition.x : (long) g->ballPosition.x - planeX;
+    long distance;
+
+    if (rules == PREDICT_TICK) {
+        //first frame that ends strictly past the plane
+        if (gap < 0) {
+            return -1;
+        }
+        out->ticks = (int) (gap / speed + 1);
+        distance = out->ticks * speed;
+    } else {
+        //exact contact, during the frame that covers it
+        if (gap < 0) {
+            return -1;
+        }
+        out->ticks = (int) ((gap + speed - 1) / speed);
+        distance = gap;
+    }
+    out->y = predictBallY(g, distance, rules, &out->directionY);
+    return 0;
+}
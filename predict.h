@@ -0,0 +1,35 @@
+// Analytic trajectory predictor
+// Computes in O(1) where and when the ball crosses a vertical plane, folding any number of
+// top/bottom wall reflections in closed form instead of simulating frame by frame.
+// Paddles are not considered, the ball is assumed to fly freely up to the plane.
+
+#ifndef PREDICT_H
+#define PREDICT_H
+
+#include "pong.h"
+
+typedef enum PredictRules{
+    PREDICT_TICK,  //updateBall / simUpdateBall: whole steps, walls reflect at the first step past them
+    PREDICT_SWEPT  //simUpdateBallSwept: exact reflection at the walls
+} PredictRules;
+
+typedef struct Intercept{
+    int ticks; //frame in which the crossing happens, 1 = the next gameLogic call
+    int y; //ball y (top edge) when it crosses
+    int directionY; //ball y direction right after the crossing
+} Intercept;
+
+//The ball crosses planeX when its x (left edge) gets past it in the direction of travel,
+//e.g. planeX = aiPaddlePosition.x + paddleWidth for the AI paddle's face
+//and planeX = playerPaddlePosition.x - ballSideLength for the player's.
+//For PREDICT_TICK the result is the state after that frame's updateBall,
+//for PREDICT_SWEPT it is the exact point of contact during that frame.
+//Returns -1 if the plane is behind the ball.
+int predictIntercept(const Global* g, int planeX, PredictRules rules, Intercept* out);
+
+//Ball y after flying freely for distance pixels along each axis, *directionY is set to the
+//direction afterwards. For PREDICT_TICK the distance should be a whole number of frames
+//(ticks * ballSpeed), since the ball only ever stops on those points.
+int predictBallY(const Global* g, long distance, PredictRules rules, int* directionY);
+
+#endif
@@ -0,0 +1,155 @@
+// Batched renderer, see renderer.h
+// The vertex buffer is a ring of rendererRingFrames frames. Each frame maps only its own range
+// unsynchronized, which the driver can hand out without waiting on the GPU because the frames
+// still being drawn use other parts of the buffer. When the ring wraps the whole buffer is
+// orphaned (invalidated), the driver gives it fresh storage and frees the old one once the GPU is done.
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include "glad.h"
+#include "renderer.h"
+
+#define rendererRingFrames 64
+#define rendererFrameVertices (sceneMaxVertices * 3) //a fan of n vertices becomes 3 (n - 2) triangle vertices
+
+static const char* const vertexSource =
+        "#version 330 core\n"
+        "layout (location = 0) in vec2 position;\n" //pixels
+        "layout (location = 1) in vec3 color;\n"
+        "uniform vec4 projection;\n" //pixels to screen space: scale in xy, offset in zw
+        "out vec3 vertexColor;\n"
+        "void main()\n"
+        "{\n"
+        "    vertexColor = color;\n"
+        "    gl_Position = vec4(position * projection.xy + projection.zw, 0.0, 1.0);\n"
+        "}\n";
+
+static const char* const fragmentSource =
+        "#version 330 core\n"
+        "in vec3 vertexColor;\n"
+        "out vec4 FragColor;\n"
+        "void main()\n"
+        "{\n"
+        "    FragColor = vec4(vertexColor, 1.0);\n"
+        "}\n";
+
+static GLuint program;
+static GLuint vertexArray;
+static GLuint vertexBuffer;
+static int ringFrame; //frame of the ring the next draw writes
+
+static GLuint compileShader(GLenum type, const char* source){
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+    GLint compiled = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+    if (!compiled) {
+        char log[512];
+        glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+        fprintf(stderr, "Renderer shader failed to compile: %s\n", log);
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+int rendererInit(int width, int height){
+    if (!GLAD_GL_VERSION_3_3) {
+        return -1;
+    }
+    GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexSource);
+    GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentSource);
+    if (vertexShader == 0 || fragmentShader == 0) {
+        return -1;
+    }
+    program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    glLinkProgram(program);
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+    GLint linked = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        fprintf(stderr, "Renderer program failed to link\n");
+        return -1;
+    }
+    //the mapping of pixelToScreenX and pixelToScreenY
+    glUseProgram(program);
+    glUniform4f(glGetUniformLocation(program, "projection"), 2.0f / (float) (width - 1), -2.0f / (float) (height - 1),
+                -1.0f, 1.0f);
+    glUseProgram(0);
+
+    glGenVertexArrays(1, &vertexArray);
+    glBindVertexArray(vertexArray);
+    glGenBuffers(1, &vertexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(SceneVertex) * rendererFrameVertices * rendererRingFrames, NULL,
+                 GL_STREAM_DRAW);
+    glVertexAttribPointer(0, 2, GL_SHORT, GL_FALSE, sizeof(SceneVertex), (void*) offsetof(SceneVertex, x));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(SceneVertex), (void*) offsetof(SceneVertex, r));
+    glEnableVertexAttribArray(1);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return 0;
+}
+
+void rendererDraw(const Scene* scene){
+    glBindVertexArray(vertexArray);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+    if (ringFrame == rendererRingFrames) {
+        ringFrame = 0;
+        access |= GL_MAP_INVALIDATE_BUFFER_BIT; //orphan
+    } else {
+        access |= GL_MAP_INVALIDATE_RANGE_BIT;
+    }
+    GLint first = ringFrame * rendererFrameVertices;
+    SceneVertex* mapped = glMapBufferRange(GL_ARRAY_BUFFER, (GLintptr) (sizeof(SceneVertex) * (size_t) first),
+                                              sizeof(SceneVertex) * rendererFrameVertices, access);
+    if (mapped == NULL) {
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        return;
+    }
+    ringFrame++;
+
+    //triangles first, fans split into triangles, then the lines behind them in the same range
+    int triangles = 0;
+    for (int i = 0; i < scene->shapeCount; i++) {
+        const SceneShape* shape = &scene->shapes[i];
+        if (shape->mode != SCENE_FAN) {
+            continue;
+        }
+        const SceneVertex* fan = &scene->vertices[shape->first];
+        for (int v = 2; v < shape->count; v++) {
+            mapped[triangles++] = fan[0];
+            mapped[triangles++] = fan[v - 1];
+            mapped[triangles++] = fan[v];
+        }
+    }
+    int lines = 0;
+    for (int i = 0; i < scene->shapeCount; i++) {
+        const SceneShape* shape = &scene->shapes[i];
+        if (shape->mode != SCENE_LINES) {
+            continue;
+        }
+        memcpy(&mapped[triangles + lines], &scene->vertices[shape->first], sizeof(SceneVertex) * (size_t) shape->count);
+        lines += shape->count;
+    }
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+
+    glUseProgram(program);
+    if (lines > 0) {
+        glDrawArrays(GL_LINES, first + triangles, lines);
+    }
+    if (triangles > 0) {
+        glDrawArrays(GL_TRIANGLES, first, triangles);
+    }
+    glUseProgram(0);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
@@ -0,0 +1,20 @@
+// Batched renderer
+// Draws a whole Scene with the OpenGL 3.3 API glad loads: every shape goes into one streamed
+// vertex buffer as 16 bit pixel coordinates with a colour per vertex, the vertex shader maps
+// pixels to screen space with a projection uniform, and the frame takes two draw calls (the wall
+// lines, then the triangles) instead of a glBegin/glEnd batch per quad. Runs in the compatibility
+// context GLUT creates, so the bitmap text still draws with the fixed function pipeline.
+
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include "scene.h"
+
+//Compiles the shaders and creates the buffers on the current context for a width x height pixel
+//field, returns -1 if the context does not have OpenGL 3.3
+int rendererInit(int width, int height);
+
+//Uploads and draws the scene, leaves no program or vertex array bound
+void rendererDraw(const Scene* scene);
+
+#endif
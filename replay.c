@@ -0,0 +1,378 @@
+// Match replays, see replay.h
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "replay.h"
+
+#define REPLAY_VERSION 2
+
+static const unsigned char replayMagic[4] = {'P', 'R', 'P', 'L'};
+
+//Record types, stored in the low three bits of the record's frame delta (two in version 1)
+enum{
+    RECORD_MOUSE,  //zigzag delta to the previous mouse y
+    RECORD_KEY,    //key code
+    RECORD_END,    //final player and ai score
+    RECORD_REPEAT, //the previous mouse delta again on this and the next count - 1 frames
+    RECORD_HASH    //simStateHash of the state the frame starts from
+};
+#define replayTypeBits 3
+
+static unsigned long zigzag(long value){
+    return ((unsigned long) value << 1) ^ (unsigned long) (value >> (sizeof(long) * 8 - 1));
+}
+
+static long unzigzag(unsigned long value){
+    return (long) (value >> 1) ^ -(long) (value & 1);
+}
+
+//LEB128: 7 bits per byte, high bit set on all but the last
+static void putVarint(FILE* file, unsigned long value){
+    while (value >= 0x80) {
+        putc((int) (value & 0x7f) | 0x80, file);
+        value >>= 7;
+    }
+    putc((int) value, file);
+}
+
+static int getVarint(ReplayFile* file, unsigned long* value){
+    unsigned long result = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (file->offset >= file->size) {
+            return -1;
+        }
+        unsigned char byte = file->data[file->offset++];
+        result |= (unsigned long) (byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static int getInt(ReplayFile* file, int* value){
+    unsigned long raw;
+    if (getVarint(file, &raw) != 0) {
+        return -1;
+    }
+    *value = (int) unzigzag(raw);
+    return 0;
+}
+
+//Global field by field, so the format does not depend on the struct layout
+static void putState(FILE* file, const Global* g){
+    const int fields[] = {
+        g->playerPaddlePosition.x, g->playerPaddlePosition.y, g->aiPaddlePosition.x, g->aiPaddlePosition.y,
+        g->playerScore, g->aiScore, g->ballPosition.x, g->ballPosition.y, g->ballSpeed,
+        g->ballDirection.x, g->ballDirection.y, g->lastScore, g->gameOver
+    };
+    for (int i = 0; i < (int) (sizeof(fields) / sizeof(fields[0])); i++) {
+        putVarint(file, zigzag(fields[i]));
+    }
+}
+
+static int getState(ReplayFile* file, Global* g){
+    int* fields[] = {
+        &g->playerPaddlePosition.x, &g->playerPaddlePosition.y, &g->aiPaddlePosition.x, &g->aiPaddlePosition.y,
+        &g->playerScore, &g->aiScore, &g->ballPosition.x, &g->ballPosition.y, &g->ballSpeed,
+        &g->ballDirection.x, &g->ballDirection.y, &g->lastScore, &g->gameOver
+    };
+    memset(g, 0, sizeof(Global));
+    for (int i = 0; i < (int) (sizeof(fields) / sizeof(fields[0])); i++) {
+        if (getInt(file, fields[i]) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int replayCreate(ReplayWriter* writer, const char* path){
+    memset(writer, 0, sizeof(ReplayWriter));
+    writer->file = fopen(path, "wb");
+    return writer->file != NULL ? 0 : -1;
+}
+
+int replayClose(ReplayWriter* writer){
+    if (writer->file == NULL) {
+        return 0;
+    }
+    if (writer->inMatch) {
+        //no final state to check against, the scores are marked unknown
+        Global unknown;
+        memset(&unknown, 0, sizeof(Global));
+        unknown.playerScore = -1;
+        unknown.aiScore = -1;
+        replayEndMatch(writer, &unknown);
+    }
+    int failed = ferror(writer->file);
+    if (fclose(writer->file) != 0) {
+        failed = 1;
+    }
+    writer->file = NULL;
+    return failed ? -1 : 0;
+}
+
+static void writeRecord(ReplayWriter* writer, long tick, int type){
+    putVarint(writer->file, (unsigned long) (tick - writer->lastRecordTick) << replayTypeBits | (unsigned long) type);
+    writer->lastRecordTick = tick;
+}
+
+static void flushRepeat(ReplayWriter* writer){
+    if (writer->repeatRun == 0) {
+        return;
+    }
+    writeRecord(writer, writer->lastMouseTick - writer->repeatRun + 1, RECORD_REPEAT);
+    putVarint(writer->file, (unsigned long) writer->repeatRun);
+    writer->lastRecordTick = writer->lastMouseTick;
+    writer->repeatRun = 0;
+}
+
+//Only the last mouse event before a frame or key matters, and only if it moved the paddle
+static void flushMouse(ReplayWriter* writer){
+    if (!writer->hasPendingMouse) {
+        return;
+    }
+    writer->hasPendingMouse = 0;
+    if (writer->mouseValid && writer->pendingMouseY == writer->lastMouseY) {
+        return;
+    }
+    int delta = writer->pendingMouseY - writer->lastMouseY;
+    writer->lastMouseY = writer->pendingMouseY;
+    writer->mouseValid = 1;
+    if (writer->canRepeat && delta == writer->lastMouseDelta && writer->tick == writer->lastMouseTick + 1) {
+        writer->repeatRun++;
+        writer->lastMouseTick = writer->tick;
+        return;
+    }
+    flushRepeat(writer);
+    writeRecord(writer, writer->tick, RECORD_MOUSE);
+    putVarint(writer->file, zigzag(delta));
+    writer->lastMouseDelta = delta;
+    writer->lastMouseTick = writer->tick;
+    writer->canRepeat = 1;
+}
+
+void replayBeginMatch(ReplayWriter* writer, const Global* initial, int tickRate, int sweptCollisions, unsigned int seed){
+    if (writer->inMatch) {
+        replayEndMatch(writer, initial);
+    }
+    fwrite(replayMagic, 1, sizeof(replayMagic), writer->file);
+    putc(REPLAY_VERSION, writer->file);
+    putVarint(writer->file, seed);
+    putVarint(writer->file, (unsigned long) tickRate);
+    //flags: 1 swept collisions, 2 motion scaled to the tick rate (simTickScale)
+    putVarint(writer->file, (sweptCollisions ? 1u : 0u) | (initial->tickScale != 0 ? 2u : 0u));
+    putState(writer->file, initial);
+
+    writer->tick = 0;
+    writer->lastRecordTick = 0;
+    writer->lastMouseY = initial->playerPaddlePosition.y + paddleLength / 2;
+    writer->hasPendingMouse = 0;
+    writer->mouseValid = 1;
+    writer->repeatRun = 0;
+    writer->canRepeat = 0;
+    writer->inMatch = 1;
+}
+
+void replayMouse(ReplayWriter* writer, int y){
+    writer->pendingMouseY = y;
+    writer->hasPendingMouse = 1;
+}
+
+void replayKey(ReplayWriter* writer, unsigned char key){
+    flushMouse(writer);
+    flushRepeat(writer);
+    writer->canRepeat = 0;
+    writeRecord(writer, writer->tick, RECORD_KEY);
+    putVarint(writer->file, key);
+    //a restart moves the paddle without a mouse event
+    writer->mouseValid = 0;
+}
+
+void replayTick(ReplayWriter* writer, const Global* g){
+    flushMouse(writer);
+    if (writer->tick % replayHashInterval == 0) {
+        //a run cannot stay open across another record
+        flushRepeat(writer);
+        writeRecord(writer, writer->tick, RECORD_HASH);
+        putVarint(writer->file, simStateHash(g));
+    }
+    writer->tick++;
+}
+
+void replayEndMatch(ReplayWriter* writer, const Global* final){
+    flushMouse(writer);
+    flushRepeat(writer);
+    writeRecord(writer, writer->tick, RECORD_END);
+    putVarint(writer->file, zigzag(final->playerScore));
+    putVarint(writer->file, zigzag(final->aiScore));
+    writer->inMatch = 0;
+}
+
+int replayOpen(ReplayFile* file, const char* path){
+    memset(file, 0, sizeof(ReplayFile));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+    file->size = (size_t) st.st_size;
+    if (file->size > 0) {
+        void* data = mmap(NULL, file->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            return -1;
+        }
+        madvise(data, file->size, MADV_SEQUENTIAL);
+        file->data = data;
+    }
+    //the mapping stays valid without the descriptor
+    close(fd);
+    return 0;
+}
+
+void replayUnmap(ReplayFile* file){
+    if (file->data != NULL) {
+        munmap((void*) file->data, file->size);
+    }
+    file->data = NULL;
+    file->size = 0;
+}
+
+//Loads the next record of the match into its pending record
+static int readRecord(ReplayMatch* match){
+    ReplayFile* file = match->file;
+    unsigned long head;
+    if (getVarint(file, &head) != 0) {
+        return -1;
+    }
+    match->recordTick += (long) (head >> file->typeBits);
+    match->recordType = (int) (head & ((1ul << file->typeBits) - 1));
+    switch (match->recordType) {
+        case RECORD_MOUSE:
+        case RECORD_KEY:
+        case RECORD_HASH:
+            return getVarint(file, &match->recordValue);
+        case RECORD_REPEAT:
+            if (getVarint(file, &match->recordValue) != 0 || match->recordValue == 0) {
+                return -1;
+            }
+            match->repeatLeft = (long) match->recordValue;
+            return 0;
+        case RECORD_END:
+            file->inMatch = 0;
+            if (getInt(file, &match->finalPlayerScore) != 0 || getInt(file, &match->finalAiScore) != 0) {
+                return -1;
+            }
+            return 0;
+        default:
+            return -1;
+    }
+}
+
+int replayNextMatch(ReplayFile* file, ReplayMatch* match){
+    memset(match, 0, sizeof(ReplayMatch));
+    match->file = file;
+    while (file->inMatch) {
+        if (readRecord(match) != 0) {
+            return -1;
+        }
+    }
+    if (file->offset == file->size) {
+        return 0;
+    }
+    match->offset = file->offset;
+    if (file->size - file->offset < sizeof(replayMagic) + 1
+        || memcmp(file->data + file->offset, replayMagic, sizeof(replayMagic)) != 0) {
+        return -1;
+    }
+    //version 1 files have no hash records and two type bits
+    int version = file->data[file->offset + sizeof(replayMagic)];
+    if (version != 1 && version != REPLAY_VERSION) {
+        return -1;
+    }
+    file->typeBits = version == 1 ? 2 : replayTypeBits;
+    file->offset += sizeof(replayMagic) + 1;
+
+    unsigned long seed, tickRate, flags;
+    if (getVarint(file, &seed) != 0 || getVarint(file, &tickRate) != 0 || getVarint(file, &flags) != 0
+        || getState(file, &match->initial) != 0) {
+        return -1;
+    }
+    match->seed = (unsigned int) seed;
+    match->tickRate = (int) tickRate;
+    match->sweptCollisions = (int) (flags & 1);
+    //matches recorded before the flag moved a whole frame per tick at any rate
+    match->initial.tickScale = (flags & 2) && tickRate > 0 ? simTickScale((int) tickRate) : 0;
+    match->mouseY = match->initial.playerPaddlePosition.y + paddleLength / 2;
+    match->hashMismatch = -1;
+    file->inMatch = 1;
+    return readRecord(match) == 0 ? 1 : -1;
+}
+
+int replaySeekMatch(const ReplayFile* file, size_t offset, ReplayFile* view, ReplayMatch* match){
+    *view = *file;
+    view->offset = offset;
+    view->inMatch = 0;
+    return replayNextMatch(view, match) == 1 ? 0 : -1;
+}
+
+int replayStep(ReplayMatch* match, Global* g){
+    return replayStepWith(match, g, match->sweptCollisions ? simGameLogicSwept : simGameLogic);
+}
+
+int replayStepWith(ReplayMatch* match, Global* g, void (*logic)(Global*)){
+    //inputs that arrived before this frame, in their original order
+    while (match->recordTick == match->tick) {
+        switch (match->recordType) {
+            case RECORD_END:
+                return 0;
+            case RECORD_MOUSE:
+                match->mouseDelta = (int) unzigzag(match->recordValue);
+                match->mouseY += match->mouseDelta;
+                g->playerPaddlePosition.y = match->mouseY - paddleLength / 2;
+                break;
+            case RECORD_REPEAT:
+                match->mouseY += match->mouseDelta;
+                g->playerPaddlePosition.y = match->mouseY - paddleLength / 2;
+                //the run stays pending for its remaining frames
+                if (--match->repeatLeft > 0) {
+                    match->recordTick++;
+                    continue;
+                }
+                break;
+            case RECORD_KEY:
+                //keyboard(): r restarts a finished game, any other key quits, which ends the recording
+                if (g->gameOver && match->recordValue == 'r') {
+                    int scale = g->tickScale;
+                    simInitGlobals(g);
+                    g->tickScale = scale;
+                }
+                break;
+            case RECORD_HASH:
+                match->hashChecks++;
+                if (match->hashMismatch < 0 && simStateHash(g) != (unsigned int) match->recordValue) {
+                    match->hashMismatch = match->tick;
+                }
+                break;
+        }
+        if (readRecord(match) != 0) {
+            return -1;
+        }
+    }
+    if (match->recordTick < match->tick) {
+        return -1;
+    }
+
+    logic(g);
+    match->tick++;
+    return 1;
+}
@@ -0,0 +1,100 @@
+// Match replays
+// A replay stores how a match started plus every input in order, which is all it takes to
+// play it again since the rules are deterministic. A file holds any number of matches back to
+// back. Each match is a header (seed, tick rate, rules, initial state) followed by one record per
+// input: the frame it came before, then a mouse y as a delta to the previous one or a key.
+// A mouse delta repeated on consecutive frames becomes a single run record. Every
+// replayHashInterval frames the state hash is recorded too, so a playback on other rules or
+// another build can tell where it went off. Everything is varint encoded, so idle frames and
+// steady mouse motion cost next to nothing.
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include "pong.h"
+
+#define replayHashInterval 128 //frames between state hash records
+
+typedef struct ReplayWriter{
+    FILE* file;
+    long tick; //frames recorded in the current match
+    long lastRecordTick; //frame of the previous record
+    int lastMouseY; //delta base for the next mouse record
+    int lastMouseDelta;
+    long lastMouseTick; //frame the last mouse delta was applied before
+    long repeatRun; //frames repeating lastMouseDelta that are not written yet
+    int canRepeat; //the last record was a mouse delta, so a run may follow it
+    int pendingMouseY; //last mouse event since the previous record, written lazily
+    int hasPendingMouse;
+    int mouseValid; //0 after a key, so the next mouse event is written even if it did not move
+    int inMatch;
+} ReplayWriter;
+
+//Returns -1 if the file cannot be created
+int replayCreate(ReplayWriter* writer, const char* path);
+//Writes the end of a match that is still open and closes the file, returns -1 on a write error
+int replayClose(ReplayWriter* writer);
+
+//Starts a match from the given state, rules as in the header's flags
+void replayBeginMatch(ReplayWriter* writer, const Global* initial, int tickRate, int sweptCollisions, unsigned int seed);
+//Inputs, recorded in the order they reach mouse() and keyboard()
+void replayMouse(ReplayWriter* writer, int y);
+void replayKey(ReplayWriter* writer, unsigned char key);
+//Call right before every gameLogic with the state it is about to run on
+void replayTick(ReplayWriter* writer, const Global* g);
+//Ends the match, the final scores are kept to check playbacks against
+void replayEndMatch(ReplayWriter* writer, const Global* final);
+
+//A replay file mapped into memory
+typedef struct ReplayFile{
+    const unsigned char* data;
+    size_t size;
+    size_t offset; //read position, shared by the matches read from the file
+    int inMatch; //a match was started and its end record not read yet
+    int typeBits; //record type bits of the match being read, 2 in version 1 files
+} ReplayFile;
+
+//One match being played back
+typedef struct ReplayMatch{
+    ReplayFile* file;
+    size_t offset; //where the match starts in the file
+    unsigned int seed;
+    int tickRate; //Ticks/Second the match was recorded at
+    int sweptCollisions;
+    Global initial;
+    long tick; //frames played so far
+    long recordTick; //frame the pending record comes before
+    int recordType;
+    unsigned long recordValue;
+    int mouseY;
+    int mouseDelta; //last mouse delta, applied again by runs
+    long repeatLeft; //frames left in the current run
+    int finalPlayerScore; //from the end record, valid once replayStep returned 0
+    int finalAiScore;
+    long hashChecks; //recorded state hashes compared so far
+    long hashMismatch; //first frame whose recorded state hash differs, -1 if none
+} ReplayMatch;
+
+//Returns -1 if the file cannot be opened or mapped
+int replayOpen(ReplayFile* file, const char* path);
+void replayUnmap(ReplayFile* file);
+
+//Reads the next match header, skipping the rest of a match that was not played to the end
+//Returns 1 if a match was read, 0 at the end of the file and -1 if the file is corrupt
+int replayNextMatch(ReplayFile* file, ReplayMatch* match);
+
+//Applies the inputs recorded before the next frame and plays it on g, which must start as
+//match->initial. Returns 1 if a frame was played, 0 at the end of the match and -1 if corrupt.
+int replayStep(ReplayMatch* match, Global* g);
+
+//Same, but plays the frame with logic instead of the rules the match was recorded with,
+//to check other implementations of the rules against the recording
+int replayStepWith(ReplayMatch* match, Global* g, void (*logic)(Global*));
+
+//Reads the match starting at offset (ReplayMatch.offset of an earlier read) into match, with
+//a read position of its own in *view, so matches of one file can be played on many threads
+int replaySeekMatch(const ReplayFile* file, size_t offset, ReplayFile* view, ReplayMatch* match);
+
+#endif
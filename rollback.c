@@ -0,0 +1,164 @@
+// Rollback engine, see rollback.h
+
+#include <stdlib.h>
+#include <string.h>
+#include "rollback.h"
+
+int rollbackInit(Rollback* r, int capacity, int inputPlayers, int sweptCollisions){
+    r->capacity = capacity > 1 ? capacity : 2;
+    r->inputPlayers = inputPlayers == 2 ? 2 : 1;
+    r->sweptCollisions = sweptCollisions;
+    r->snapshots = malloc(sizeof(Global) * (size_t) r->capacity);
+    r->inputs = malloc(sizeof(int) * (size_t) r->capacity * rollbackPlayers);
+    r->known = malloc((size_t) r->capacity * rollbackPlayers);
+    if (r->snapshots == NULL || r->inputs == NULL || r->known == NULL) {
+        rollbackFree(r);
+        return -1;
+    }
+    Global initial;
+    simInitGlobals(&initial);
+    rollbackReset(r, &initial);
+    return 0;
+}
+
+void rollbackFree(Rollback* r){
+    free(r->snapshots);
+    free(r->inputs);
+    free(r->known);
+    r->snapshots = NULL;
+    r->inputs = NULL;
+    r->known = NULL;
+}
+
+static int slot(const Rollback* r, long tick){
+    return (int) (tick % r->capacity) * rollbackPlayers;
+}
+
+//Predicts the unknown inputs of ticks from..present: a paddle keeps moving the way it moved
+//on the tick before, which is exact for as long as a player holds a steady speed
+static void predictInputs(Rollback* r, long from){
+    if (from < 1) {
+        from = 1;
+    }
+    for (long t = from; t <= r->tick; t++) {
+        int* inputs = &r->inputs[slot(r, t)];
+        const int* previous = &r->inputs[slot(r, t - 1)];
+        const int* before = t >= 2 && t - 2 > r->tick - r->capacity ? &r->inputs[slot(r, t - 2)] : previous;
+        const unsigned char* known = &r->known[slot(r, t)];
+        for (int p = 0; p < rollbackPlayers; p++) {
+            if (!known[p]) {
+                inputs[p] = 2 * previous[p] - before[p];
+            }
+        }
+    }
+}
+
+void rollbackReset(Rollback* r, const Global* initial){
+    r->state = *initial;
+    r->tick = 0;
+    r->dirtyTick = -1;
+    r->rollbacks = 0;
+    r->resimulated = 0;
+    r->inputs[0] = initial->playerPaddlePosition.y;
+    r->inputs[1] = initial->aiPaddlePosition.y;
+    r->known[0] = 0;
+    r->known[1] = 0;
+}
+
+int rollbackInput(Rollback* r, int player, long tick, int paddleY){
+    if (player < 0 || player >= r->inputPlayers || tick > r->tick || tick <= r->tick - r->capacity || tick < 0) {
+        return -1;
+    }
+    int index = slot(r, tick) + player;
+    r->known[index] = 1;
+    if (r->inputs[index] == paddleY) {
+        return 0; //predicted right
+    }
+    r->inputs[index] = paddleY;
+    predictInputs(r, tick + 1);
+    if (tick < r->tick && (r->dirtyTick < 0 || tick < r->dirtyTick)) {
+        r->dirtyTick = tick;
+    }
+    return 0;
+}
+
+int rollbackCorrect(Rollback* r, long tick, const Global* state){
+    if (tick > r->tick) {
+        //we fell behind, the inputs in between were never ours to predict
+        r->state = *state;
+        r->tick = tick;
+        r->dirtyTick = -1;
+        int index = slot(r, tick);
+        r->inputs[index] = state->playerPaddlePosition.y;
+        r->inputs[index + 1] = state->aiPaddlePosition.y;
+        r->known[index] = 0;
+        r->known[index + 1] = 0;
+        return 1;
+    }
+    if (tick <= r->tick - r->capacity || tick < 0) {
+        return -1;
+    }
+    Global* predicted = tick == r->tick ? &r->state : &r->snapshots[tick % r->capacity];
+    if (memcmp(predicted, state, sizeof(Global)) == 0) {
+        return 0;
+    }
+    *predicted = *state;
+    //everything before the authoritative state is settled
+    r->dirtyTick = tick < r->tick ? tick : -1;
+    return 1;
+}
+
+//One tick of the rules with the paddles placed by the inputs, like mouse() before gameLogic
+static void playTick(Rollback* r, Global* g, long tick){
+    const int* inputs = &r->inputs[slot(r, tick)];
+
+    g->playerPaddlePosition.y = inputs[0];
+    if (r->inputPlayers == 1) {
+        if (r->sweptCollisions) {
+            simGameLogicSwept(g);
+        } else {
+            simGameLogic(g);
+        }
+        return;
+    }
+    //both paddles are players, so there is no updateAI
+    g->aiPaddlePosition.y = inputs[1];
+    if (g->playerScore == winningScore || g->aiScore == winningScore) {
+        g->gameOver = 1;
+    } else if (r->sweptCollisions) {
+        simUpdateBallSwept(g);
+    } else {
+        simUpdateBall(g);
+    }
+}
+
+long rollbackSync(Rollback* r){
+    if (r->dirtyTick < 0) {
+        return 0;
+    }
+    long played = r->tick - r->dirtyTick;
+    r->state = r->snapshots[r->dirtyTick % r->capacity];
+    for (long t = r->dirtyTick; t < r->tick; t++) {
+        r->snapshots[t % r->capacity] = r->state;
+        playTick(r, &r->state, t);
+    }
+    r->dirtyTick = -1;
+    r->rollbacks++;
+    r->resimulated += played;
+    return played;
+}
+
+long rollbackAdvance(Rollback* r){
+    long played = rollbackSync(r) + 1;
+
+    r->snapshots[r->tick % r->capacity] = r->state;
+    playTick(r, &r->state, r->tick);
+    r->tick++;
+
+    //the new present tick starts out predicted
+    int index = slot(r, r->tick);
+    r->known[index] = 0;
+    r->known[index + 1] = 0;
+    predictInputs(r, r->tick);
+    return played;
+}
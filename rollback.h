@@ -0,0 +1,51 @@
+// Rollback engine
+// Keeps a snapshot of the full Global state for each of the last capacity ticks, in a ring
+// allocated up front, so a tick costs one struct copy on top of the rules. Inputs are paddle
+// positions per tick and player. A missing input is predicted by continuing the paddle's last
+// movement; when the real input arrives late and differs, the state is rolled back to that
+// tick's snapshot and simulated forward to the present again. Nobody ever waits for input.
+
+#ifndef ROLLBACK_H
+#define ROLLBACK_H
+
+#include "pong.h"
+
+#define rollbackPlayers 2 //0 = right (player) paddle, 1 = left (ai) paddle
+
+typedef struct Rollback{
+    int capacity; //ticks kept, inputs older than that are rejected
+    int inputPlayers; //paddles driven by input: 1 = the player's only (the ai plays updateAI), 2 = both
+    int sweptCollisions;
+    Global* snapshots; //state before tick t at t % capacity
+    int* inputs; //paddle top y before tick t at (t % capacity) * rollbackPlayers + player
+    unsigned char* known; //same layout, 0 while the input is a prediction
+    Global state; //present, before tick `tick`
+    long tick; //ticks simulated
+    long dirtyTick; //earliest tick whose input changed since it was simulated, -1 if none
+    long rollbacks; //stats
+    long resimulated;
+} Rollback;
+
+//Allocates the rings, returns -1 on failure
+int rollbackInit(Rollback* r, int capacity, int inputPlayers, int sweptCollisions);
+void rollbackFree(Rollback* r);
+
+//Starts over at tick 0 from the given state, keeping the rings
+void rollbackReset(Rollback* r, const Global* initial);
+
+//Sets a player's paddle top y for a tick that is not older than capacity - 1 ticks and not
+//in the future. Returns -1 if the tick is out of that range.
+int rollbackInput(Rollback* r, int player, long tick, int paddleY);
+
+//Replaces the state before a tick with an authoritative one (a server snapshot), so the
+//following ticks are re-simulated from it. A tick ahead of the present jumps there.
+//Returns 1 if the state changed, 0 if it was predicted right and -1 if the tick is too old.
+int rollbackCorrect(Rollback* r, long tick, const Global* state);
+
+//Re-simulates from the earliest changed input up to the present, returns the ticks played
+long rollbackSync(Rollback* r);
+
+//Syncs, then plays the present tick. Returns the ticks played, including the re-simulated ones.
+long rollbackAdvance(Rollback* r);
+
+#endif
@@ -0,0 +1,136 @@
+// Frame geometry, see scene.h
+
+#include <math.h>
+#include "scene.h"
+
+typedef struct Color{
+    unsigned char r; //0-255
+    unsigned char g; //0-255
+    unsigned char b; //0-255
+} Color;
+
+static const Color wallColor = {255, 0, 0};
+static const Color paddleColor = {255, 255, 255};
+static const Color playerScoreColor = {0, 255, 0};
+static const Color aiScoreColor = {255, 0, 0};
+static const Point playerScorePosition = {screenWidth - paddleOffset, scorePosition};
+static const Point aiScorePosition = {paddleOffset - scoreSize, scorePosition};
+
+float pixelToScreenX(int x){
+    return (2.0f * (float) x / (float) (screenWidth - 1) - 1.0f);
+}
+
+float pixelToScreenY(int y){
+    return -(2.0f * (float) y / (float) (screenHeight - 1) - 1.0f);
+}
+
+static int blend(int from, int to, double alpha){
+    return from + (int) lround((to - from) * alpha);
+}
+
+void sceneInterpolate(const Global* previous, const Global* current, double alpha, Global* out){
+    *out = *current;
+    if (previous->playerScore != current->playerScore || previous->aiScore != current->aiScore
+        || previous->gameOver != current->gameOver) {
+        return;
+    }
+    out->ballPosition.x = blend(previous->ballPosition.x, current->ballPosition.x, alpha);
+    out->ballPosition.y = blend(previous->ballPosition.y, current->ballPosition.y, alpha);
+    out->playerPaddlePosition.y = blend(previous->playerPaddlePosition.y, current->playerPaddlePosition.y, alpha);
+    out->aiPaddlePosition.y = blend(previous->aiPaddlePosition.y, current->aiPaddlePosition.y, alpha);
+}
+
+void sceneClear(Scene* scene){
+    scene->vertexCount = 0;
+    scene->shapeCount = 0;
+}
+
+static void beginShape(Scene* scene, SceneMode mode){
+    SceneShape* shape = &scene->shapes[scene->shapeCount++];
+    shape->mode = mode;
+    shape->first = scene->vertexCount;
+    shape->count = 0;
+}
+
+static void addVertex(Scene* scene, int x, int y, Color color){
+    SceneVertex* v = &scene->vertices[scene->vertexCount++];
+    v->x = (short) x;
+    v->y = (short) y;
+    v->r = color.r;
+    v->g = color.g;
+    v->b = color.b;
+    v->a = 255;
+    scene->shapes[scene->shapeCount - 1].count++;
+}
+
+//Axis aligned rectangle as a fan, corners in pixels
+static void addRectangle(Scene* scene, int x, int y, int otherX, int otherY, Color color){
+    beginShape(scene, SCENE_FAN);
+    addVertex(scene, x, y, color);
+    addVertex(scene, otherX, y, color);
+    addVertex(scene, otherX, otherY, color);
+    addVertex(scene, x, otherY, color);
+}
+
+void sceneWalls(Scene* scene){
+    int beginningX = 0;
+    int beginningY = 0;
+    int endX = screenWidth;
+    int endY = screenHeight;
+
+    // goal is 3 times the paddle length
+    int goalUpY = goalTop;
+    int goalDownY = goalBottom;
+
+    beginShape(scene, SCENE_LINES);
+    addVertex(scene, beginningX, endY, wallColor);
+    addVertex(scene, endX, endY, wallColor);
+    addVertex(scene, beginningX, beginningY, wallColor);
+    addVertex(scene, beginningX, goalUpY, wallColor);
+    addVertex(scene, beginningX, goalDownY, wallColor);
+    addVertex(scene, beginningX, endY, wallColor);
+    addVertex(scene, endX, goalDownY, wallColor);
+    addVertex(scene, endX, endY, wallColor);
+    addVertex(scene, endX, beginningY, wallColor);
+    addVertex(scene, endX, goalUpY, wallColor);
+    addVertex(scene, beginningX, beginningY, wallColor);
+    addVertex(scene, endX, beginningY, wallColor);
+}
+
+void scenePaddles(Scene* scene, const Global* g){
+    addRectangle(scene, g->playerPaddlePosition.x, g->playerPaddlePosition.y,
+                 g->playerPaddlePosition.x + paddleWidth, g->playerPaddlePosition.y + paddleLength, paddleColor);
+    addRectangle(scene, g->aiPaddlePosition.x, g->aiPaddlePosition.y,
+                 g->aiPaddlePosition.x + paddleWidth, g->aiPaddlePosition.y + paddleLength, paddleColor);
+}
+
+void sceneBall(Scene* scene, const Global* g){
+    int x = g->ballPosition.x;
+    int y = g->ballPosition.y;
+    int widthX = g->ballPosition.x + ballSideLength;
+    int lengthY = g->ballPosition.y + ballSideLength;
+
+    //two triangles spelled out as one fan, as the original drawBall did
+    beginShape(scene, SCENE_FAN);
+    addVertex(scene, x, y, paddleColor);
+    addVertex(scene, widthX, y, paddleColor);
+    addVertex(scene, widthX, lengthY, paddleColor);
+    addVertex(scene, x, y, paddleColor);
+    addVertex(scene, widthX, lengthY, paddleColor);
+    addVertex(scene, x, lengthY, paddleColor);
+}
+
+void sceneScore(Scene* scene, const Global* g){
+    //Score is drawn as a row of squares, one per point, scoreGap apart
+    //player score goes LEFT (-X AXIS), ai score goes RIGHT (+X AXIS)
+    for (int i = 0; i < g->playerScore && i < winningScore; i++) {
+        int coordX = playerScorePosition.x - (i * (scoreSize + scoreGap));
+        int coordY = playerScorePosition.y;
+        addRectangle(scene, coordX, coordY, coordX - scoreSize, coordY + scoreSize, playerScoreColor);
+    }
+    for (int i = 0; i < g->aiScore && i < winningScore; i++) {
+        int coordX = aiScorePosition.x + (i * (scoreSize + scoreGap));
+        int coordY = aiScorePosition.y;
+        addRectangle(scene, coordX, coordY, coordX + scoreSize, coordY + scoreSize, aiScoreColor);
+    }
+}
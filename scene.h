@@ -0,0 +1,67 @@
+// Frame geometry
+// Builds the shapes of a frame (walls, paddles, ball and score squares) as pixel coordinate
+// vertices without calling OpenGL, so the CPU side of drawing can be timed and tested without a
+// window. renderer.c uploads them as they are, its vertex shader maps pixels to screen space.
+
+#ifndef SCENE_H
+#define SCENE_H
+
+#include "pong.h"
+
+#define sceneMaxVertices 128
+#define sceneMaxShapes 32
+
+//Score squares, see drawScore
+#define scoreSize 22
+#define scorePosition (screenHeight * 9 / 10)
+#define scoreGap 50
+
+//Also the vertex format in the GPU buffer, 8 bytes
+typedef struct SceneVertex{
+    short x; //Pixels
+    short y; //Pixels
+    unsigned char r;
+    unsigned char g;
+    unsigned char b;
+    unsigned char a; //always 255, keeps the vertex 4 byte aligned
+} SceneVertex;
+
+typedef enum SceneMode{
+    SCENE_LINES, //GL_LINES
+    SCENE_FAN    //GL_TRIANGLE_FAN
+} SceneMode;
+
+//Consecutive vertices drawn as one primitive
+typedef struct SceneShape{
+    SceneMode mode;
+    int first;
+    int count;
+} SceneShape;
+
+typedef struct Scene{
+    SceneVertex vertices[sceneMaxVertices];
+    int vertexCount;
+    SceneShape shapes[sceneMaxShapes];
+    int shapeCount;
+} Scene;
+
+//Helper functions to convert from pixel coordinates into screen space, which OpenGl expects.
+//We use pixel coordinates because it is easier to work with in assembly, than floating point numbers.
+//Only the immediate mode path needs them, renderer.c does the same in its vertex shader.
+float pixelToScreenX(int x);
+float pixelToScreenY(int y);
+
+//The state alpha (0..1) of the way from previous to current, one tick later. Ball and paddle
+//positions are blended, everything else is current's. Across a goal or a restart the ball jumps,
+//so then current is drawn as is.
+void sceneInterpolate(const Global* previous, const Global* current, double alpha, Global* out);
+
+void sceneClear(Scene* scene);
+
+//Each appends its shapes to the scene
+void sceneWalls(Scene* scene);
+void scenePaddles(Scene* scene, const Global* g);
+void sceneBall(Scene* scene, const Global* g);
+void sceneScore(Scene* scene, const Global* g);
+
+#endif
@@ -0,0 +1,172 @@
+// Work-stealing task scheduler, see scheduler.h
+// Each worker owns a Chase-Lev deque. No task spawns new tasks, so the deques are filled
+// before the threads start and never grow, which keeps the buffers fixed and unsynchronized.
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include "scheduler.h"
+
+#define taskEmpty -1
+#define taskRetry -2
+
+typedef struct WorkDeque{
+    _Atomic long top; //thieves take from here
+    char pad0[64 - sizeof(long)];
+    _Atomic long bottom; //the owner pops from here
+    char pad1[64 - sizeof(long)];
+    int* tasks;
+    long steals;
+    char pad2[64 - sizeof(int*) - sizeof(long)];
+} WorkDeque;
+
+typedef struct Scheduler{
+    WorkDeque* deques;
+    int threads;
+    _Atomic int remaining;
+    TaskFunc func;
+    void* context;
+} Scheduler;
+
+typedef struct WorkerArgs{
+    Scheduler* scheduler;
+    int worker;
+} WorkerArgs;
+
+static int popTask(WorkDeque* deque){
+    long b = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&deque->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long t = atomic_load_explicit(&deque->top, memory_order_relaxed);
+
+    if (t > b) {
+        atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+        return taskEmpty;
+    }
+    int task = deque->tasks[b];
+    if (t == b) {
+        //last task, race the thieves for it
+        if (!atomic_compare_exchange_strong_explicit(&deque->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed)) {
+            task = taskEmpty;
+        }
+        atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+    }
+    return task;
+}
+
+static int stealTask(WorkDeque* deque){
+    long t = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long b = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+
+    if (t >= b) {
+        return taskEmpty;
+    }
+    int task = deque->tasks[t];
+    if (!atomic_compare_exchange_strong_explicit(&deque->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed)) {
+        return taskRetry;
+    }
+    return task;
+}
+
+static void* workerMain(void* arg){
+    WorkerArgs* args = arg;
+    Scheduler* scheduler = args->scheduler;
+    WorkDeque* own = &scheduler->deques[args->worker];
+    unsigned int rng = 2654435761u * (unsigned int) (args->worker + 1);
+
+    while (atomic_load_explicit(&scheduler->remaining, memory_order_acquire) > 0) {
+        int task = popTask(own);
+        if (task < 0 && scheduler->threads > 1) {
+            //xorshift32 picks the victim
+            rng ^= rng << 13;
+            rng ^= rng >> 17;
+            rng ^= rng << 5;
+            int victim = (int) (rng % (unsigned int) scheduler->threads);
+            if (victim != args->worker) {
+                task = stealTask(&scheduler->deques[victim]);
+                if (task >= 0) {
+                    own->steals++;
+                }
+            }
+        }
+        if (task < 0) {
+            //nothing to run, let busy workers have the core
+            sched_yield();
+            continue;
+        }
+        scheduler->func(scheduler->context, task, args->worker);
+        atomic_fetch_sub_explicit(&scheduler->remaining, 1, memory_order_release);
+    }
+    return NULL;
+}
+
+int runTasks(int count, int threads, TaskFunc func, void* context, SchedulerStats* stats){
+    if (threads < 1) {
+        threads = 1;
+    }
+    Scheduler scheduler;
+    scheduler.threads = threads;
+    scheduler.func = func;
+    scheduler.context = context;
+    atomic_init(&scheduler.remaining, count);
+
+    scheduler.deques = aligned_alloc(64, sizeof(WorkDeque) * (size_t) threads);
+    int* tasks = malloc(sizeof(int) * (size_t) (count > 0 ? count : 1));
+    pthread_t* ids = malloc(sizeof(pthread_t) * (size_t) threads);
+    WorkerArgs* args = malloc(sizeof(WorkerArgs) * (size_t) threads);
+    if (scheduler.deques == NULL || tasks == NULL || ids == NULL || args == NULL) {
+        free(scheduler.deques);
+        free(tasks);
+        free(ids);
+        free(args);
+        return -1;
+    }
+
+    //worker w starts with the contiguous block [w*count/threads, (w+1)*count/threads),
+    //stored reversed so the owner pops its tasks in ascending order
+    for (int w = 0; w < threads; w++) {
+        long first = (long) count * w / threads;
+        long last = (long) count * (w + 1) / threads;
+        WorkDeque* deque = &scheduler.deques[w];
+        deque->tasks = tasks + first;
+        for (long k = 0; k < last - first; k++) {
+            tasks[first + k] = (int) (last - 1 - k);
+        }
+        atomic_init(&deque->top, 0);
+        atomic_init(&deque->bottom, last - first);
+        deque->steals = 0;
+    }
+
+    int started = 0;
+    for (int w = 0; w < threads; w++) {
+        args[w].scheduler = &scheduler;
+        args[w].worker = w;
+    }
+    for (int w = 0; w < threads; w++) {
+        if (pthread_create(&ids[w], NULL, workerMain, &args[w]) != 0) {
+            break;
+        }
+        started++;
+    }
+    //if some threads could not start, the calling thread takes their place and steals the rest
+    for (int w = started; w < threads; w++) {
+        workerMain(&args[w]);
+    }
+    for (int w = 0; w < started; w++) {
+        pthread_join(ids[w], NULL);
+    }
+
+    if (stats != NULL) {
+        stats->steals = 0;
+        for (int w = 0; w < threads; w++) {
+            stats->steals += scheduler.deques[w].steals;
+        }
+    }
+    free(scheduler.deques);
+    free(tasks);
+    free(ids);
+    free(args);
+    return 0;
+}
@@ -0,0 +1,21 @@
+// Work-stealing task scheduler for the simulation tools
+// Tasks are numbered 0..count-1 and split evenly over the workers' deques up front.
+// A worker pops from the bottom of its own deque and, once it runs dry, steals from the
+// top of a random victim's deque, so a few long matches never leave the other threads idle.
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+//Called once per task on one of the worker threads, worker is 0..threads-1
+typedef void (*TaskFunc)(void* context, int task, int worker);
+
+typedef struct SchedulerStats{
+    long steals; //tasks that ran on a different worker than the one they were assigned to
+} SchedulerStats;
+
+//Runs every task and returns when all of them finished, stats may be NULL
+//Returns -1 if the scheduler could not be allocated. If some threads fail to start,
+//the calling thread takes over their deques.
+int runTasks(int count, int threads, TaskFunc func, void* context, SchedulerStats* stats);
+
+#endif
@@ -0,0 +1,1166 @@
+// Authoritative game server
+// Hosts many independent matches in one process, one per remote player. Every worker thread
+// owns a UDP socket on the shared port (SO_REUSEPORT, so the kernel shards the players over the
+// workers by address), an epoll loop and a timerfd for the tick. Datagrams are read and written
+// in batches with recvmmsg/sendmmsg, and each timer expiry ticks all of the worker's matches
+// in one step of the physics backend, so the SIMD backends fill their lanes with real matches.
+// A client sends its paddle position for the ticks ahead of the server, the server applies each
+// one on its tick and answers with a snapshot of the whole state to reconcile against.
+// Spectators can watch any match: they get bit-packed deltas against the newest state they
+// acknowledged, at a rate that follows what their link delivers. A delta is encoded once per
+// tick and base and shared by every viewer of the match that acknowledged the same tick.
+// A viewer is served by the worker that owns its match; when the kernel hashes the viewer's
+// address to another worker, that one forwards the viewer's datagrams through the owner's inbox.
+
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+#include "net.h"
+#include "physics.h"
+#include "timestep.h"
+
+#define serverInputWindow 64 //ticks of input buffered ahead of the simulation
+#define serverBatch 64 //datagrams per recvmmsg/sendmmsg
+#define serverMaxCatchUp 5 //most ticks run for one timer expiry, like the game's timestep
+#define serverLatencyBuckets 100000 //tick latency histogram, 1 us per bucket, the last one collects the rest
+#define serverDeltaCache 8 //deltas encoded per watched match and tick, one per distinct base
+#define serverViewerRate 16000 //bytes/sec for a viewer that does not ask for a rate
+#define serverMinViewerRate 200 //a viewer is never throttled below this
+#define serverRateStep 256 //bytes/sec added after every rate window without loss
+#define serverLossLimit 10 //percent of deltas lost in a window that halves the rate
+#define serverInbox 256 //viewer datagrams forwarded to a worker and not handled yet
+
+//Delta datagram encoded for one tick and base
+typedef struct EncodedDelta{
+    long baseTick;
+    int size;
+    unsigned char bytes[netMaxDatagram];
+} EncodedDelta;
+
+//Spectator side of a match, allocated when the first viewer arrives
+typedef struct Broadcast{
+    Global history[netDeltaHistory]; //state after tick t at t % netDeltaHistory, the delta bases
+    long since; //oldest tick in the history
+    EncodedDelta cache[serverDeltaCache]; //for the match's current tick
+    int cached;
+    int viewers;
+} Broadcast;
+
+typedef struct Match{
+    Global state;
+    long tick; //ticks simulated
+    struct sockaddr_in client;
+    double lastHeard;
+    int inputs[serverInputWindow]; //paddle top y for tick t at t % serverInputWindow
+    long inputTicks[serverInputWindow]; //which tick each entry belongs to
+    long newestInput; //newest input tick received, -1 before the first
+    int paddleY; //input applied on the last tick, repeated while none arrives
+    int next; //next match in the same address bucket, -1 at the end
+    int position; //index in the worker's open list
+    unsigned int generation; //bumped when the match closes, its viewers notice and leave
+    Broadcast* broadcast; //NULL while nobody watches
+} Match;
+
+typedef struct Viewer{
+    struct sockaddr_in address;
+    double lastHeard;
+    int owner; //worker serving the viewer, if it is not this one its datagrams are only forwarded
+    int match; //slot in the owner's matches
+    unsigned int generation; //of that match when the viewer joined
+    long acked; //newest tick the viewer decoded, -1 before the first
+    long lastAckTick; //match tick when acked last moved
+    long received; //deltas the viewer says arrived
+    double rate; //bytes/sec it may get now
+    int maxRate; //bytes/sec it asked for
+    double tokens; //bytes it may get right away
+    long sentTicks[netDeltaHistory]; //ticks of the last deltas sent, for counting losses
+    long sentCount;
+    long windowTick; //acked tick where the current rate window started
+    long windowSent; //deltas sent up to windowTick
+    long windowReceived;
+    int next; //next viewer in the same address bucket, -1 at the end
+    int position; //index in the worker's viewer list
+} Viewer;
+
+typedef struct ServerStats{
+    long long ticks; //match ticks
+    long long received;
+    long long sent;
+    long long bytesIn;
+    long long bytesOut;
+    long long lateInputs; //inputs that arrived after their tick was simulated
+    long long droppedTicks; //timer expirations beyond the catch-up cap
+    long long refused; //hellos turned away because the worker was full
+    long long deltas; //sent to viewers
+    long long keyFrames;
+    long long encodes; //deltas actually encoded, the rest came from the cache
+    long long deltaBytes;
+    long long rateCuts;
+    long long throttled; //viewer ticks skipped for lack of rate
+    long long forwarded; //viewer datagrams handed to the worker owning the match
+} ServerStats;
+
+//Datagrams waiting for the next sendmmsg
+typedef struct Outbox{
+    struct mmsghdr messages[serverBatch];
+    struct iovec vectors[serverBatch];
+    struct sockaddr_in addresses[serverBatch];
+    unsigned char buffers[serverBatch][netMaxDatagram];
+    int count;
+} Outbox;
+
+//Viewer datagram the kernel delivered to another worker than the one owning the match
+typedef struct Forwarded{
+    struct sockaddr_in from;
+    NetPacket packet;
+    int match; //WATCH: slot of the match in the owner's matches
+    unsigned int generation; //of that match when it was picked
+} Forwarded;
+
+typedef struct Inbox{
+    pthread_mutex_t lock;
+    Forwarded entries[serverInbox];
+    int head;
+    int count;
+    int event; //eventfd, wakes the owner's epoll loop
+} Inbox;
+
+typedef struct Worker{
+    int index;
+    int fd;
+    int epoll;
+    int timer;
+    Match* matches;
+    int* freeSlots; //stack of unused match indexes
+    int freeCount;
+    int* open; //indexes of the matches being played, ticked in this order
+    int openCount;
+    Global* stepping; //the open matches' states in open order while a tick is stepped
+    int* buckets; //first match per address hash, -1 if none
+    int bucketMask;
+    Viewer* viewers;
+    int* freeViewers;
+    int freeViewerCount;
+    int* watching; //indexes of the viewers in use
+    int watchingCount;
+    int* viewerBuckets; //first viewer per address hash, -1 if none
+    _Atomic int active; //read by the report
+    _Atomic int spectators; //viewers served by this worker
+    int peak;
+    double start; //timer start, tick k is due at start + k / tickRate
+    long long expirations;
+    Outbox outbox;
+    Inbox inbox;
+    ServerStats stats;
+    _Atomic long* latency; //histogram of the delay from a tick being due to its snapshots being sent, in us
+    pthread_t thread;
+} Worker;
+
+//An open match of some worker
+typedef struct Listing{
+    int worker;
+    int match; //slot in the worker's matches
+    unsigned int generation;
+} Listing;
+
+//Every open match of the server, so a viewer can watch any of them whichever worker its
+//address hashes to. Only taken when a match opens or closes and on a viewer's first WATCH.
+typedef struct Directory{
+    pthread_mutex_t lock;
+    Listing* listings;
+    int count;
+    int* positions; //index in listings of worker w's slot i, at w * capacity + i
+} Directory;
+
+typedef struct Server{
+    int port;
+    int tickRate;
+    int sweptCollisions;
+    int capacity; //matches per worker
+    int viewerCapacity; //viewers per worker
+    int threads;
+    int pin; //pin worker i to CPU i
+    Worker* workers;
+    Directory directory;
+} Server;
+
+static Server server;
+
+static volatile sig_atomic_t running = 1;
+
+static void stopServer(int signal){
+    (void) signal;
+    running = 0;
+}
+
+static void resetMatch(Match* m, const struct sockaddr_in* client, double now){
+    simInitGlobals(&m->state);
+    m->state.tickScale = simTickScale(server.tickRate);
+    m->tick = 0;
+    m->client = *client;
+    m->lastHeard = now;
+    m->newestInput = -1;
+    m->paddleY = m->state.playerPaddlePosition.y;
+    for (int i = 0; i < serverInputWindow; i++) {
+        m->inputTicks[i] = -1;
+    }
+}
+
+static int sameAddress(const struct sockaddr_in* a, const struct sockaddr_in* b){
+    return a->sin_addr.s_addr == b->sin_addr.s_addr && a->sin_port == b->sin_port;
+}
+
+//Matches and viewers have their own tables of the same size
+static int addressBucket(const Worker* w, const struct sockaddr_in* address){
+    uint32_t h = (uint32_t) address->sin_addr.s_addr * 2654435761u ^ (uint32_t) address->sin_port * 2246822519u;
+    return (int) ((h ^ h >> 16) & (uint32_t) w->bucketMask);
+}
+
+static int findMatch(const Worker* w, const struct sockaddr_in* address){
+    for (int i = w->buckets[addressBucket(w, address)]; i >= 0; i = w->matches[i].next) {
+        if (sameAddress(&w->matches[i].client, address)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void listMatch(const Worker* w, int index){
+    Directory* d = &server.directory;
+    pthread_mutex_lock(&d->lock);
+    d->positions[w->index * server.capacity + index] = d->count;
+    d->listings[d->count++] = (Listing){w->index, index, w->matches[index].generation};
+    pthread_mutex_unlock(&d->lock);
+}
+
+static void unlistMatch(const Worker* w, int index){
+    Directory* d = &server.directory;
+    pthread_mutex_lock(&d->lock);
+    int position = d->positions[w->index * server.capacity + index];
+    Listing moved = d->listings[--d->count];
+    d->listings[position] = moved;
+    d->positions[moved.worker * server.capacity + moved.match] = position;
+    pthread_mutex_unlock(&d->lock);
+}
+
+//The n-th open match of the server, wrapping around, returns -1 if none is open
+static int pickMatch(int n, Listing* listing){
+    Directory* d = &server.directory;
+    pthread_mutex_lock(&d->lock);
+    int found = d->count > 0;
+    if (found) {
+        *listing = d->listings[(unsigned int) n % (unsigned int) d->count];
+    }
+    pthread_mutex_unlock(&d->lock);
+    return found ? 0 : -1;
+}
+
+//Returns -1 if the worker is full
+static int openMatch(Worker* w, const struct sockaddr_in* address, double now){
+    if (w->freeCount == 0) {
+        return -1;
+    }
+    int index = w->freeSlots[--w->freeCount];
+    Match* m = &w->matches[index];
+    resetMatch(m, address, now);
+    int bucket = addressBucket(w, address);
+    m->next = w->buckets[bucket];
+    w->buckets[bucket] = index;
+    m->position = w->openCount;
+    w->open[w->openCount++] = index;
+    listMatch(w, index);
+    int active = atomic_load_explicit(&w->active, memory_order_relaxed) + 1;
+    atomic_store_explicit(&w->active, active, memory_order_relaxed);
+    if (active > w->peak) {
+        w->peak = active;
+    }
+    return index;
+}
+
+static void closeMatch(Worker* w, int index){
+    unlistMatch(w, index);
+    w->matches[index].generation++;
+    free(w->matches[index].broadcast);
+    w->matches[index].broadcast = NULL;
+    int* link = &w->buckets[addressBucket(w, &w->matches[index].client)];
+    while (*link != index) {
+        link = &w->matches[*link].next;
+    }
+    *link = w->matches[index].next;
+    w->matches[index].next = -1;
+    int moved = w->open[--w->openCount];
+    w->open[w->matches[index].position] = moved;
+    w->matches[moved].position = w->matches[index].position;
+    w->freeSlots[w->freeCount++] = index;
+    atomic_store_explicit(&w->active, atomic_load_explicit(&w->active, memory_order_relaxed) - 1, memory_order_relaxed);
+}
+
+static int findViewer(const Worker* w, const struct sockaddr_in* address){
+    for (int i = w->viewerBuckets[addressBucket(w, address)]; i >= 0; i = w->viewers[i].next) {
+        if (sameAddress(&w->viewers[i].address, address)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+//Starts watching the match listed, served here if this worker owns it and otherwise only
+//forwarded to its owner. Returns -1 if the worker is full or the match has closed since.
+static int openViewer(Worker* w, const struct sockaddr_in* address, const Listing* listing, int rate, double now){
+    if (w->freeViewerCount == 0) {
+        return -1;
+    }
+    Match* m = listing->worker == w->index ? &w->matches[listing->match] : NULL;
+    if (m != NULL) {
+        if (m->generation != listing->generation) {
+            return -1;
+        }
+        if (m->broadcast == NULL) {
+            m->broadcast = calloc(1, sizeof(Broadcast));
+            if (m->broadcast == NULL) {
+                return -1;
+            }
+            m->broadcast->since = m->tick;
+            m->broadcast->history[m->tick % netDeltaHistory] = m->state;
+        }
+        m->broadcast->viewers++;
+        atomic_store_explicit(&w->spectators, atomic_load_explicit(&w->spectators, memory_order_relaxed) + 1,
+                              memory_order_relaxed);
+    }
+
+    int index = w->freeViewers[--w->freeViewerCount];
+    Viewer* v = &w->viewers[index];
+    memset(v, 0, sizeof(Viewer));
+    v->address = *address;
+    v->lastHeard = now;
+    v->owner = listing->worker;
+    v->match = listing->match;
+    v->generation = listing->generation;
+    v->acked = -1;
+    v->lastAckTick = m != NULL ? m->tick : 0;
+    v->maxRate = rate > 0 ? rate : serverViewerRate;
+    v->rate = v->maxRate;
+    v->windowTick = -1;
+    int bucket = addressBucket(w, address);
+    v->next = w->viewerBuckets[bucket];
+    w->viewerBuckets[bucket] = index;
+    v->position = w->watchingCount;
+    w->watching[w->watchingCount++] = index;
+    return index;
+}
+
+static void closeViewer(Worker* w, int index){
+    Viewer* v = &w->viewers[index];
+    if (v->owner == w->index) {
+        Match* m = &w->matches[v->match];
+        if (m->generation == v->generation && m->broadcast != NULL && --m->broadcast->viewers == 0) {
+            free(m->broadcast);
+            m->broadcast = NULL;
+        }
+        atomic_store_explicit(&w->spectators, atomic_load_explicit(&w->spectators, memory_order_relaxed) - 1,
+                              memory_order_relaxed);
+    }
+    int* link = &w->viewerBuckets[addressBucket(w, &v->address)];
+    while (*link != index) {
+        link = &w->viewers[*link].next;
+    }
+    *link = v->next;
+    int moved = w->watching[--w->watchingCount];
+    w->watching[v->position] = moved;
+    w->viewers[moved].position = v->position;
+    w->freeViewers[w->freeViewerCount++] = index;
+}
+
+static void flushOutbox(Worker* w){
+    Outbox* out = &w->outbox;
+    int done = 0;
+    while (done < out->count) {
+        int sent = sendmmsg(w->fd, &out->messages[done], (unsigned int) (out->count - done), 0);
+        if (sent <= 0) {
+            break; //the socket buffer is full, the rest is lost like any datagram may be
+        }
+        for (int i = done; i < done + sent; i++) {
+            w->stats.bytesOut += out->messages[i].msg_len;
+        }
+        w->stats.sent += sent;
+        done += sent;
+    }
+    out->count = 0;
+}
+
+//Returns the buffer of the next outgoing datagram, its length has to be set by the caller
+static struct iovec* queueDatagram(Worker* w, const struct sockaddr_in* to){
+    Outbox* out = &w->outbox;
+    if (out->count == serverBatch) {
+        flushOutbox(w);
+    }
+    int i = out->count++;
+    out->addresses[i] = *to;
+    out->vectors[i].iov_base = out->buffers[i];
+    memset(&out->messages[i], 0, sizeof(struct mmsghdr));
+    out->messages[i].msg_hdr.msg_name = &out->addresses[i];
+    out->messages[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+    out->messages[i].msg_hdr.msg_iov = &out->vectors[i];
+    out->messages[i].msg_hdr.msg_iovlen = 1;
+    return &out->vectors[i];
+}
+
+static void queuePacket(Worker* w, const struct sockaddr_in* to, const NetPacket* packet){
+    struct iovec* datagram = queueDatagram(w, to);
+    datagram->iov_len = (size_t) netEncode(packet, datagram->iov_base);
+}
+
+//Hands a viewer's datagram to the worker serving it, dropped like any datagram if its inbox is full
+static void forwardPacket(Worker* w, const Viewer* v, const struct sockaddr_in* from, const NetPacket* packet){
+    Inbox* inbox = &server.workers[v->owner].inbox;
+    pthread_mutex_lock(&inbox->lock);
+    int queued = inbox->count < serverInbox;
+    if (queued) {
+        Forwarded* f = &inbox->entries[(inbox->head + inbox->count++) % serverInbox];
+        f->from = *from;
+        f->packet = *packet;
+        f->match = v->match;
+        f->generation = v->generation;
+    }
+    pthread_mutex_unlock(&inbox->lock);
+    if (queued) {
+        uint64_t one = 1;
+        if (write(inbox->event, &one, sizeof(one)) != sizeof(one)) {
+            //the counter is already pending, the owner wakes up anyway
+        }
+        w->stats.forwarded++;
+    }
+}
+
+//Answers a WATCH on the worker serving the viewer at index, -1 if it could not be let in
+static void answerWatch(Worker* w, int index, const struct sockaddr_in* from, const NetPacket* packet,
+                        int tickRate, double now){
+    NetPacket reply;
+    memset(&reply, 0, sizeof(reply));
+    if (index < 0) {
+        //nothing to watch, or full
+        w->stats.refused++;
+        reply.type = NET_BYE;
+        queuePacket(w, from, &reply);
+        return;
+    }
+    Viewer* v = &w->viewers[index];
+    v->lastHeard = now;
+    reply.type = NET_WELCOME;
+    reply.nonce = packet->nonce;
+    reply.tick = w->matches[v->match].tick;
+    reply.tickRate = tickRate;
+    queuePacket(w, from, &reply);
+}
+
+static void handleWatch(Worker* w, const struct sockaddr_in* from, const NetPacket* packet, int tickRate, double now){
+    int index = findViewer(w, from);
+    Listing listing;
+    if (index < 0 && findMatch(w, from) < 0 && pickMatch(packet->match, &listing) == 0) {
+        index = openViewer(w, from, &listing, packet->rate, now);
+    }
+    if (index >= 0 && w->viewers[index].owner != w->index) {
+        w->viewers[index].lastHeard = now;
+        forwardPacket(w, &w->viewers[index], from, packet);
+        return;
+    }
+    answerWatch(w, index, from, packet, tickRate, now);
+}
+
+//Deltas sent for ticks up to tick
+static long sentUpTo(const Viewer* v, long tick){
+    long count = v->sentCount;
+    for (long i = v->sentCount - 1; i >= 0 && i >= v->sentCount - netDeltaHistory; i--) {
+        if (v->sentTicks[i % netDeltaHistory] <= tick) {
+            break;
+        }
+        count--;
+    }
+    return count;
+}
+
+//Rate control: every quarter second of acknowledged ticks the deltas sent up to the acked tick
+//are compared with the ones that arrived. Losses above serverLossLimit mean the viewer's link is
+//full and halve its rate, otherwise the rate grows by serverRateStep up to what it asked for.
+static void handleAck(Worker* w, Viewer* v, const NetPacket* packet, int tickRate, double now){
+    const Match* m = &w->matches[v->match];
+    v->lastHeard = now;
+    if (packet->tick <= v->acked || packet->tick > m->tick || m->generation != v->generation) {
+        return;
+    }
+    v->acked = packet->tick;
+    v->lastAckTick = m->tick;
+    v->received = packet->received;
+    if (v->windowTick < 0) {
+        v->windowTick = v->acked;
+        v->windowSent = sentUpTo(v, v->acked);
+        v->windowReceived = v->received;
+        return;
+    }
+    long window = tickRate / 4 > 4 ? tickRate / 4 : 4;
+    if (v->acked - v->windowTick < window) {
+        return;
+    }
+    long sent = sentUpTo(v, v->acked);
+    long delivered = v->received - v->windowReceived;
+    long expected = sent - v->windowSent;
+    if (expected > 0 && (expected - delivered) * 100 > expected * serverLossLimit) {
+        v->rate = v->rate / 2 > serverMinViewerRate ? v->rate / 2 : serverMinViewerRate;
+        w->stats.rateCuts++;
+    } else if (v->rate + serverRateStep < v->maxRate) {
+        v->rate += serverRateStep;
+    } else {
+        v->rate = v->maxRate;
+    }
+    v->windowTick = v->acked;
+    v->windowSent = sent;
+    v->windowReceived = v->received;
+}
+
+static void handlePacket(Worker* w, const struct sockaddr_in* from, const NetPacket* packet, int tickRate, double now){
+    int index = findMatch(w, from);
+    Match* m = index >= 0 ? &w->matches[index] : NULL;
+    NetPacket reply;
+    memset(&reply, 0, sizeof(reply));
+
+    switch (packet->type) {
+        case NET_HELLO:
+            if (m == NULL) {
+                index = openMatch(w, from, now);
+                if (index < 0) {
+                    w->stats.refused++;
+                    reply.type = NET_BYE;
+                    queuePacket(w, from, &reply);
+                    return;
+                }
+                m = &w->matches[index];
+            }
+            m->lastHeard = now;
+            reply.type = NET_WELCOME;
+            reply.nonce = packet->nonce;
+            reply.tick = m->tick;
+            reply.tickRate = tickRate;
+            queuePacket(w, from, &reply);
+            break;
+        case NET_INPUT:
+            if (m == NULL) {
+                return;
+            }
+            m->lastHeard = now;
+            for (int i = 0; i < packet->inputCount; i++) {
+                long tick = packet->tick - i;
+                if (tick < m->tick) {
+                    if (i == 0) {
+                        w->stats.lateInputs++;
+                    }
+                    break;
+                }
+                if (tick < m->tick + serverInputWindow) {
+                    m->inputs[tick % serverInputWindow] = packet->inputs[i];
+                    m->inputTicks[tick % serverInputWindow] = tick;
+                }
+            }
+            if (packet->tick > m->newestInput) {
+                m->newestInput = packet->tick;
+            }
+            break;
+        case NET_BYE:
+            if (m != NULL) {
+                closeMatch(w, index);
+            } else if ((index = findViewer(w, from)) >= 0) {
+                if (w->viewers[index].owner != w->index) {
+                    forwardPacket(w, &w->viewers[index], from, packet);
+                }
+                closeViewer(w, index);
+            }
+            break;
+        case NET_WATCH:
+            handleWatch(w, from, packet, tickRate, now);
+            break;
+        case NET_ACK:
+            if ((index = findViewer(w, from)) < 0) {
+                break;
+            }
+            if (w->viewers[index].owner != w->index) {
+                w->viewers[index].lastHeard = now;
+                forwardPacket(w, &w->viewers[index], from, packet);
+            } else {
+                handleAck(w, &w->viewers[index], packet, tickRate, now);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+//Drains the socket in batches
+static void receivePackets(Worker* w, int tickRate){
+    struct mmsghdr messages[serverBatch];
+    struct iovec vectors[serverBatch];
+    struct sockaddr_in addresses[serverBatch];
+    static _Thread_local unsigned char buffers[serverBatch][netMaxDatagram];
+    double now = timestepNow();
+
+    for (;;) {
+        for (int i = 0; i < serverBatch; i++) {
+            vectors[i].iov_base = buffers[i];
+            vectors[i].iov_len = netMaxDatagram;
+            memset(&messages[i], 0, sizeof(struct mmsghdr));
+            messages[i].msg_hdr.msg_name = &addresses[i];
+            messages[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+            messages[i].msg_hdr.msg_iov = &vectors[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+        }
+        int count = recvmmsg(w->fd, messages, serverBatch, MSG_DONTWAIT, NULL);
+        if (count <= 0) {
+            return;
+        }
+        for (int i = 0; i < count; i++) {
+            NetPacket packet;
+            w->stats.received++;
+            w->stats.bytesIn += messages[i].msg_len;
+            if (netDecode(buffers[i], (int) messages[i].msg_len, &packet) == 0) {
+                handlePacket(w, &addresses[i], &packet, tickRate, now);
+            }
+        }
+        if (count < serverBatch) {
+            return;
+        }
+    }
+}
+
+//A viewer datagram forwarded by the worker its address hashes to, this worker owns the match
+static void handleForwarded(Worker* w, const Forwarded* f, int tickRate, double now){
+    int index = findViewer(w, &f->from);
+    switch (f->packet.type) {
+        case NET_WATCH:
+            if (index < 0) {
+                Listing listing = {w->index, f->match, f->generation};
+                index = openViewer(w, &f->from, &listing, f->packet.rate, now);
+            }
+            answerWatch(w, index, &f->from, &f->packet, tickRate, now);
+            break;
+        case NET_ACK:
+            if (index >= 0) {
+                handleAck(w, &w->viewers[index], &f->packet, tickRate, now);
+            }
+            break;
+        case NET_BYE:
+            if (index >= 0) {
+                closeViewer(w, index);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static void receiveForwarded(Worker* w, int tickRate){
+    Inbox* inbox = &w->inbox;
+    uint64_t pending;
+    if (read(inbox->event, &pending, sizeof(pending)) != sizeof(pending)) {
+        return;
+    }
+    double now = timestepNow();
+    for (;;) {
+        Forwarded f;
+        pthread_mutex_lock(&inbox->lock);
+        int empty = inbox->count == 0;
+        if (!empty) {
+            f = inbox->entries[inbox->head];
+            inbox->head = (inbox->head + 1) % serverInbox;
+            inbox->count--;
+        }
+        pthread_mutex_unlock(&inbox->lock);
+        if (empty) {
+            return;
+        }
+        handleForwarded(w, &f, tickRate, now);
+    }
+}
+
+//Counts the tick a match was just stepped, keeps it as a delta base and sends its snapshot
+static void sendSnapshot(Worker* w, Match* m){
+    m->tick++;
+    w->stats.ticks++;
+    if (m->broadcast != NULL) {
+        m->broadcast->history[m->tick % netDeltaHistory] = m->state;
+        m->broadcast->cached = 0;
+    }
+
+    NetPacket snapshot;
+    memset(&snapshot, 0, sizeof(snapshot));
+    snapshot.type = NET_SNAPSHOT;
+    snapshot.tick = m->tick;
+    snapshot.inputLead = (int) (m->newestInput - m->tick);
+    snapshot.state = m->state;
+    queuePacket(w, &m->client, &snapshot);
+}
+
+//The client's paddle for the match's next tick, the last one again if its input is missing
+static void applyInput(Match* m){
+    int index = (int) (m->tick % serverInputWindow);
+    if (m->inputTicks[index] == m->tick) {
+        m->paddleY = m->inputs[index];
+    }
+    m->state.playerPaddlePosition.y = m->paddleY;
+}
+
+//One tick of every open match: their inputs, one physics step over all of them, their snapshots
+static void tickMatches(Worker* w, int sweptCollisions){
+    for (int i = 0; i < w->openCount; i++) {
+        Match* m = &w->matches[w->open[i]];
+        applyInput(m);
+        if (sweptCollisions) {
+            simGameLogicSwept(&m->state);
+        } else {
+            w->stepping[i] = m->state;
+        }
+    }
+    if (!sweptCollisions && w->openCount > 0) {
+        physicsBackend()->step(w->stepping, w->openCount);
+        for (int i = 0; i < w->openCount; i++) {
+            w->matches[w->open[i]].state = w->stepping[i];
+        }
+    }
+    for (int i = 0; i < w->openCount; i++) {
+        sendSnapshot(w, &w->matches[w->open[i]]);
+    }
+}
+
+//Delta datagram for the match's current tick against baseTick (the current tick for a key frame),
+//encoded at most once per tick and base however many viewers need it
+static const EncodedDelta* encodeDelta(Worker* w, Match* m, long baseTick){
+    Broadcast* b = m->broadcast;
+    for (int i = 0; i < b->cached; i++) {
+        if (b->cache[i].baseTick == baseTick) {
+            return &b->cache[i];
+        }
+    }
+    //a full cache is unlikely, a handful of acked ticks covers nearly all viewers; start over
+    EncodedDelta* entry = &b->cache[b->cached < serverDeltaCache ? b->cached++ : 0];
+    NetPacket delta;
+    memset(&delta, 0, sizeof(delta));
+    delta.type = NET_DELTA;
+    delta.tick = m->tick;
+    delta.baseTick = baseTick;
+    delta.checksum = netStateChecksum(&m->state);
+    const Global* base = baseTick == m->tick ? NULL : &b->history[baseTick % netDeltaHistory];
+    delta.deltaSize = netEncodeDelta(base, &m->state, delta.delta);
+    entry->baseTick = baseTick;
+    entry->size = netEncode(&delta, entry->bytes);
+    w->stats.encodes++;
+    return entry;
+}
+
+//Sends the viewer this tick's delta if its rate allows, returns -1 if its match is gone
+static int tickViewer(Worker* w, Viewer* v, int tickRate){
+    if (v->owner != w->index) {
+        return 0; //served by the owner of its match
+    }
+    Match* m = &w->matches[v->match];
+    if (m->generation != v->generation) {
+        return -1;
+    }
+    Broadcast* b = m->broadcast;
+    v->tokens += v->rate / tickRate;
+    //up to a quarter second of rate may pile up, but at least one key frame
+    double burst = v->rate / 4 > netMaxDatagram ? v->rate / 4 : netMaxDatagram;
+    if (v->tokens > burst) {
+        v->tokens = burst;
+    }
+    if (m->tick - v->lastAckTick > tickRate && v->sentCount > 0) {
+        //nothing acknowledged for a second, the link is not even passing the current rate
+        v->rate = v->rate / 2 > serverMinViewerRate ? v->rate / 2 : serverMinViewerRate;
+        v->lastAckTick = m->tick;
+        w->stats.rateCuts++;
+    }
+
+    int keyFrame = v->acked < b->since || v->acked <= m->tick - netDeltaHistory;
+    const EncodedDelta* delta = encodeDelta(w, m, keyFrame ? m->tick : v->acked);
+    if (v->tokens < delta->size + netUdpOverhead) {
+        w->stats.throttled++;
+        return 0;
+    }
+    v->tokens -= delta->size + netUdpOverhead;
+    v->sentTicks[v->sentCount++ % netDeltaHistory] = m->tick;
+    struct iovec* datagram = queueDatagram(w, &v->address);
+    memcpy(datagram->iov_base, delta->bytes, (size_t) delta->size);
+    datagram->iov_len = (size_t) delta->size;
+    w->stats.deltas++;
+    w->stats.keyFrames += keyFrame;
+    w->stats.deltaBytes += delta->size;
+    return 0;
+}
+
+static void tickWorker(Worker* w, const Server* s){
+    uint64_t expirations = 0;
+    if (read(w->timer, &expirations, sizeof(expirations)) != sizeof(expirations) || expirations == 0) {
+        return;
+    }
+    w->expirations += (long long) expirations;
+    int ticks = expirations > serverMaxCatchUp ? serverMaxCatchUp : (int) expirations;
+    w->stats.droppedTicks += (long long) expirations - ticks;
+
+    double now = timestepNow();
+    //backwards, closing a match moves the last one into its place
+    for (int i = w->openCount - 1; i >= 0; i--) {
+        if (now - w->matches[w->open[i]].lastHeard > netTimeoutSeconds) {
+            closeMatch(w, w->open[i]);
+        }
+    }
+    for (int i = w->watchingCount - 1; i >= 0; i--) {
+        if (now - w->viewers[w->watching[i]].lastHeard > netTimeoutSeconds) {
+            closeViewer(w, w->watching[i]);
+        }
+    }
+    for (int t = 0; t < ticks; t++) {
+        tickMatches(w, s->sweptCollisions);
+        for (int i = w->watchingCount - 1; i >= 0; i--) {
+            if (tickViewer(w, &w->viewers[w->watching[i]], s->tickRate) != 0) {
+                NetPacket bye;
+                memset(&bye, 0, sizeof(bye));
+                bye.type = NET_BYE;
+                queuePacket(w, &w->viewers[w->watching[i]].address, &bye);
+                closeViewer(w, w->watching[i]);
+            }
+        }
+    }
+    flushOutbox(w);
+
+    double due = w->start + (double) w->expirations / s->tickRate;
+    long late = (long) ((timestepNow() - due) * 1e6);
+    if (late < 0) {
+        late = 0;
+    }
+    if (late >= serverLatencyBuckets) {
+        late = serverLatencyBuckets - 1;
+    }
+    atomic_fetch_add_explicit(&w->latency[late], 1, memory_order_relaxed);
+}
+
+static void* workerMain(void* argument){
+    Worker* w = argument;
+    struct epoll_event events[3];
+
+    while (running) {
+        int count = epoll_wait(w->epoll, events, 3, 100);
+        for (int i = 0; i < count; i++) {
+            if (events[i].data.fd == w->fd) {
+                receivePackets(w, server.tickRate);
+            } else if (events[i].data.fd == w->inbox.event) {
+                receiveForwarded(w, server.tickRate);
+            } else {
+                tickWorker(w, &server);
+            }
+        }
+        //replies to hellos go out right away
+        flushOutbox(w);
+    }
+    return NULL;
+}
+
+static int startWorker(Worker* w, int index, const Server* s){
+    memset(w, 0, sizeof(Worker));
+    w->index = index;
+    w->fd = netOpenSocket(s->port, 1);
+    w->epoll = epoll_create1(0);
+    w->timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+    w->inbox.event = eventfd(0, EFD_NONBLOCK);
+    pthread_mutex_init(&w->inbox.lock, NULL);
+    int buckets = 1;
+    while (buckets < s->capacity * 2 || buckets < s->viewerCapacity * 2) {
+        buckets *= 2;
+    }
+    w->bucketMask = buckets - 1;
+    w->matches = malloc(sizeof(Match) * (size_t) s->capacity);
+    w->freeSlots = malloc(sizeof(int) * (size_t) s->capacity);
+    w->open = malloc(sizeof(int) * (size_t) s->capacity);
+    w->stepping = malloc(sizeof(Global) * (size_t) s->capacity);
+    w->buckets = malloc(sizeof(int) * (size_t) buckets);
+    w->viewers = malloc(sizeof(Viewer) * (size_t) s->viewerCapacity);
+    w->freeViewers = malloc(sizeof(int) * (size_t) s->viewerCapacity);
+    w->watching = malloc(sizeof(int) * (size_t) s->viewerCapacity);
+    w->viewerBuckets = malloc(sizeof(int) * (size_t) buckets);
+    w->latency = calloc(serverLatencyBuckets, sizeof(_Atomic long));
+    if (w->fd < 0 || w->epoll < 0 || w->timer < 0 || w->inbox.event < 0 || w->matches == NULL || w->freeSlots == NULL
+        || w->open == NULL || w->stepping == NULL || w->buckets == NULL || w->viewers == NULL || w->freeViewers == NULL
+        || w->watching == NULL || w->viewerBuckets == NULL || w->latency == NULL) {
+        return -1;
+    }
+    for (int i = 0; i < buckets; i++) {
+        w->buckets[i] = -1;
+        w->viewerBuckets[i] = -1;
+    }
+    for (int i = 0; i < s->capacity; i++) {
+        w->matches[i].generation = 0;
+        w->matches[i].broadcast = NULL;
+    }
+    for (int i = 0; i < s->viewerCapacity; i++) {
+        w->freeViewers[i] = s->viewerCapacity - 1 - i;
+    }
+    w->freeViewerCount = s->viewerCapacity;
+    for (int i = 0; i < s->capacity; i++) {
+        w->freeSlots[i] = s->capacity - 1 - i;
+    }
+    w->freeCount = s->capacity;
+
+    struct epoll_event socketEvent = {EPOLLIN, {.fd = w->fd}};
+    struct epoll_event timerEvent = {EPOLLIN, {.fd = w->timer}};
+    struct epoll_event inboxEvent = {EPOLLIN, {.fd = w->inbox.event}};
+    long period = 1000000000L / s->tickRate;
+    struct itimerspec interval = {{period / 1000000000L, period % 1000000000L}, {period / 1000000000L, period % 1000000000L}};
+    if (epoll_ctl(w->epoll, EPOLL_CTL_ADD, w->fd, &socketEvent) != 0
+        || epoll_ctl(w->epoll, EPOLL_CTL_ADD, w->timer, &timerEvent) != 0
+        || epoll_ctl(w->epoll, EPOLL_CTL_ADD, w->inbox.event, &inboxEvent) != 0
+        || timerfd_settime(w->timer, 0, &interval, NULL) != 0) {
+        return -1;
+    }
+    w->start = timestepNow();
+    if (pthread_create(&w->thread, NULL, workerMain, w) != 0) {
+        return -1;
+    }
+    if (s->pin) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(index % CPU_SETSIZE, &cpus);
+        pthread_setaffinity_np(w->thread, sizeof(cpus), &cpus);
+    }
+    return 0;
+}
+
+static void freeWorker(Worker* w){
+    if (w->fd >= 0) {
+        close(w->fd);
+    }
+    if (w->epoll >= 0) {
+        close(w->epoll);
+    }
+    if (w->timer >= 0) {
+        close(w->timer);
+    }
+    if (w->inbox.event >= 0) {
+        close(w->inbox.event);
+    }
+    pthread_mutex_destroy(&w->inbox.lock);
+    for (int i = 0; i < w->openCount; i++) {
+        free(w->matches[w->open[i]].broadcast);
+    }
+    free(w->matches);
+    free(w->freeSlots);
+    free(w->open);
+    free(w->stepping);
+    free(w->buckets);
+    free(w->viewers);
+    free(w->freeViewers);
+    free(w->watching);
+    free(w->viewerBuckets);
+    free((void*) w->latency);
+}
+
+//Tick latency percentile over all workers, in us
+static long latencyPercentile(const Server* s, double fraction){
+    long long total = 0;
+    for (int w = 0; w < s->threads; w++) {
+        for (int i = 0; i < serverLatencyBuckets; i++) {
+            total += atomic_load_explicit(&s->workers[w].latency[i], memory_order_relaxed);
+        }
+    }
+    long long rank = (long long) (fraction * (double) total);
+    long long seen = 0;
+    for (int i = 0; i < serverLatencyBuckets; i++) {
+        for (int w = 0; w < s->threads; w++) {
+            seen += atomic_load_explicit(&s->workers[w].latency[i], memory_order_relaxed);
+        }
+        if (seen > rank) {
+            return i;
+        }
+    }
+    return serverLatencyBuckets - 1;
+}
+
+static void printReport(const Server* s){
+    int total = 0;
+    printf("server: matches per core");
+    for (int w = 0; w < s->threads; w++) {
+        int active = atomic_load_explicit(&s->workers[w].active, memory_order_relaxed);
+        total += active;
+        printf(" %d", active);
+    }
+    printf(" = %d\n", total);
+    int viewers = 0;
+    for (int w = 0; w < s->threads; w++) {
+        viewers += atomic_load_explicit(&s->workers[w].spectators, memory_order_relaxed);
+    }
+    if (viewers > 0) {
+        printf("server: %d viewers\n", viewers);
+    }
+    printf("server: tick latency p50 %ld us, p99 %ld us, p99.9 %ld us, max %ld us\n", latencyPercentile(s, 0.5),
+           latencyPercentile(s, 0.99), latencyPercentile(s, 0.999), latencyPercentile(s, 1.0));
+    fflush(stdout);
+}
+
+static void printUsage(const char* name){
+    fprintf(stderr, "usage: %s [--port N] [--tick-rate N] [--threads N] [--matches-per-core N]\n"
+                    "       [--viewers-per-core N] [--report SECONDS] [--no-pin] [--ccd]\n"
+                    "       [--physics c|branchless|simd|avx512|avx2|sse4.1]\n", name);
+}
+
+int main(int argc, char **argv)
+{
+    int report = 0;
+    const char* physics = "c";
+    server.port = netDefaultPort;
+    server.tickRate = 60;
+    server.sweptCollisions = 0;
+    server.capacity = 4096;
+    server.viewerCapacity = 1024;
+    server.threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    server.pin = 1;
+
+    for (int i = 1; i < argc; i++) {
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(argv[i], "--ccd") == 0) {
+            server.sweptCollisions = 1;
+            continue;
+        }
+        if (strcmp(argv[i], "--no-pin") == 0) {
+            server.pin = 0;
+            continue;
+        }
+        if (value == NULL) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        if (strcmp(argv[i], "--port") == 0) {
+            server.port = atoi(value);
+        } else if (strcmp(argv[i], "--tick-rate") == 0) {
+            server.tickRate = atoi(value);
+        } else if (strcmp(argv[i], "--threads") == 0) {
+            server.threads = atoi(value);
+        } else if (strcmp(argv[i], "--matches-per-core") == 0) {
+            server.capacity = atoi(value);
+        } else if (strcmp(argv[i], "--viewers-per-core") == 0) {
+            server.viewerCapacity = atoi(value);
+        } else if (strcmp(argv[i], "--report") == 0) {
+            report = atoi(value);
+        } else if (strcmp(argv[i], "--physics") == 0) {
+            physics = value;
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+        i++;
+    }
+    if (server.port <= 0 || server.port > 65535 || server.tickRate <= 0 || server.threads < 1
+        || server.capacity < 1 || server.viewerCapacity < 1 || report < 0) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    //every worker steps its own matches, the assembly's global state cannot be shared
+    if (physicsSelect(physics) != 0 || !physicsBackend()->reentrant) {
+        fprintf(stderr, "server: physics backend %s is unknown, not available on this CPU or not reentrant\n", physics);
+        return 1;
+    }
+
+    signal(SIGINT, stopServer);
+    signal(SIGTERM, stopServer);
+    server.workers = calloc((size_t) server.threads, sizeof(Worker));
+    size_t listings = (size_t) server.threads * (size_t) server.capacity;
+    server.directory.listings = malloc(sizeof(Listing) * listings);
+    server.directory.positions = malloc(sizeof(int) * listings);
+    pthread_mutex_init(&server.directory.lock, NULL);
+    if (server.workers == NULL || server.directory.listings == NULL || server.directory.positions == NULL) {
+        return 1;
+    }
+    int started = 0;
+    for (; started < server.threads; started++) {
+        if (startWorker(&server.workers[started], started, &server) != 0) {
+            fprintf(stderr, "server: could not start worker %d on UDP port %d\n", started, server.port);
+            freeWorker(&server.workers[started]);
+            running = 0;
+            break;
+        }
+    }
+    if (running) {
+        printf("server: listening on UDP port %d, %d ticks/sec, %d workers, up to %d matches each, %s physics\n",
+               server.port, server.tickRate, server.threads, server.capacity,
+               server.sweptCollisions ? "swept" : physicsBackend()->name);
+        fflush(stdout);
+    }
+
+    double nextReport = timestepNow() + report;
+    while (running) {
+        struct timespec pause = {0, 100000000};
+        nanosleep(&pause, NULL);
+        if (report > 0 && timestepNow() >= nextReport) {
+            printReport(&server);
+            nextReport += report;
+        }
+    }
+
+    ServerStats total;
+    memset(&total, 0, sizeof(total));
+    int peak = 0;
+    for (int w = 0; w < started; w++) {
+        pthread_join(server.workers[w].thread, NULL);
+        const ServerStats* stats = &server.workers[w].stats;
+        total.ticks += stats->ticks;
+        total.received += stats->received;
+        total.sent += stats->sent;
+        total.bytesIn += stats->bytesIn;
+        total.bytesOut += stats->bytesOut;
+        total.lateInputs += stats->lateInputs;
+        total.droppedTicks += stats->droppedTicks;
+        total.refused += stats->refused;
+        total.deltas += stats->deltas;
+        total.keyFrames += stats->keyFrames;
+        total.encodes += stats->encodes;
+        total.deltaBytes += stats->deltaBytes;
+        total.rateCuts += stats->rateCuts;
+        total.throttled += stats->throttled;
+        total.forwarded += stats->forwarded;
+        peak += server.workers[w].peak;
+    }
+    if (started == server.threads) {
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        double cpu = (double) usage.ru_utime.tv_sec + (double) usage.ru_utime.tv_usec * 1e-6
+            + (double) usage.ru_stime.tv_sec + (double) usage.ru_stime.tv_usec * 1e-6;
+        printReport(&server);
+        printf("server: %lld match ticks, %lld datagrams in (%lld bytes), %lld out (%lld bytes)\n",
+               total.ticks, total.received, total.bytesIn, total.sent, total.bytesOut);
+        printf("server: peak %d matches, %lld late inputs, %lld dropped ticks, %lld refused\n",
+               peak, total.lateInputs, total.droppedTicks, total.refused);
+        if (total.deltas > 0) {
+            printf("server: %lld deltas to viewers (%lld key frames), %.1f bytes each, %.3f encodes per delta\n",
+                   total.deltas, total.keyFrames, (double) total.deltaBytes / (double) total.deltas,
+                   (double) total.encodes / (double) total.deltas);
+            printf("server: %lld viewer ticks throttled, %lld rate cuts, %lld viewer datagrams forwarded\n",
+                   total.throttled, total.rateCuts, total.forwarded);
+        }
+        printf("server: %.3f s CPU, %.2f us per match tick\n", cpu, total.ticks ? cpu * 1e6 / (double) total.ticks : 0.0);
+    }
+    for (int w = 0; w < started; w++) {
+        freeWorker(&server.workers[w]);
+    }
+    free(server.workers);
+    free(server.directory.listings);
+    free(server.directory.positions);
+    pthread_mutex_destroy(&server.directory.lock);
+    return started == server.threads ? 0 : 1;
+}
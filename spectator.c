@@ -0,0 +1,161 @@
+// Spectator client, see spectator.h
+
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include "spectator.h"
+#include "timestep.h"
+
+static void sendPacket(Spectator* s, const NetPacket* packet){
+    int size = netSend(s->fd, &s->server, packet);
+    if (size > 0) {
+        s->bytesSent += size;
+    }
+}
+
+int spectatorConnect(Spectator* s, const char* address, int match, int rate){
+    memset(s, 0, sizeof(Spectator));
+    s->fd = -1;
+    s->tick = -1;
+    for (int i = 0; i < netDeltaHistory; i++) {
+        s->receivedTicks[i] = -1;
+    }
+    if (netResolve(address, &s->server) != 0) {
+        return -1;
+    }
+    s->fd = netOpenSocket(0, 0);
+    if (s->fd < 0) {
+        return -1;
+    }
+    simInitGlobals(&s->state);
+
+    NetPacket watch;
+    memset(&watch, 0, sizeof(watch));
+    watch.type = NET_WATCH;
+    watch.match = match;
+    watch.rate = rate;
+    double start = timestepNow();
+    for (unsigned int attempt = 1; timestepNow() - start < netTimeoutSeconds; attempt++) {
+        watch.nonce = attempt;
+        sendPacket(s, &watch);
+        struct pollfd wait = {s->fd, POLLIN, 0};
+        while (poll(&wait, 1, 200) > 0) {
+            struct sockaddr_in from;
+            NetPacket reply;
+            int bytes;
+            if (!netReceive(s->fd, &from, &reply, &bytes)) {
+                break;
+            }
+            s->bytesReceived += bytes;
+            if (reply.type == NET_BYE) {
+                spectatorClose(s);
+                return -1;
+            }
+            if (reply.type == NET_WELCOME && reply.nonce == attempt) {
+                s->tickRate = reply.tickRate > 0 ? reply.tickRate : 60;
+                s->lastHeard = timestepNow();
+                s->linkTime = s->lastHeard;
+                return 0;
+            }
+        }
+    }
+    spectatorClose(s);
+    return -1;
+}
+
+void spectatorClose(Spectator* s){
+    if (s->fd >= 0) {
+        NetPacket bye;
+        memset(&bye, 0, sizeof(bye));
+        bye.type = NET_BYE;
+        sendPacket(s, &bye);
+        close(s->fd);
+        s->fd = -1;
+    }
+}
+
+//Token bucket in front of the socket, holds a quarter second of traffic
+static int passesLink(Spectator* s, int bytes, double now){
+    if (s->linkRate <= 0) {
+        return 1;
+    }
+    s->linkBudget += (now - s->linkTime) * s->linkRate;
+    s->linkTime = now;
+    if (s->linkBudget > s->linkRate * 0.25) {
+        s->linkBudget = s->linkRate * 0.25;
+    }
+    if (s->linkBudget < bytes + netUdpOverhead) {
+        s->dropped++;
+        return 0;
+    }
+    s->linkBudget -= bytes + netUdpOverhead;
+    return 1;
+}
+
+static int decodeDelta(Spectator* s, const NetPacket* packet){
+    const Global* base = NULL;
+    if (packet->baseTick != packet->tick) {
+        int slot = (int) (packet->baseTick % netDeltaHistory);
+        if (s->receivedTicks[slot] != packet->baseTick) {
+            return -1;
+        }
+        base = &s->received[slot];
+    }
+    Global state;
+    if (netDecodeDelta(base, packet->delta, packet->deltaSize, &state) != 0
+        || netStateChecksum(&state) != packet->checksum) {
+        return -1;
+    }
+    int slot = (int) (packet->tick % netDeltaHistory);
+    s->received[slot] = state;
+    s->receivedTicks[slot] = packet->tick;
+    if (base == NULL) {
+        s->keyFrames++;
+    }
+    return 0;
+}
+
+int spectatorReceive(Spectator* s){
+    struct sockaddr_in from;
+    NetPacket packet;
+    int bytes;
+    long newest = s->tick;
+    double now = timestepNow();
+    while (netReceive(s->fd, &from, &packet, &bytes)) {
+        if (!passesLink(s, bytes, now)) {
+            continue;
+        }
+        s->bytesReceived += bytes;
+        s->lastHeard = now;
+        if (packet.type == NET_BYE) {
+            s->disconnected = 1;
+        }
+        if (packet.type != NET_DELTA || packet.tick <= s->tick - netDeltaHistory) {
+            continue;
+        }
+        if (decodeDelta(s, &packet) != 0) {
+            s->badDeltas++;
+            continue;
+        }
+        s->deltas++;
+        if (packet.tick > newest) {
+            newest = packet.tick;
+        }
+    }
+    if (now - s->lastHeard > netTimeoutSeconds) {
+        s->disconnected = 1;
+    }
+    if (newest == s->tick) {
+        return 0;
+    }
+    s->tick = newest;
+    s->state = s->received[newest % netDeltaHistory];
+
+    NetPacket ack;
+    memset(&ack, 0, sizeof(ack));
+    ack.type = NET_ACK;
+    ack.tick = newest;
+    ack.received = s->deltas + s->badDeltas;
+    sendPacket(s, &ack);
+    return 1;
+}
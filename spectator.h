@@ -0,0 +1,43 @@
+// Spectator client
+// Watches a match on the server without playing in it. The server sends the state after each
+// tick as a bit-packed delta against the newest state this viewer acknowledged, as often as the
+// viewer's bandwidth allows, so a viewer only needs to keep the last few states it decoded.
+
+#ifndef SPECTATOR_H
+#define SPECTATOR_H
+
+#include <netinet/in.h>
+#include "net.h"
+
+
+typedef struct Spectator{
+    int fd;
+    struct sockaddr_in server;
+    int tickRate; //the server's
+    Global state; //newest decoded state
+    long tick; //its tick, -1 before the first
+    Global received[netDeltaHistory]; //state after tick t at t % netDeltaHistory
+    long receivedTicks[netDeltaHistory];
+    int linkRate; //bytes/sec the emulated link passes, 0 = no limit, for testing the rate control
+    double linkBudget; //bytes the emulated link may still pass
+    double linkTime;
+    int disconnected; //the server said bye or went silent
+    double lastHeard;
+    long deltas;
+    long keyFrames;
+    long badDeltas; //unknown base or wrong checksum, dropped
+    long dropped; //over the emulated link rate
+    long long bytesSent;
+    long long bytesReceived;
+} Spectator;
+
+//Resolves "host[:port]" and asks to watch one of the server's matches (wraps around),
+//rate is the most bytes/sec to send us. Returns -1 on failure.
+int spectatorConnect(Spectator* s, const char* address, int match, int rate);
+//Says bye
+void spectatorClose(Spectator* s);
+
+//Decodes every delta that arrived and acknowledges the newest, returns 1 if the state changed
+int spectatorReceive(Spectator* s);
+
+#endif
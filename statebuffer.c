@@ -0,0 +1,35 @@
+// State handoff, see statebuffer.h
+// The three slots are always owned one each by the writer, the middle and the reader. Publishing
+// swaps the back slot into the middle with release order and marks it fresh; the reader swaps its
+// front slot for the middle with acquire order only when the fresh mark is set, so it never goes
+// back to an older snapshot.
+
+#include "statebuffer.h"
+
+#define stateFresh 4u //flag next to the slot index in middle
+
+void stateBufferInit(StateBuffer* buffer, const SimSnapshot* initial){
+    for (int i = 0; i < 3; i++) {
+        buffer->slots[i] = *initial;
+    }
+    buffer->back = 0;
+    atomic_init(&buffer->middle, 1);
+    buffer->front = 2;
+}
+
+SimSnapshot* stateBufferBack(StateBuffer* buffer){
+    return &buffer->slots[buffer->back];
+}
+
+void stateBufferPublish(StateBuffer* buffer){
+    unsigned int old = atomic_exchange_explicit(&buffer->middle, buffer->back | stateFresh, memory_order_acq_rel);
+    buffer->back = old & ~stateFresh;
+}
+
+const SimSnapshot* stateBufferLatest(StateBuffer* buffer){
+    if (atomic_load_explicit(&buffer->middle, memory_order_relaxed) & stateFresh) {
+        unsigned int old = atomic_exchange_explicit(&buffer->middle, buffer->front, memory_order_acq_rel);
+        buffer->front = old & ~stateFresh;
+    }
+    return &buffer->slots[buffer->front];
+}
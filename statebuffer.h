@@ -0,0 +1,38 @@
+// State handoff
+// Lock-free triple buffer that carries simulation snapshots to the renderer. The simulation fills
+// the back slot and publishes it, the renderer takes the newest published slot whenever it
+// draws; neither side ever waits for the other, and a snapshot is never written while read.
+// One thread writes, one thread reads (they may be the same thread).
+
+#ifndef STATEBUFFER_H
+#define STATEBUFFER_H
+
+#include <stdatomic.h>
+#include "pong.h"
+
+typedef struct SimSnapshot{
+    Global state; //right after the tick
+    Global previous; //one tick earlier, for interpolation
+    double time; //timestepNow() at which state is due, the accumulator is the time past it
+    long long tick; //ticks simulated so far
+    unsigned long inputsApplied; //latency cursor, see latencyTick
+} SimSnapshot;
+
+typedef struct StateBuffer{
+    SimSnapshot slots[3];
+    _Alignas(64) atomic_uint middle; //slot between the sides, stateFresh set while not yet read
+    _Alignas(64) unsigned int back; //writer's slot
+    _Alignas(64) unsigned int front; //reader's slot
+} StateBuffer;
+
+//Every slot starts as initial
+void stateBufferInit(StateBuffer* buffer, const SimSnapshot* initial);
+
+//Writer side: the slot to fill, then publish it
+SimSnapshot* stateBufferBack(StateBuffer* buffer);
+void stateBufferPublish(StateBuffer* buffer);
+
+//Reader side: the newest published snapshot, valid until the next call
+const SimSnapshot* stateBufferLatest(StateBuffer* buffer);
+
+#endif
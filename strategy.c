@@ -0,0 +1,62 @@
+// Paddle strategies, see strategy.h
+
+#include <string.h>
+#include "strategy.h"
+
+//Paddle centre the predict strategy heads for
+static int predictTarget(const Global* g, PaddleSide side, PredictRules rules){
+    const Point* paddle = side == SIDE_AI ? &g->aiPaddlePosition : &g->playerPaddlePosition;
+    int planeX = side == SIDE_AI ? paddle->x + paddleWidth : paddle->x - ballSideLength;
+    Intercept intercept;
+
+    if (predictIntercept(g, planeX, rules, &intercept) != 0) {
+        return screenHeight / 2;
+    }
+    return intercept.y + ballSideLength / 2;
+}
+
+void movePaddle(Global* g, PaddleSide side, PaddleStrategy strategy, int speed, PredictRules rules){
+    Point* paddle = side == SIDE_AI ? &g->aiPaddlePosition : &g->playerPaddlePosition;
+    int ourHalf = side == SIDE_AI ? g->ballPosition.x < screenWidth / 2 : g->ballPosition.x >= screenWidth / 2;
+    int diff;
+
+    switch (strategy) {
+        case STRATEGY_CHASE:
+            diff = g->ballPosition.y - paddle->y;
+            break;
+        case STRATEGY_TRACK:
+            paddle->y = simTrackPaddle(g, paddle->y, speed, ourHalf);
+            return;
+        case STRATEGY_PREDICT:
+            //knows where the ball goes, so it moves on either half and stops exactly on target
+            diff = predictTarget(g, side, rules) - (paddle->y + paddleLength / 2);
+            paddle->y += diff > speed ? speed : diff < -speed ? -speed : diff;
+            return;
+        default:
+            return;
+    }
+    if (!ourHalf) {
+        return;
+    }
+    if (diff > 0) {
+        paddle->y += speed;
+    } else if (diff < 0) {
+        paddle->y -= speed;
+    }
+}
+
+static const char* const strategyNames[] = {"chase", "track", "predict", "idle"};
+
+int parseStrategy(const char* name, PaddleStrategy* strategy){
+    for (int i = 0; i < (int) (sizeof(strategyNames) / sizeof(strategyNames[0])); i++) {
+        if (strcmp(name, strategyNames[i]) == 0) {
+            *strategy = (PaddleStrategy) i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const char* strategyName(PaddleStrategy strategy){
+    return strategyNames[strategy];
+}
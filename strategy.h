@@ -0,0 +1,29 @@
+// Paddle strategies for the simulation tools
+// Each strategy moves one paddle by at most speed pixels per frame, for either side of the field.
+
+#ifndef STRATEGY_H
+#define STRATEGY_H
+
+#include "pong.h"
+#include "predict.h"
+
+typedef enum PaddleStrategy{
+    STRATEGY_CHASE, //updateAI's rule: follow the ball's y with the paddle top while the ball is on our half
+    STRATEGY_TRACK, //centre the paddle on the ball while it is on our half
+    STRATEGY_PREDICT, //centre the paddle on the predicted intercept while the ball comes at us, else go back to the middle
+    STRATEGY_IDLE   //never move
+} PaddleStrategy;
+
+typedef enum PaddleSide{
+    SIDE_AI,     //left paddle
+    SIDE_PLAYER  //right paddle
+} PaddleSide;
+
+//Moves the paddle on the given side for one frame, rules are the ball rules the match is played on
+void movePaddle(Global* g, PaddleSide side, PaddleStrategy strategy, int speed, PredictRules rules);
+
+//Returns -1 if the name is unknown
+int parseStrategy(const char* name, PaddleStrategy* strategy);
+const char* strategyName(PaddleStrategy strategy);
+
+#endif
@@ -0,0 +1,159 @@
+// Frame and simulation telemetry, see telemetry.h
+// A value v below 256 ns has its own bucket. Above that, with e the index of its highest set bit,
+// the bucket is picked by the 7 bits below it: v >> (e - 7) lies in [128, 256), so every power of
+// two is split into 128 buckets of equal width.
+
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "telemetry.h"
+
+#define telemetrySubBits 7
+#define telemetrySub (1 << telemetrySubBits)
+#define telemetryBuckets 3840 //up to 2^36 ns, about 68 s; longer values land in the last bucket
+
+typedef struct Histogram{
+    atomic_ullong counts[telemetryBuckets];
+    atomic_ullong count;
+    atomic_ullong sum; //ns, for the mean
+    atomic_llong max;
+} Histogram;
+
+static Histogram histograms[TELEMETRY_ZONES];
+
+static const char* const zoneNames[TELEMETRY_ZONES] = {
+    "gameLogic", "drawWalls", "drawPaddle", "drawBall", "drawScore", "submit", "swap", "draw", "frame",
+    "inputTick", "inputDraw", "inputPhoton", "present", "jitter"
+};
+
+static const char* reportPath = NULL;
+static volatile sig_atomic_t dumpRequested = 0;
+
+long long telemetryNow(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int bucketIndex(unsigned long long value){
+    if (value < 2 * telemetrySub) {
+        return (int) value;
+    }
+    int shift = 63 - __builtin_clzll(value) - telemetrySubBits;
+    int index = (shift + 1) * telemetrySub + (int) (value >> shift) - telemetrySub;
+    return index < telemetryBuckets ? index : telemetryBuckets - 1;
+}
+
+//Middle of the values that fall into the bucket, what percentiles report
+static long long bucketValue(int index){
+    if (index < 2 * telemetrySub) {
+        return index;
+    }
+    int shift = index / telemetrySub - 1;
+    return ((long long) (index % telemetrySub + telemetrySub) << shift) + (1LL << shift) / 2;
+}
+
+void telemetryRecord(TelemetryZone zone, long long nanoseconds){
+    Histogram* h = &histograms[zone];
+    if (nanoseconds < 0) {
+        nanoseconds = 0;
+    }
+    atomic_fetch_add_explicit(&h->counts[bucketIndex((unsigned long long) nanoseconds)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->sum, (unsigned long long) nanoseconds, memory_order_relaxed);
+    long long max = atomic_load_explicit(&h->max, memory_order_relaxed);
+    while (nanoseconds > max
+           && !atomic_compare_exchange_weak_explicit(&h->max, &max, nanoseconds, memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+long long telemetryLap(TelemetryZone zone, long long start){
+    long long now = telemetryNow();
+    telemetryRecord(zone, now - start);
+    return now;
+}
+
+//Value below which the fraction q of the recorded values lie, from a copy of the counts,
+//never above the exact maximum
+static long long percentile(const unsigned long long* counts, unsigned long long total, long long max, double q){
+    unsigned long long rank = (unsigned long long) (q * (double) total + 0.5);
+    if (rank < 1) {
+        rank = 1;
+    }
+    unsigned long long seen = 0;
+    for (int i = 0; i < telemetryBuckets; i++) {
+        seen += counts[i];
+        if (seen >= rank) {
+            return bucketValue(i) < max ? bucketValue(i) : max;
+        }
+    }
+    return max;
+}
+
+int telemetryDump(const char* path){
+    FILE* out = path == NULL || strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+    if (out == NULL) {
+        return -1;
+    }
+    static unsigned long long counts[telemetryBuckets];
+    fprintf(out, "telemetry: %-11s %10s %10s %10s %10s %10s %10s\n", "zone", "count", "mean us", "p50 us", "p99 us",
+            "p99.9 us", "max us");
+    for (int zone = 0; zone < TELEMETRY_ZONES; zone++) {
+        Histogram* h = &histograms[zone];
+        //recording goes on meanwhile, so the total is taken from the copied buckets
+        unsigned long long total = 0;
+        for (int i = 0; i < telemetryBuckets; i++) {
+            counts[i] = atomic_load_explicit(&h->counts[i], memory_order_relaxed);
+            total += counts[i];
+        }
+        if (total == 0) {
+            continue;
+        }
+        double mean = (double) atomic_load_explicit(&h->sum, memory_order_relaxed)
+                      / (double) atomic_load_explicit(&h->count, memory_order_relaxed);
+        long long max = atomic_load_explicit(&h->max, memory_order_relaxed);
+        fprintf(out, "telemetry: %-11s %10llu %10.1f %10.1f %10.1f %10.1f %10.1f\n", zoneNames[zone], total, mean / 1e3,
+                percentile(counts, total, max, 0.5) / 1e3, percentile(counts, total, max, 0.99) / 1e3,
+                percentile(counts, total, max, 0.999) / 1e3, max / 1e3);
+    }
+    fflush(out);
+    if (out != stdout) {
+        fclose(out);
+    }
+    return 0;
+}
+
+static void dumpAtExit(){
+    if (telemetryDump(reportPath) != 0) {
+        fprintf(stderr, "Failed to write telemetry: %s\n", reportPath);
+    }
+}
+
+//stdio is not async-signal-safe, the report is left to telemetryPoll
+static void requestDump(int signal){
+    (void) signal;
+    dumpRequested = 1;
+}
+
+int telemetryInstall(const char* path){
+    reportPath = path;
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = requestDump;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    if (sigaction(SIGUSR1, &action, NULL) != 0 || atexit(dumpAtExit) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+void telemetryPoll(){
+    if (dumpRequested) {
+        dumpRequested = 0;
+        dumpAtExit();
+    }
+}
@@ -0,0 +1,48 @@
+// Frame and simulation telemetry
+// Always-on timers for the stages of a frame (the rules, building and submitting the shapes, the
+// buffer swap), recorded into log-linear histograms in the style of HdrHistogram: 128 buckets per
+// power of two, so any value is kept to within 0.4%, from 1 ns up to a minute in 3840 counters per zone.
+// Recording is a couple of relaxed atomic adds, safe from any thread and cheap enough to leave on.
+// The report (count, mean, p50/p99/p99.9, max) is printed at exit and whenever SIGUSR1 arrives.
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+typedef enum TelemetryZone{
+    TELEMETRY_SIM, //one tick of the rules
+    TELEMETRY_DRAW_WALLS,
+    TELEMETRY_DRAW_PADDLE,
+    TELEMETRY_DRAW_BALL,
+    TELEMETRY_DRAW_SCORE,
+    TELEMETRY_SUBMIT, //the frame's shapes to OpenGL
+    TELEMETRY_SWAP, //glutSwapBuffers
+    TELEMETRY_DRAW, //all of draw(), swap included
+    TELEMETRY_FRAME, //from one swap to the next, what the player sees
+    TELEMETRY_INPUT_TICK, //input event to the tick that applies it, latency.c
+    TELEMETRY_INPUT_DRAW, //input event to the draw that renders it
+    TELEMETRY_INPUT_PRESENT, //input event to the frame on screen, input-to-photon
+    TELEMETRY_PRESENT, //between two presents
+    TELEMETRY_JITTER, //difference between two consecutive present intervals
+    TELEMETRY_ZONES
+} TelemetryZone;
+
+//Monotonic clock in nanoseconds
+long long telemetryNow();
+
+//Adds one duration to the zone's histogram
+void telemetryRecord(TelemetryZone zone, long long nanoseconds);
+
+//Records the time since start and returns the current time, so zones can be chained
+long long telemetryLap(TelemetryZone zone, long long start);
+
+//Reports to path ("-" or NULL = stdout) at exit and on SIGUSR1. The signal only raises a flag,
+//the report is written by the next telemetryPoll. Returns -1 if the handlers cannot be installed.
+int telemetryInstall(const char* path);
+
+//Writes the report if SIGUSR1 arrived since the last call, call it from the main loop
+void telemetryPoll();
+
+//Writes the report now, returns -1 if the file cannot be opened
+int telemetryDump(const char* path);
+
+#endif
@@ -0,0 +1,34 @@
+// Test helpers, see testutil.h
+
+#include <stdio.h>
+#include "testutil.h"
+
+static unsigned int rngState = 1;
+
+void testSeed(unsigned int seed){
+    rngState = seed;
+}
+
+unsigned int testRandom(){
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return rngState;
+}
+
+int testRandomBetween(int low, int high){
+    return low + (int) (testRandom() % (unsigned int) (high - low + 1));
+}
+
+int testRandomSign(){
+    return testRandom() & 1 ? 1 : -1;
+}
+
+void testPrintState(const char* label, const Global* g){
+    fprintf(stderr, "  %-10s ball %d+%d/65536 %d+%d/65536 dir %d %d speed %d, paddles %d,%d %d,%d+%d/65536, "
+            "score %d-%d last %d over %d, scale %d\n",
+            label, g->ballPosition.x, g->ballFraction.x, g->ballPosition.y, g->ballFraction.y, g->ballDirection.x,
+            g->ballDirection.y, g->ballSpeed, g->playerPaddlePosition.x, g->playerPaddlePosition.y,
+            g->aiPaddlePosition.x, g->aiPaddlePosition.y, g->aiPaddleFraction, g->playerScore, g->aiScore,
+            g->lastScore, g->gameOver, g->tickScale);
+}
@@ -0,0 +1,21 @@
+// Helpers shared by the test programs and the benchmarks
+// A seeded xorshift32 generator, so every run draws the same numbers, and a dump of a match
+// state for failure reports.
+
+#ifndef TESTUTIL_H
+#define TESTUTIL_H
+
+#include "pong.h"
+
+//Starts the sequence over, seed must not be 0 (xorshift gets stuck on it)
+void testSeed(unsigned int seed);
+unsigned int testRandom();
+//low to high inclusive
+int testRandomBetween(int low, int high);
+//+1 or -1
+int testRandomSign();
+
+//Every field of g on one line of stderr, label first
+void testPrintState(const char* label, const Global* g);
+
+#endif
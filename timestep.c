@@ -0,0 +1,44 @@
+// Fixed timestep scheduler, see timestep.h
+
+#include <time.h>
+#include "timestep.h"
+
+void timestepInit(FixedTimestep* step, int tickRate, int maxCatchUp, double now){
+    step->tickSeconds = 1.0 / (double) tickRate;
+    step->maxCatchUp = maxCatchUp > 0 ? maxCatchUp : 1;
+    step->accumulator = 0.0;
+    step->lastTime = now;
+    step->ticks = 0;
+    step->droppedTicks = 0;
+}
+
+int timestepAdvance(FixedTimestep* step, double now){
+    double elapsed = now - step->lastTime;
+    step->lastTime = now;
+    if (elapsed > 0.0) {
+        step->accumulator += elapsed;
+    }
+
+    int ticks = (int) (step->accumulator / step->tickSeconds);
+    if (ticks > step->maxCatchUp) {
+        //a stall (window drag, debugger, slow swap) must not make the next frames slower too,
+        //so the backlog beyond the cap is thrown away and the game just pauses for that long
+        step->droppedTicks += ticks - step->maxCatchUp;
+        step->accumulator -= (double) (ticks - step->maxCatchUp) * step->tickSeconds;
+        ticks = step->maxCatchUp;
+    }
+    step->accumulator -= (double) ticks * step->tickSeconds;
+    step->ticks += ticks;
+    return ticks;
+}
+
+double timestepUntilNextTick(const FixedTimestep* step){
+    double remaining = step->tickSeconds - step->accumulator;
+    return remaining > 0.0 ? remaining : 0.0;
+}
+
+double timestepNow(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
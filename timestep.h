@@ -0,0 +1,28 @@
+// Fixed timestep scheduler
+// Turns wall clock time into a whole number of simulation ticks at a fixed rate, so the
+// game runs at the same speed on slow and fast hosts. Leftover time stays in the accumulator.
+
+#ifndef TIMESTEP_H
+#define TIMESTEP_H
+
+typedef struct FixedTimestep{
+    double tickSeconds; //1 / tick rate
+    int maxCatchUp; //most ticks run for one call, the rest of a backlog is dropped
+    double accumulator; //time not yet simulated, in seconds
+    double lastTime;
+    long long ticks; //ticks handed out so far
+    long long droppedTicks; //ticks skipped to escape the spiral of death
+} FixedTimestep;
+
+void timestepInit(FixedTimestep* step, int tickRate, int maxCatchUp, double now);
+
+//Adds the time since the last call and returns how many ticks to simulate now
+int timestepAdvance(FixedTimestep* step, double now);
+
+//Seconds from now until the next tick is due
+double timestepUntilNextTick(const FixedTimestep* step);
+
+//Monotonic clock in seconds
+double timestepNow();
+
+#endif
@@ -0,0 +1,341 @@
+// Tournament runner
+// Plays a list of matchups (paddle strategies, paddle speeds and serves) on the reentrant
+// rules, spread over all cores by the work-stealing scheduler, and writes one result per match.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "pong.h"
+#include "strategy.h"
+#include "scheduler.h"
+#include "timestep.h"
+
+typedef struct Matchup{
+    PaddleStrategy ai;
+    PaddleStrategy player;
+    int aiSpeed; //Pixels/Frame
+    int playerSpeed; //Pixels/Frame
+    int serveCenter; //1 = serve like initGlobals, 0 = use serveY/serveDirection
+    int serveY;
+    Point serveDirection;
+} Matchup;
+
+typedef struct MatchResult{
+    int playerScore;
+    int aiScore;
+    long ticks;
+    int worker;
+    int aborted; //hit the tick cap before 9 points
+} MatchResult;
+
+typedef struct Tournament{
+    Matchup* matchups;
+    int count;
+    long maxTicks;
+    int sweptCollisions; //1 = continuous collision rules
+    MatchResult* results;
+} Tournament;
+
+//One frame of a match: gameLogic with the AI rule replaced by the matchup's strategy,
+//the player paddle moves first like a mouse event would
+static void stepMatch(Global* g, const Matchup* m, int sweptCollisions){
+    PredictRules rules = sweptCollisions ? PREDICT_SWEPT : PREDICT_TICK;
+
+    movePaddle(g, SIDE_PLAYER, m->player, m->playerSpeed, rules);
+    if (g->playerScore == winningScore || g->aiScore == winningScore) {
+        g->gameOver = 1;
+        return;
+    }
+    if (sweptCollisions) {
+        simUpdateBallSwept(g);
+    } else {
+        simUpdateBall(g);
+    }
+    movePaddle(g, SIDE_AI, m->ai, m->aiSpeed, rules);
+}
+
+static void playMatch(void* context, int task, int worker){
+    Tournament* tournament = context;
+    const Matchup* m = &tournament->matchups[task];
+    Global g;
+
+    simInitGlobals(&g);
+    if (!m->serveCenter) {
+        g.ballPosition.y = m->serveY;
+        g.ballDirection = m->serveDirection;
+    }
+    long tick = 0;
+    while (!g.gameOver && tick < tournament->maxTicks) {
+        stepMatch(&g, m, tournament->sweptCollisions);
+        tick++;
+    }
+
+    MatchResult* result = &tournament->results[task];
+    result->playerScore = g.playerScore;
+    result->aiScore = g.aiScore;
+    result->ticks = tick;
+    result->worker = worker;
+    result->aborted = !g.gameOver;
+}
+
+static void formatServe(const Matchup* m, char* out, size_t size){
+    if (m->serveCenter) {
+        snprintf(out, size, "center");
+    } else {
+        snprintf(out, size, "%d:%d:%d", m->serveY, m->serveDirection.x, m->serveDirection.y);
+    }
+}
+
+//serve is "center" or "y:dx:dy"
+static int parseServe(const char* text, Matchup* m){
+    if (strcmp(text, "center") == 0) {
+        m->serveCenter = 1;
+        return 0;
+    }
+    m->serveCenter = 0;
+    if (sscanf(text, "%d:%d:%d", &m->serveY, &m->serveDirection.x, &m->serveDirection.y) != 3) {
+        return -1;
+    }
+    if (m->serveY < 10 || m->serveY > ballMaxY
+        || (m->serveDirection.x != 1 && m->serveDirection.x != -1)
+        || (m->serveDirection.y != 1 && m->serveDirection.y != -1)) {
+        return -1;
+    }
+    return 0;
+}
+
+//Appends one matchup, growing the array as needed
+static int addMatchup(Tournament* t, int* capacity, const Matchup* m){
+    if (t->count == *capacity) {
+        int grown = *capacity ? *capacity * 2 : 256;
+        Matchup* matchups = realloc(t->matchups, sizeof(Matchup) * (size_t) grown);
+        if (matchups == NULL) {
+            return -1;
+        }
+        t->matchups = matchups;
+        *capacity = grown;
+    }
+    t->matchups[t->count++] = *m;
+    return 0;
+}
+
+//Matchup file: one "ai player aiSpeed playerSpeed serve" per line, # starts a comment
+static int loadMatchups(Tournament* t, const char* path, int repeat){
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        fprintf(stderr, "Failed to open matchups: %s\n", path);
+        return -1;
+    }
+    int capacity = 0;
+    char line[256];
+    int lineNumber = 0;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        lineNumber++;
+        char* comment = strchr(line, '#');
+        if (comment != NULL) {
+            *comment = '\0';
+        }
+        char ai[32], player[32], serve[64];
+        Matchup m;
+        int fields = sscanf(line, "%31s %31s %d %d %63s", ai, player, &m.aiSpeed, &m.playerSpeed, serve);
+        if (fields <= 0) {
+            continue;
+        }
+        if (fields != 5 || parseStrategy(ai, &m.ai) != 0 || parseStrategy(player, &m.player) != 0
+            || parseServe(serve, &m) != 0 || m.aiSpeed < 0 || m.playerSpeed < 0) {
+            fprintf(stderr, "%s:%d: expected \"ai player aiSpeed playerSpeed center|y:dx:dy\"\n", path, lineNumber);
+            fclose(file);
+            return -1;
+        }
+        for (int r = 0; r < repeat; r++) {
+            if (addMatchup(t, &capacity, &m) != 0) {
+                fclose(file);
+                return -1;
+            }
+        }
+    }
+    fclose(file);
+    return 0;
+}
+
+//Default balance sweep: every strategy pair, paddle speeds 3..8 and four serves
+static int sweepMatchups(Tournament* t, int repeat){
+    static const char* const serves[] = {"center", "200:1:1", "800:-1:-1", "540:-1:1"};
+    int capacity = 0;
+    for (int ai = STRATEGY_CHASE; ai <= STRATEGY_IDLE; ai++) {
+        for (int player = STRATEGY_CHASE; player <= STRATEGY_IDLE; player++) {
+            for (int aiSpeed = 3; aiSpeed <= 8; aiSpeed++) {
+                for (int playerSpeed = 3; playerSpeed <= 8; playerSpeed++) {
+                    for (int s = 0; s < 4; s++) {
+                        Matchup m = {(PaddleStrategy) ai, (PaddleStrategy) player, aiSpeed, playerSpeed, 1, 0, {0, 0}};
+                        parseServe(serves[s], &m);
+                        for (int r = 0; r < repeat; r++) {
+                            if (addMatchup(t, &capacity, &m) != 0) {
+                                return -1;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+static int writeResults(const Tournament* t, const char* path){
+    FILE* file = fopen(path, "w");
+    if (file == NULL) {
+        fprintf(stderr, "Failed to open results: %s\n", path);
+        return -1;
+    }
+    fprintf(file, "match,ai,player,ai_speed,player_speed,serve,player_score,ai_score,ticks,aborted,worker\n");
+    for (int i = 0; i < t->count; i++) {
+        const Matchup* m = &t->matchups[i];
+        const MatchResult* r = &t->results[i];
+        char serve[64];
+        formatServe(m, serve, sizeof(serve));
+        fprintf(file, "%d,%s,%s,%d,%d,%s,%d,%d,%ld,%d,%d\n", i, strategyName(m->ai), strategyName(m->player),
+                m->aiSpeed, m->playerSpeed, serve, r->playerScore, r->aiScore, r->ticks, r->aborted, r->worker);
+    }
+    fclose(file);
+    return 0;
+}
+
+//Runs the whole tournament once, returns the wall time in seconds or a negative value on failure
+static double runTournament(Tournament* t, int threads, SchedulerStats* stats){
+    double start = timestepNow();
+    if (runTasks(t->count, threads, playMatch, t, stats) != 0) {
+        return -1.0;
+    }
+    return timestepNow() - start;
+}
+
+//Results without the worker column, which is the only field allowed to change with the thread count
+static int sameResults(const MatchResult* a, const MatchResult* b, int count){
+    for (int i = 0; i < count; i++) {
+        if (a[i].playerScore != b[i].playerScore || a[i].aiScore != b[i].aiScore
+            || a[i].ticks != b[i].ticks || a[i].aborted != b[i].aborted) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+//Thread counts of a --scale run: doubling from 1, with scaleMax always the last step
+static int nextScale(int n, int scaleMax){
+    if (n == scaleMax) {
+        return scaleMax + 1;
+    }
+    return n * 2 < scaleMax ? n * 2 : scaleMax;
+}
+
+static void printUsage(const char* name){
+    fprintf(stderr,
+            "usage: %s [--matchups FILE] [--repeat N] [--threads N] [--scale MAX_THREADS]\n"
+            "       [--out FILE] [--max-ticks N] [--ccd]\n", name);
+}
+
+int main(int argc, char **argv)
+{
+    const char* matchupPath = NULL;
+    const char* outPath = NULL;
+    int repeat = 1;
+    int threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    int scaleMax = 0;
+    Tournament t = {NULL, 0, 1000000, 0, NULL};
+
+    for (int i = 1; i < argc; i++) {
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(argv[i], "--ccd") == 0) {
+            t.sweptCollisions = 1;
+            continue;
+        }
+        if (value == NULL) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        if (strcmp(argv[i], "--matchups") == 0) {
+            matchupPath = value;
+        } else if (strcmp(argv[i], "--out") == 0) {
+            outPath = value;
+        } else if (strcmp(argv[i], "--repeat") == 0) {
+            repeat = atoi(value);
+        } else if (strcmp(argv[i], "--threads") == 0) {
+            threads = atoi(value);
+        } else if (strcmp(argv[i], "--scale") == 0) {
+            scaleMax = atoi(value);
+        } else if (strcmp(argv[i], "--max-ticks") == 0) {
+            t.maxTicks = atol(value);
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+        i++;
+    }
+    if (repeat < 1 || threads < 1 || t.maxTicks < 1 || scaleMax < 0) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    int loaded = matchupPath != NULL ? loadMatchups(&t, matchupPath, repeat) : sweepMatchups(&t, repeat);
+    if (loaded != 0 || t.count == 0) {
+        fprintf(stderr, "No matchups to play\n");
+        free(t.matchups);
+        return 1;
+    }
+    t.results = calloc((size_t) t.count, sizeof(MatchResult));
+    if (t.results == NULL) {
+        free(t.matchups);
+        return 1;
+    }
+
+    int status = 0;
+    SchedulerStats stats;
+    if (scaleMax == 0) {
+        double elapsed = runTournament(&t, threads, &stats);
+        if (elapsed < 0.0) {
+            status = 1;
+        } else {
+            long long ticks = 0;
+            for (int i = 0; i < t.count; i++) {
+                ticks += t.results[i].ticks;
+            }
+            printf("tournament: %d matches on %d threads in %.3f s, %ld steals\n", t.count, threads, elapsed, stats.steals);
+            printf("tournament: %.1f matches/sec, %.0f ticks/sec\n", t.count / elapsed, (double) ticks / elapsed);
+        }
+    } else {
+        //1, 2, 4, ... scaleMax threads, each run must produce the same results
+        MatchResult* reference = malloc(sizeof(MatchResult) * (size_t) t.count);
+        double baseline = 0.0;
+        int identical = 1;
+        printf("threads  seconds  matches/sec  speedup  efficiency  steals\n");
+        for (int n = 1; n <= scaleMax && reference != NULL; n = nextScale(n, scaleMax)) {
+            double elapsed = runTournament(&t, n, &stats);
+            if (elapsed < 0.0) {
+                status = 1;
+                break;
+            }
+            if (n == 1) {
+                baseline = elapsed;
+                memcpy(reference, t.results, sizeof(MatchResult) * (size_t) t.count);
+            } else if (!sameResults(reference, t.results, t.count)) {
+                identical = 0;
+            }
+            printf("%7d  %7.3f  %11.1f  %7.2f  %9.0f%%  %6ld\n", n, elapsed, t.count / elapsed,
+                   baseline / elapsed, 100.0 * baseline / elapsed / n, stats.steals);
+        }
+        printf("tournament: results %s across thread counts\n", identical ? "identical" : "DIFFER");
+        if (!identical || reference == NULL) {
+            status = 1;
+        }
+        free(reference);
+    }
+
+    if (status == 0 && outPath != NULL && writeResults(&t, outPath) != 0) {
+        status = 1;
+    }
+    free(t.matchups);
+    free(t.results);
+    return status;
+}
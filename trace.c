@@ -0,0 +1,189 @@
+// Timeline tracing, see trace.h
+// Every ring is single producer (its thread) and single consumer (the flush thread): the producer
+// publishes an event by storing head with release order, the consumer frees slots the same way
+// with tail. Rings are registered once per thread under a mutex and never freed before exit.
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "trace.h"
+
+#define traceRingSize 16384 //zones per thread between two flushes, a power of two
+#define traceMaxThreads 64
+#define traceFlushMilliseconds 50
+
+typedef struct TraceEvent{
+    const char* name;
+    long long start; //ns on the monotonic clock
+    long long duration; //ns
+} TraceEvent;
+
+typedef struct TraceRing{
+    TraceEvent events[traceRingSize];
+    atomic_ulong head; //next slot the owning thread writes
+    atomic_ulong tail; //next slot the flush thread reads
+    atomic_ulong dropped;
+    int thread; //tid on the timeline
+    char name[32];
+    int named; //thread name already written
+} TraceRing;
+
+static TraceRing* rings[traceMaxThreads];
+static atomic_int ringCount;
+static pthread_mutex_t registerLock = PTHREAD_MUTEX_INITIALIZER;
+static _Thread_local TraceRing* threadRing;
+
+static atomic_int tracing;
+static FILE* file;
+static const char* filePath;
+static long long origin; //trace time 0
+static int eventsWritten;
+static pthread_t flusher;
+
+static long long traceClock(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+//The calling thread's ring, registered on first use, NULL once traceMaxThreads are taken
+static TraceRing* ownRing(){
+    if (threadRing != NULL) {
+        return threadRing;
+    }
+    pthread_mutex_lock(&registerLock);
+    int count = atomic_load(&ringCount);
+    if (count < traceMaxThreads) {
+        TraceRing* ring = calloc(1, sizeof(TraceRing));
+        if (ring != NULL) {
+            ring->thread = count + 1;
+            snprintf(ring->name, sizeof(ring->name), "thread %d", ring->thread);
+            rings[count] = ring;
+            //the flush thread reads the ring pointer only after seeing the new count
+            atomic_store_explicit(&ringCount, count + 1, memory_order_release);
+            threadRing = ring;
+        }
+    }
+    pthread_mutex_unlock(&registerLock);
+    return threadRing;
+}
+
+long long traceBegin(){
+    return atomic_load_explicit(&tracing, memory_order_relaxed) ? traceClock() : 0;
+}
+
+void traceEnd(const char* name, long long start){
+    if (start == 0) {
+        return;
+    }
+    long long end = traceClock();
+    TraceRing* ring = ownRing();
+    if (ring == NULL) {
+        return;
+    }
+    unsigned long head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    if (head - atomic_load_explicit(&ring->tail, memory_order_acquire) == traceRingSize) {
+        atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+        return;
+    }
+    ring->events[head & (traceRingSize - 1)] = (TraceEvent) {name, start, end - start};
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+void traceThreadName(const char* name){
+    TraceRing* ring = ownRing();
+    if (ring != NULL) {
+        pthread_mutex_lock(&registerLock);
+        snprintf(ring->name, sizeof(ring->name), "%s", name);
+        ring->named = 0;
+        pthread_mutex_unlock(&registerLock);
+    }
+}
+
+static void writeSeparator(){
+    fputs(eventsWritten++ ? ",\n" : "\n", file);
+}
+
+//Moves everything recorded so far into the file, only ever called by one thread at a time
+static void drain(){
+    int count = atomic_load_explicit(&ringCount, memory_order_acquire);
+    for (int r = 0; r < count; r++) {
+        TraceRing* ring = rings[r];
+        pthread_mutex_lock(&registerLock);
+        if (!ring->named) {
+            writeSeparator();
+            fprintf(file, "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": \"%s\"}}",
+                    ring->thread, ring->name);
+            ring->named = 1;
+        }
+        pthread_mutex_unlock(&registerLock);
+        unsigned long tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        unsigned long head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        for (; tail != head; tail++) {
+            const TraceEvent* e = &ring->events[tail & (traceRingSize - 1)];
+            writeSeparator();
+            //trace-event times are in microseconds
+            fprintf(file, "{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f}",
+                    e->name, ring->thread, (double) (e->start - origin) / 1e3, (double) e->duration / 1e3);
+        }
+        atomic_store_explicit(&ring->tail, tail, memory_order_release);
+    }
+    fflush(file);
+}
+
+static void* flushLoop(void* context){
+    (void) context;
+    struct timespec pause = {0, traceFlushMilliseconds * 1000000L};
+    while (atomic_load(&tracing)) {
+        nanosleep(&pause, NULL);
+        drain();
+    }
+    return NULL;
+}
+
+int traceStart(const char* path){
+    if (file != NULL) {
+        return -1;
+    }
+    file = fopen(path, "w");
+    if (file == NULL) {
+        return -1;
+    }
+    filePath = path;
+    origin = traceClock();
+    eventsWritten = 0;
+    fputs("{\"displayTimeUnit\": \"ms\", \"traceEvents\": [", file);
+    atomic_store(&tracing, 1);
+    if (pthread_create(&flusher, NULL, flushLoop, NULL) != 0) {
+        atomic_store(&tracing, 0);
+        fclose(file);
+        file = NULL;
+        return -1;
+    }
+    atexit(traceStop);
+    return 0;
+}
+
+void traceStop(){
+    if (file == NULL) {
+        return;
+    }
+    atomic_store(&tracing, 0);
+    pthread_join(flusher, NULL);
+    drain();
+    unsigned long dropped = 0;
+    int count = atomic_load(&ringCount);
+    for (int r = 0; r < count; r++) {
+        dropped += atomic_load(&rings[r]->dropped);
+    }
+    fputs("\n]}\n", file);
+    if (fclose(file) != 0) {
+        fprintf(stderr, "Failed to write trace: %s\n", filePath);
+    } else if (dropped > 0) {
+        fprintf(stderr, "Trace %s: %lu zones dropped, the rings were full\n", filePath, dropped);
+    }
+    file = NULL;
+}
@@ -0,0 +1,26 @@
+// Timeline tracing
+// Scoped zones (a name, a start and a duration) written as a Chrome trace-event JSON file that
+// chrome://tracing and Perfetto open as a timeline. Each thread records into its own ring buffer
+// without locks; a background thread drains the rings into the file, so recording never waits on
+// I/O. When a ring is full its newest zones are dropped and counted.
+
+#ifndef TRACE_H
+#define TRACE_H
+
+//Starts tracing into path, returns -1 if the file or the flush thread cannot be created.
+//The trace is finished by traceStop or at exit.
+int traceStart(const char* path);
+
+//Flushes every ring and closes the file, safe to call when tracing never started
+void traceStop();
+
+//Opens a zone, returns its start time or 0 if tracing is off
+long long traceBegin();
+
+//Closes the zone opened at start, name must be a string literal or otherwise outlive the trace
+void traceEnd(const char* name, long long start);
+
+//Names the calling thread on the timeline
+void traceThreadName(const char* name);
+
+#endif
@@ -0,0 +1,349 @@
+// Determinism verifier
+// Plays a corpus of replays again on every implementation of the rules, spread over all cores,
+// and checks that each goes through exactly the same states as the C reference. Reference and
+// candidate run side by side from the same recorded inputs and compare state hashes every few
+// frames; when they disagree the interval is bisected from the last agreeing snapshot down to
+// the first frame that differs. The reference itself is checked against the state hashes
+// recorded in the replays, which catches a rules change against the build that recorded them.
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "pong.h"
+#include "physics.h"
+#include "replay.h"
+#include "scheduler.h"
+#include "timestep.h"
+
+#define verifyMaxReports 10 //divergent matches printed per backend
+#define verifyMaxBackends 16
+
+//gameLogic on the asm backend runs on the global state, so only one thread at a time may use it
+static pthread_mutex_t asmLock = PTHREAD_MUTEX_INITIALIZER;
+
+typedef struct MatchRef{
+    int file;
+    size_t offset;
+} MatchRef;
+
+typedef struct MatchResult{
+    long ticks;
+    int corrupt;
+    int skipped; //rules the backend does not implement: swept, or the assembly off 60 Hz
+    long recordedMismatch; //first frame whose recorded hash differs from the reference, -1 if none
+    long divergence; //first tick after which the candidate's state differs, -1 if none
+    Global expected; //states right after that tick
+    Global actual;
+} MatchResult;
+
+typedef struct Verifier{
+    ReplayFile* files;
+    const char** paths;
+    MatchRef* matches;
+    int count;
+    int interval; //frames between hash comparisons
+    const PhysicsBackend* backend; //NULL: reference against the recorded hashes only
+    MatchResult* results;
+} Verifier;
+
+//A match being played back, copied whole to snapshot or restore it
+typedef struct Lane{
+    ReplayFile view;
+    ReplayMatch match;
+    Global g;
+} Lane;
+
+static void copyLane(Lane* to, const Lane* from){
+    *to = *from;
+    to->match.file = &to->view;
+}
+
+//Plays up to ticks frames, returns how many were played or -1 if the replay is corrupt
+static long advance(Lane* lane, long ticks, void (*logic)(Global*)){
+    long played = 0;
+    while (played < ticks) {
+        int step = replayStepWith(&lane->match, &lane->g, logic);
+        if (step < 0) {
+            return -1;
+        }
+        if (step == 0) {
+            break;
+        }
+        played++;
+    }
+    return played;
+}
+
+//Reference and candidate agree at good, not ticks frames later. Halves the gap from the snapshot
+//until the first tick whose state differs is found.
+static long bisect(const Lane* goodReference, const Lane* goodCandidate, long ticks,
+                   void (*reference)(Global*), void (*candidate)(Global*), MatchResult* result){
+    long agree = 0;
+    long differ = ticks;
+    Lane a, b;
+    while (differ - agree > 1) {
+        long middle = agree + (differ - agree) / 2;
+        copyLane(&a, goodReference);
+        copyLane(&b, goodCandidate);
+        advance(&a, middle, reference);
+        advance(&b, middle, candidate);
+        if (simStateHash(&a.g) == simStateHash(&b.g)) {
+            agree = middle;
+        } else {
+            differ = middle;
+        }
+    }
+    copyLane(&a, goodReference);
+    copyLane(&b, goodCandidate);
+    advance(&a, differ, reference);
+    advance(&b, differ, candidate);
+    result->expected = a.g;
+    result->actual = b.g;
+    return goodReference->match.tick + differ;
+}
+
+static void verifyMatch(void* context, int task, int worker){
+    (void) worker;
+    Verifier* v = context;
+    const MatchRef* ref = &v->matches[task];
+    MatchResult* result = &v->results[task];
+    memset(result, 0, sizeof(MatchResult));
+    result->divergence = -1;
+    result->recordedMismatch = -1;
+
+    Lane reference, candidate;
+    if (replaySeekMatch(&v->files[ref->file], ref->offset, &reference.view, &reference.match) != 0) {
+        result->corrupt = 1;
+        return;
+    }
+    reference.match.file = &reference.view;
+    reference.g = reference.match.initial;
+    void (*referenceLogic)(Global*) = reference.match.sweptCollisions ? simGameLogicSwept : simGameLogic;
+
+    const PhysicsBackend* backend = v->backend;
+    int scaled = reference.match.initial.tickScale != 0 && reference.match.initial.tickScale != fixedOne;
+    if (backend == NULL || reference.match.sweptCollisions || (scaled && strcmp(backend->name, "asm") == 0)) {
+        //nothing but the C rules implements the swept collisions yet, and the assembly only
+        //moves by whole 60 Hz frames
+        long played = advance(&reference, 1L << 40, referenceLogic);
+        result->corrupt = played < 0;
+        result->skipped = backend != NULL;
+        result->ticks = played;
+        result->recordedMismatch = reference.match.hashMismatch;
+        return;
+    }
+
+    if (!backend->reentrant) {
+        pthread_mutex_lock(&asmLock);
+    }
+    copyLane(&candidate, &reference);
+    Lane goodReference, goodCandidate;
+    for (;;) {
+        copyLane(&goodReference, &reference);
+        copyLane(&goodCandidate, &candidate);
+        long a = advance(&reference, v->interval, referenceLogic);
+        long b = advance(&candidate, v->interval, physicsGameLogic);
+        if (a < 0 || b < 0) {
+            result->corrupt = 1;
+            break;
+        }
+        result->ticks += a;
+        if (a != b || simStateHash(&reference.g) != simStateHash(&candidate.g)) {
+            result->divergence = bisect(&goodReference, &goodCandidate, a > b ? a : b,
+                                        referenceLogic, physicsGameLogic, result);
+            break;
+        }
+        if (a < v->interval) {
+            break;
+        }
+    }
+    if (!backend->reentrant) {
+        pthread_mutex_unlock(&asmLock);
+    }
+}
+
+//Lists every match of every file, returns -1 if a file cannot be read
+static int indexMatches(Verifier* v, int fileCount){
+    int capacity = 0;
+    for (int f = 0; f < fileCount; f++) {
+        if (replayOpen(&v->files[f], v->paths[f]) != 0) {
+            fprintf(stderr, "verify: could not open %s\n", v->paths[f]);
+            return -1;
+        }
+        ReplayMatch match;
+        int read;
+        while ((read = replayNextMatch(&v->files[f], &match)) == 1) {
+            if (v->count == capacity) {
+                capacity = capacity ? capacity * 2 : 256;
+                MatchRef* grown = realloc(v->matches, sizeof(MatchRef) * (size_t) capacity);
+                if (grown == NULL) {
+                    return -1;
+                }
+                v->matches = grown;
+            }
+            v->matches[v->count].file = f;
+            v->matches[v->count].offset = match.offset;
+            v->count++;
+        }
+        if (read < 0) {
+            fprintf(stderr, "verify: %s is corrupt\n", v->paths[f]);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void printState(const char* label, const Global* g){
+    printf("verify:     %s ball %d,%d dir %d,%d speed %d, paddles %d %d, score %d-%d, last %d, over %d\n",
+           label, g->ballPosition.x, g->ballPosition.y, g->ballDirection.x, g->ballDirection.y, g->ballSpeed,
+           g->playerPaddlePosition.y, g->aiPaddlePosition.y, g->playerScore, g->aiScore, g->lastScore, g->gameOver);
+}
+
+//Runs one backend over the whole corpus, returns the number of bad matches
+static long runBackend(Verifier* v, const char* name, int threads){
+    double start = timestepNow();
+    SchedulerStats stats;
+    if (runTasks(v->count, threads, verifyMatch, v, &stats) != 0) {
+        fprintf(stderr, "verify: could not start the workers\n");
+        return -1;
+    }
+    double elapsed = timestepNow() - start;
+
+    long bad = 0, reported = 0, skipped = 0;
+    long long ticks = 0;
+    for (int i = 0; i < v->count; i++) {
+        const MatchResult* r = &v->results[i];
+        const MatchRef* ref = &v->matches[i];
+        ticks += r->ticks;
+        skipped += r->skipped;
+        if (!r->corrupt && r->divergence < 0 && r->recordedMismatch < 0) {
+            continue;
+        }
+        bad++;
+        if (reported++ == verifyMaxReports) {
+            printf("verify:   ...\n");
+        }
+        if (reported > verifyMaxReports) {
+            continue;
+        }
+        if (r->corrupt) {
+            printf("verify:   %s at byte %zu is corrupt\n", v->paths[ref->file], ref->offset);
+        } else if (r->recordedMismatch >= 0) {
+            printf("verify:   %s at byte %zu: state hash differs from the recording by frame %ld\n",
+                   v->paths[ref->file], ref->offset, r->recordedMismatch);
+        } else {
+            printf("verify:   %s at byte %zu: first differs after tick %ld\n", v->paths[ref->file], ref->offset,
+                   r->divergence);
+            printState("c   ", &r->expected);
+            printState(name, &r->actual);
+        }
+    }
+    printf("verify: %-8s %d matches, %lld ticks in %.3f s (%.0f ticks/sec), %ld bad", name, v->count - (int) skipped,
+           ticks, elapsed, (double) ticks / elapsed, bad);
+    printf(skipped ? ", %ld with rules it does not implement skipped\n" : "\n", skipped);
+    fflush(stdout);
+    return bad;
+}
+
+static void printUsage(const char* name){
+    fprintf(stderr, "usage: %s [--threads N] [--backends asm,branchless,avx512,avx2,sse4.1] [--interval FRAMES] REPLAY...\n", name);
+}
+
+int main(int argc, char **argv)
+{
+    int threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    const char* backendList = NULL;
+    Verifier v;
+    memset(&v, 0, sizeof(v));
+    v.interval = replayHashInterval;
+    v.paths = malloc(sizeof(char*) * (size_t) argc);
+    int fileCount = 0;
+    if (v.paths == NULL) {
+        return 1;
+    }
+
+    for (int i = 1; i < argc; i++) {
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strncmp(argv[i], "--", 2) != 0) {
+            v.paths[fileCount++] = argv[i];
+            continue;
+        }
+        if (value == NULL) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        if (strcmp(argv[i], "--threads") == 0) {
+            threads = atoi(value);
+        } else if (strcmp(argv[i], "--backends") == 0) {
+            backendList = value;
+        } else if (strcmp(argv[i], "--interval") == 0) {
+            v.interval = atoi(value);
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+        i++;
+    }
+    if (fileCount == 0 || threads < 1 || v.interval < 1) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    //every backend but the reference unless a list was given, names are checked when their pass starts
+    const char* selected[verifyMaxBackends];
+    int selectedCount = 0;
+    char* list = NULL;
+    if (backendList == NULL) {
+        const PhysicsBackend* available[verifyMaxBackends];
+        int count = physicsAvailable(available, verifyMaxBackends);
+        for (int i = 0; i < count; i++) {
+            if (strcmp(available[i]->name, "c") != 0) {
+                selected[selectedCount++] = available[i]->name;
+            }
+        }
+    } else {
+        list = strdup(backendList);
+        for (char* name = strtok(list, ","); name != NULL && selectedCount < verifyMaxBackends; name = strtok(NULL, ",")) {
+            selected[selectedCount++] = name;
+        }
+    }
+
+    v.files = calloc((size_t) fileCount, sizeof(ReplayFile));
+    int status = v.files != NULL && indexMatches(&v, fileCount) == 0 ? 0 : 1;
+    if (status == 0 && v.count > 0) {
+        v.results = calloc((size_t) v.count, sizeof(MatchResult));
+        status = v.results != NULL ? 0 : 1;
+    }
+    if (status == 0) {
+        printf("verify: %d matches in %d files on %d threads, hashes compared every %d frames\n",
+               v.count, fileCount, threads, v.interval);
+        //the reference against the recordings first, then every backend against the reference
+        v.backend = NULL;
+        if (runBackend(&v, "c", threads) != 0) {
+            status = 1;
+        }
+        for (int i = 0; i < selectedCount; i++) {
+            if (physicsSelect(selected[i]) != 0) {
+                printf("verify: %-8s unknown or not supported by this CPU, skipped\n", selected[i]);
+                continue;
+            }
+            v.backend = physicsBackend();
+            if (runBackend(&v, v.backend->name, threads) != 0) {
+                status = 1;
+            }
+        }
+        printf("verify: %s\n", status == 0 ? "all backends agree" : "DIVERGENCE FOUND");
+    }
+
+    for (int f = 0; v.files != NULL && f < fileCount; f++) {
+        replayUnmap(&v.files[f]);
+    }
+    free(v.files);
+    free(v.matches);
+    free(v.results);
+    free(v.paths);
+    free(list);
+    return status;
+}
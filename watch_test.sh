@@ -0,0 +1,23 @@
+#!/bin/sh
+# Multi-worker watch test
+# One bot plays on a four worker server and eight viewers watch it. The kernel hashes the viewers
+# to any of the workers, so most of them are forwarded to the one that owns the match, and every
+# viewer has to be let in and served.
+# usage: watch_test.sh PONG_SERVER PONG_HEADLESS [PORT]
+
+server=$1
+headless=$2
+port=${3:-30871}
+
+"$server" --port "$port" --threads 4 --no-pin > /dev/null &
+serverPid=$!
+sleep 0.5
+"$headless" --connect "127.0.0.1:$port" --bots 1 --max-ticks 360 > /dev/null &
+botPid=$!
+sleep 0.5
+"$headless" --watch "127.0.0.1:$port" --viewers 8 --max-ticks 240
+status=$?
+wait "$botPid" || status=1
+kill -INT "$serverPid"
+wait "$serverPid" || status=1
+exit $status